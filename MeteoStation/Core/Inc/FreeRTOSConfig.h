@@ -90,6 +90,7 @@ to exclude the API function. */
 
 #define INCLUDE_xTaskGetIdleTaskHandle	1
 #define INCLUDE_pxTaskGetStackStart		1
+#define INCLUDE_xTaskGetSchedulerState	1
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
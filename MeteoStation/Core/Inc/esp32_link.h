@@ -0,0 +1,37 @@
+#ifndef INC_ESP32_LINK_H_
+#define INC_ESP32_LINK_H_
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+#include "meteo_frame.h"
+
+/* Application configurable items */
+#define ESP32_LINK_READY_PORT		GPIOC
+#define ESP32_LINK_READY_PIN		GPIO_PIN_4	/* ESP32 READY_PIN ( GPIO12 ), high while its transaction is queued */
+#define ESP32_LINK_QUEUE_DEPTH		4			/* frames waiting for ESP32, oldest is dropped */
+#define ESP32_LINK_READY_MS			50			/* wait for READY in one try */
+#define ESP32_LINK_XFER_MS			20			/* one transfer, frame takes ~0.2 ms at 5.25 MHz */
+#define ESP32_LINK_RETRY_MS			1000		/* period of retry of queued frames */
+#define ESP32_LINK_BOOT_MS			60000		/* wait for time from ESP32 at boot */
+
+typedef struct
+{
+	uint32_t sent;			/* frames received by ESP32 */
+	uint32_t dropped;		/* frames dropped from full queue */
+	uint32_t timeouts;		/* READY or transfer timeouts */
+	uint32_t errors;		/* SPI or DMA errors */
+
+}esp32_link_stats_t;
+
+/* Function prototypes */
+void esp32_link_init(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef esp32_link_boot_receive(uint8_t *buf, uint16_t len);
+HAL_StatusTypeDef esp32_link_transfer(const uint8_t *buf, uint16_t len);
+
+/* Frame queue, used only by esp32 task */
+void esp32_link_queue(const uint8_t *frame);
+uint8_t esp32_link_pending(void);
+HAL_StatusTypeDef esp32_link_send_pending(void);
+void esp32_link_get_stats(esp32_link_stats_t *stats);
+
+#endif /* INC_ESP32_LINK_H_ */
@@ -0,0 +1,67 @@
+#ifndef INC_LOGGER_H_
+#define INC_LOGGER_H_
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+/* Log levels */
+#define LOG_LEVEL_DEBUG		0
+#define LOG_LEVEL_INFO		1
+#define LOG_LEVEL_WARN		2
+#define LOG_LEVEL_ERROR		3
+#define LOG_LEVEL_NONE		4
+
+/* Application configurable items */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL	LOG_LEVEL_INFO	/* lower levels are compiled out */
+#endif
+#define LOG_RING_SIZE		2048			/* bytes, power of 2 */
+#define LOG_LINE_SIZE		128				/* max length of one message */
+
+/* modules with their own runtime level */
+typedef enum
+{
+	LOG_MOD_MAIN,
+	LOG_MOD_SD,
+	LOG_MOD_RTC,
+	LOG_MOD_BME280,
+	LOG_MOD_LCD,
+	LOG_MOD_ESP32,
+	LOG_MOD_COUNT
+}log_module_t;
+
+/* Function prototypes */
+void log_init(UART_HandleTypeDef *huart);
+void log_set_level(log_module_t module, uint8_t level);
+uint32_t log_dropped(void);
+
+/* Writers, never block, message which doesn't fit into the ring is dropped */
+int log_write(const char *data, int len);
+void log_printf(uint8_t level, log_module_t module, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+/* Level macros, arguments of compiled out levels are not evaluated */
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(module, ...)	log_printf(LOG_LEVEL_DEBUG, module, __VA_ARGS__)
+#else
+#define LOG_DEBUG(module, ...)	do { } while(0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(module, ...)	log_printf(LOG_LEVEL_INFO, module, __VA_ARGS__)
+#else
+#define LOG_INFO(module, ...)	do { } while(0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(module, ...)	log_printf(LOG_LEVEL_WARN, module, __VA_ARGS__)
+#else
+#define LOG_WARN(module, ...)	do { } while(0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(module, ...)	log_printf(LOG_LEVEL_ERROR, module, __VA_ARGS__)
+#else
+#define LOG_ERROR(module, ...)	do { } while(0)
+#endif
+
+#endif /* INC_LOGGER_H_ */
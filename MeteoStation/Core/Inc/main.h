@@ -45,7 +45,13 @@ extern "C" {
 
 // sensor includes
 #include "types.h"
+#include "sample_bus.h"
+#include "esp32_link.h"
+#include "logger.h"
+#include "sw_clock.h"
+#include "i2c_bus.h"
 #include "ds1307.h"
+#include "dwt.h"
 #include "lcd.h"
 #include "bme280.h"
 
@@ -67,7 +73,8 @@ extern char curr_path[21];
 
 extern BME280_data_t measuring;
 extern TaskHandle_t handle_rtc_task, handle_bme280_task, handle_lcd_task, handle_sd_task, handle_esp32_send;
-extern QueueHandle_t q_bme280, q_lcd, q_sd, q_esp32;
+extern QueueHandle_t q_bme280;
+extern sample_sub_t *sub_lcd, *sub_esp32, *sub_sd;
 extern SemaphoreHandle_t i2cMutex, spiMutex;
 
 /* USER CODE END ET */
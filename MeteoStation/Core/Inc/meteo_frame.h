@@ -0,0 +1,9 @@
+#ifndef INC_METEO_FRAME_H_
+#define INC_METEO_FRAME_H_
+
+/* SPI frame format is shared with the ESP32 firmware, source is common/meteo_frame.h
+ * CubeIDE builds only folders of this project, so Core includes the shared file from here
+ */
+#include "../../../common/meteo_frame.h"
+
+#endif /* INC_METEO_FRAME_H_ */
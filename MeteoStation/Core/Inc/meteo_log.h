@@ -0,0 +1,52 @@
+#ifndef INC_METEO_LOG_H_
+#define INC_METEO_LOG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "types.h"
+
+/* Binary day log: file of 512 bytes blocks, one block per SD sector
+ * every block has header and packed meteo_msg_t records
+ * header crc covers the header without crc field and all bytes after header
+ * all values are little endian
+ */
+
+#define METEO_LOG_BLOCK_SIZE	512
+#define METEO_LOG_MAGIC			0x424C4D4DUL	/* "MMLB" */
+#define METEO_LOG_VERSION		1
+
+typedef struct __attribute__((packed))
+{
+	uint32_t magic;			/* METEO_LOG_MAGIC */
+	uint32_t first_ts;		/* epoch of the first record */
+	uint16_t count;			/* number of valid records */
+	uint8_t version;		/* METEO_LOG_VERSION */
+	uint8_t record_size;	/* sizeof(meteo_msg_t) */
+	uint32_t crc;			/* CRC32 ( IEEE 802.3 ) */
+
+}meteo_log_header_t;
+
+#define METEO_LOG_RECORDS	((METEO_LOG_BLOCK_SIZE - sizeof(meteo_log_header_t)) / sizeof(meteo_msg_t))
+
+typedef struct __attribute__((packed))
+{
+	meteo_log_header_t header;
+	meteo_msg_t records[METEO_LOG_RECORDS];
+	uint8_t reserved[METEO_LOG_BLOCK_SIZE - sizeof(meteo_log_header_t) - METEO_LOG_RECORDS * sizeof(meteo_msg_t)];
+
+}meteo_log_block_t;
+
+/* Day index: file of uint32_t first_ts of every block, entry n is block n */
+#define METEO_LOG_INDEX_ENTRY	sizeof(uint32_t)
+
+/* CRC32 */
+uint32_t meteo_log_crc32(uint32_t crc, const void *data, size_t len);
+
+/* Block handling */
+void meteo_log_block_init(meteo_log_block_t *block);
+int meteo_log_block_add(meteo_log_block_t *block, const meteo_msg_t *msg);
+int meteo_log_block_full(const meteo_log_block_t *block);
+void meteo_log_block_seal(meteo_log_block_t *block);
+int meteo_log_block_check(const meteo_log_block_t *block);
+
+#endif /* INC_METEO_LOG_H_ */
@@ -0,0 +1,28 @@
+#ifndef INC_METEO_MSG_H_
+#define INC_METEO_MSG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "types.h"
+
+/* Conversions of sample record meteo_msg_t */
+
+/* Time: RTC date and time <-> epoch seconds */
+uint32_t meteo_epoch_from_rtc(const RTC_date_t *date, const RTC_time_t *time);
+void meteo_epoch_to_rtc(uint32_t epoch, RTC_date_t *date, RTC_time_t *time);
+
+/* Measuring: BME280 values -> fixed point */
+int16_t meteo_temperature_to_fixed(double temperature);
+uint16_t meteo_humidity_to_fixed(double humidity);
+uint32_t meteo_pressure_to_fixed(double pressure);
+
+/* Measuring: fixed point -> DegC, %rH and hPa */
+float meteo_temperature(const meteo_msg_t *msg);
+float meteo_humidity(const meteo_msg_t *msg);
+float meteo_pressure(const meteo_msg_t *msg);
+
+/* Text formats for LCD and SD card */
+void meteo_format_lcd(const meteo_msg_t *msg, char *line1, char *line2, size_t len);
+int meteo_format_csv(const meteo_msg_t *msg, char *buf, size_t len);
+
+#endif /* INC_METEO_MSG_H_ */
@@ -0,0 +1,29 @@
+#ifndef INC_SAMPLE_BUS_H_
+#define INC_SAMPLE_BUS_H_
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "types.h"
+
+/* Application configurable items */
+#define SAMPLE_BUS_DEPTH				16	/* samples kept in the ring */
+#define SAMPLE_BUS_MAX_SUBSCRIBERS		4
+
+/* consumer of the bus, each one reads with its own cursor */
+typedef struct
+{
+	uint32_t cursor;			/* sequence number of the next sample to read */
+	uint32_t dropped;			/* samples overwritten before they were read */
+	SemaphoreHandle_t ready;	/* given by the producer on every publish */
+}sample_sub_t;
+
+/* Function prototypes */
+void sample_bus_init(void);
+sample_sub_t* sample_bus_subscribe(void);
+
+/* Producer and consumer APIs */
+void sample_bus_publish(const meteo_msg_t *msg);
+BaseType_t sample_bus_receive(sample_sub_t *sub, meteo_msg_t *msg, TickType_t timeout);
+uint32_t sample_bus_dropped(sample_sub_t *sub);
+
+#endif /* INC_SAMPLE_BUS_H_ */
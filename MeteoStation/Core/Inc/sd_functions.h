@@ -3,11 +3,59 @@
 
 #include "fatfs.h"
 #include <stdint.h>
+#include "types.h"
+#include "meteo_log.h"
+
+// Format of day log: CSV text lines or binary blocks with CRC and index ( meteo_log.h )
+#define SD_LOG_FORMAT_CSV		0
+#define SD_LOG_FORMAT_BIN		1
+#ifndef SD_LOG_FORMAT
+#define SD_LOG_FORMAT			SD_LOG_FORMAT_CSV
+#endif
+
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_BIN
+#define SD_LOG_EXT				"bin"
+#else
+#define SD_LOG_EXT				"csv"
+#endif
+#define SD_LOG_INDEX_EXT		"idx"
+
+// Day file is preallocated as contiguous extent for the full day at this sample period (s)
+#define SD_LOG_SAMPLE_PERIOD_S	10
+#define SD_LOG_DAY_SAMPLES		(86400 / SD_LOG_SAMPLE_PERIOD_S)
+
+// Max length of CSV line ( -tt.t;pppp.p;hhh.hh )
+#define SD_LOG_LINE_SIZE		30
+
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_BIN
+#define SD_LOG_PREALLOC_SIZE	(((SD_LOG_DAY_SAMPLES + METEO_LOG_RECORDS - 1) / METEO_LOG_RECORDS) * METEO_LOG_BLOCK_SIZE)
+#else
+#define SD_LOG_PREALLOC_SIZE	(((SD_LOG_DAY_SAMPLES * SD_LOG_LINE_SIZE + 511) / 512) * 512)
+#endif
+
+// Size of cluster link map table of readers (DWORDs), contiguous file needs 4
+#define SD_LOG_CLMT_SIZE		16
+
+// Binary log: write block and f_sync after this number of records (1 = every sample)
+#define SD_LOG_SYNC_INTERVAL	6
+
+// CSV log: RAM buffer which is written as whole aligned sectors (multiple of 512)
+#define SD_LOG_BUF_SIZE			512
+
+// Max age of data not written to the card, bounds the data loss window (ms)
+#define SD_LOG_MAX_AGE_MS		180000
+
+// sd_task checks the card pin and age of buffered data with this period (ms)
+#define SD_LOG_POLL_MS			100
+
+// Print SD log cost every this number of samples (0 = never)
+#define SD_LOG_STATS_INTERVAL	360
 
 
 // Mount and unmount
 int sd_mount(void);
 int sd_unmount(void);
+int sd_is_mounted(void);
 
 // Basic file operations
 int sd_write_file(const char *filename, const char *text);
@@ -16,6 +64,19 @@ int sd_read_file(const char *filename, char *buffer, UINT bufsize, UINT *bytes_r
 int sd_delete_file(const char *filename);
 int sd_rename_file(const char *oldname, const char *newname);
 
+// Persistent logging session (file stays open between samples)
+int sd_log_open(const char *filename);
+int sd_log_append(const char *text);
+int sd_log_append_record(const meteo_msg_t *msg);
+int sd_log_flush(void);
+int sd_log_flush_due(void);
+int sd_log_close(void);
+void sd_log_discard(void);
+int sd_log_is_open(void);
+void sd_log_print_stats(uint32_t samples);
+
+// Binary day log reader, records with from <= epoch <= to
+int sd_log_read_range(const char *filename, uint32_t from, uint32_t to, meteo_msg_t *records, int max_records, int *record_count);
 
 // Directory handling
 FRESULT sd_create_directory(const char *path);
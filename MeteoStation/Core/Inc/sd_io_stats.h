@@ -0,0 +1,35 @@
+#ifndef INC_SD_IO_STATS_H_
+#define INC_SD_IO_STATS_H_
+
+#include <stdint.h>
+#include "ff_gen_drv.h"
+
+/* Disk I/O counters of FatFs volume
+ * sd_io_stats_link puts a counting shim between FatFs and the disk driver,
+ * generated sd_diskio.c stays as CubeMX writes it
+ */
+
+/* Set to 0 to link SD_Driver without the counting shim */
+#ifndef SD_IO_STATS
+#define SD_IO_STATS		1
+#endif
+
+typedef struct
+{
+	uint32_t read_cmds;			/* calls of disk_read */
+	uint32_t write_cmds;		/* calls of disk_write */
+	uint32_t sectors_read;
+	uint32_t sectors_written;
+	uint32_t errors;			/* calls which returned not RES_OK */
+	uint32_t busy_ms;			/* time spent inside disk_read / disk_write */
+}sd_io_stats_t;
+
+/* Function prototypes */
+
+/* Relink the volume of path to the shim which calls drv */
+uint8_t sd_io_stats_link(const Diskio_drvTypeDef *drv, char *path);
+
+void sd_io_stats_get(sd_io_stats_t *stats);
+void sd_io_stats_reset(void);
+
+#endif /* INC_SD_IO_STATS_H_ */
@@ -0,0 +1,53 @@
+#ifndef INC_SW_CLOCK_H_
+#define INC_SW_CLOCK_H_
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+/* TIM2 time base: 84 MHz / 8400 = 10 kHz counter, period 10 s */
+#define SW_CLOCK_TICK_US			100
+#define SW_CLOCK_TIM_PERIOD			100000
+
+/* Application configurable items */
+#define SW_CLOCK_SYNC_INTERVAL_S	3600		/* resync from the reference clock */
+#define SW_CLOCK_STEP_US			2000000		/* bigger offset is stepped, smaller is slewed */
+#define SW_CLOCK_SLEW_PPM			500			/* max rate of slewing */
+#define SW_CLOCK_MAX_FREQ_PPB		500000		/* limit of drift correction */
+#define SW_CLOCK_MIN_DRIFT_S		60			/* shorter sync interval doesn't update drift */
+
+/* DS1307 has 1 s resolution, the reference is taken at its second edge */
+#define SW_CLOCK_EDGE_LEAD_MS		20			/* first read before the predicted edge */
+#define SW_CLOCK_EDGE_POLL_MS		5			/* period of reads until seconds change */
+#define SW_CLOCK_EDGE_POLLS			220			/* more than 1 s of reads */
+
+/* sources of reference time */
+typedef enum
+{
+	SW_CLOCK_SRC_DS1307,
+	SW_CLOCK_SRC_SNTP
+}sw_clock_src_t;
+
+typedef struct
+{
+	uint32_t syncs;			/* references applied */
+	uint32_t steps;			/* references applied as step change */
+	int32_t last_offset_us;	/* reference - clock at the last sync */
+	int32_t drift_ppb;		/* estimated rate correction of TIM2 base */
+	sw_clock_src_t last_src;
+}sw_clock_stats_t;
+
+/* Function prototypes */
+void sw_clock_init(TIM_HandleTypeDef *htim);
+void sw_clock_period_elapsed(void);
+
+/* Read, O(1) without bus traffic, monotonic between steps */
+uint64_t sw_clock_now_us(void);
+uint32_t sw_clock_now(void);
+int sw_clock_is_synced(void);
+
+/* Reference time ( local wall clock, us since 01.01.1970 ) */
+void sw_clock_sync(uint64_t ref_us, sw_clock_src_t src);
+int sw_clock_sync_due(void);
+void sw_clock_get_stats(sw_clock_stats_t *stats);
+
+#endif /* INC_SW_CLOCK_H_ */
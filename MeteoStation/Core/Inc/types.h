@@ -26,27 +26,26 @@ typedef struct
 
 }BME280_data_t;
 
-typedef struct
+/* canonical sample record, travels unchanged through queues, SPI and SD */
+typedef struct __attribute__((packed))
 {
-	char timestamp[17];
-	uint8_t date, month, year;
-	float temperature;
-	float pressure;
-	float humidity;
+	uint32_t epoch;			/* seconds since 01.01.1970 of RTC clock ( local time ) */
+	int16_t temperature;	/* 0.01 DegC */
+	uint16_t humidity;		/* 0.01 %rH */
+	uint32_t pressure;		/* Pa */
+	uint8_t flags;			/* METEO_FLAG_x */
 
 }meteo_msg_t;
 
+/* meteo_msg_t flags */
+#define METEO_FLAG_RTC_ERR		(1 << 0)	/* time was not read from RTC */
+#define METEO_FLAG_SENSOR_ERR	(1 << 1)	/* measuring was not read from BME280 */
+
 typedef struct
 {
 	uint8_t prev_date;
 	uint8_t	prev_month;
 }prev_date_t;
 
-typedef struct __attribute__((packed)) {
-    float temperature;
-    float humidity;
-    float pressure;
-} measurement_t;
-
 
 #endif /* INC_TYPES_H_ */
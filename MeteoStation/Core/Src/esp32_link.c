@@ -0,0 +1,208 @@
+#include "esp32_link.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include <string.h>
+
+/*
+ * ESP32 is SPI slave, it can take data only while its transaction is
+ * queued, then it holds READY high. Rising edge of READY wakes the
+ * esp32 task by EXTI, frame is sent by SPI1 TX/RX DMA.
+ * Every frame waits for its own edge, level of READY is not used: it
+ * is still high for a while after the transfer, until ESP32 finishes
+ * its transaction. ESP32 queues the next one only after that, so an
+ * edge given after the end of a transfer is fresh, edges given before
+ * it are dropped. Every wait is bounded, if ESP32 is rebooting or
+ * busy, frames stay in the queue and the task goes back to samples.
+ */
+
+static SPI_HandleTypeDef *link_hspi;
+static SemaphoreHandle_t ready_sem;		/* given on rising edge of READY */
+static SemaphoreHandle_t done_sem;		/* given when DMA transfer is finished */
+static volatile HAL_StatusTypeDef done_status;
+
+/* frames which wait for ESP32 */
+static uint8_t queue[ESP32_LINK_QUEUE_DEPTH][METEO_FRAME_SPI_SIZE];
+static uint8_t queue_head, queue_count;
+
+/* ESP32 sends zeros back, they are not used now */
+static uint8_t rx_buf[METEO_FRAME_SPI_SIZE];
+
+static esp32_link_stats_t link_stats;
+
+/***************************************************************
+ * Initialize the link
+ * SPI should be initialized with TX and RX DMA, call before
+ * READY interrupt may be used
+ ***************************************************************/
+
+void esp32_link_init(SPI_HandleTypeDef *hspi)
+{
+	ready_sem = xSemaphoreCreateBinary();
+	configASSERT(ready_sem != NULL);
+
+	done_sem = xSemaphoreCreateBinary();
+	configASSERT(done_sem != NULL);
+
+	link_hspi = hspi;
+}
+
+/***************************************************************
+ * Receive data from ESP32 before scheduler is started
+ * Waits for READY at most ESP32_LINK_BOOT_MS
+ ***************************************************************/
+
+HAL_StatusTypeDef esp32_link_boot_receive(uint8_t *buf, uint16_t len)
+{
+	uint32_t start = HAL_GetTick();
+
+	while(HAL_GPIO_ReadPin(ESP32_LINK_READY_PORT, ESP32_LINK_READY_PIN) != GPIO_PIN_SET)
+	{
+		if(HAL_GetTick() - start >= ESP32_LINK_BOOT_MS) return HAL_TIMEOUT;
+		HAL_Delay(10);
+	}
+
+	HAL_StatusTypeDef ret = HAL_SPI_Receive(link_hspi, buf, len, ESP32_LINK_XFER_MS);
+
+	// edge of this transaction was given by EXTI, it is not valid for the first transfer
+	xSemaphoreTake(ready_sem, 0);
+
+	return ret;
+}
+
+/***************************************************************
+ * Send buffer when ESP32 is ready
+ * Returns HAL_TIMEOUT if READY doesn't come or DMA doesn't finish
+ ***************************************************************/
+
+HAL_StatusTypeDef esp32_link_transfer(const uint8_t *buf, uint16_t len)
+{
+	// rising edge of transaction queued after the previous transfer
+	if(xSemaphoreTake(ready_sem, pdMS_TO_TICKS(ESP32_LINK_READY_MS)) != pdTRUE)
+	{
+		link_stats.timeouts++;
+		return HAL_TIMEOUT;
+	}
+
+	xSemaphoreTake(done_sem, 0);
+	if(HAL_SPI_TransmitReceive_DMA(link_hspi, (uint8_t*)buf, rx_buf, len) != HAL_OK)
+	{
+		link_stats.errors++;
+		return HAL_ERROR;
+	}
+
+	if(xSemaphoreTake(done_sem, pdMS_TO_TICKS(ESP32_LINK_XFER_MS)) != pdTRUE)
+	{
+		HAL_SPI_Abort(link_hspi);
+		link_stats.timeouts++;
+		return HAL_TIMEOUT;
+	}
+
+	if(done_status != HAL_OK)
+	{
+		link_stats.errors++;
+		return HAL_ERROR;
+	}
+
+	return HAL_OK;
+}
+
+/***************************************************************
+ * Put frame into the queue, oldest frame is dropped if full
+ ***************************************************************/
+
+void esp32_link_queue(const uint8_t *frame)
+{
+	if(queue_count == ESP32_LINK_QUEUE_DEPTH)
+	{
+		queue_head = (queue_head + 1) % ESP32_LINK_QUEUE_DEPTH;
+		queue_count--;
+		link_stats.dropped++;
+	}
+
+	memcpy(queue[(queue_head + queue_count) % ESP32_LINK_QUEUE_DEPTH], frame, METEO_FRAME_SPI_SIZE);
+	queue_count++;
+}
+
+/***************************************************************
+ * Get number of frames in the queue
+ ***************************************************************/
+
+uint8_t esp32_link_pending(void)
+{
+	return queue_count;
+}
+
+/***************************************************************
+ * Send the oldest frame, it leaves the queue only if it is sent
+ ***************************************************************/
+
+HAL_StatusTypeDef esp32_link_send_pending(void)
+{
+	if(queue_count == 0) return HAL_OK;
+
+	HAL_StatusTypeDef ret = esp32_link_transfer(queue[queue_head], METEO_FRAME_SPI_SIZE);
+	if(ret != HAL_OK) return ret;
+
+	queue_head = (queue_head + 1) % ESP32_LINK_QUEUE_DEPTH;
+	queue_count--;
+	link_stats.sent++;
+
+	return HAL_OK;
+}
+
+/***************************************************************
+ * Copy statistics of the link
+ ***************************************************************/
+
+void esp32_link_get_stats(esp32_link_stats_t *stats)
+{
+	*stats = link_stats;
+}
+
+/***************************************************************
+ * READY rising edge
+ ***************************************************************/
+
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	BaseType_t woken = pdFALSE;
+
+	if(GPIO_Pin != ESP32_LINK_READY_PIN || ready_sem == NULL) return;
+
+	xSemaphoreGiveFromISR(ready_sem, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+/***************************************************************
+ * DMA transfer is finished
+ * Transaction of ESP32 is not finished yet, edges which were
+ * given until now don't belong to the next one
+ ***************************************************************/
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+	BaseType_t woken = pdFALSE;
+
+	if(hspi != link_hspi) return;
+
+	xSemaphoreTakeFromISR(ready_sem, &woken);
+	done_status = HAL_OK;
+	xSemaphoreGiveFromISR(done_sem, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+/***************************************************************
+ * SPI or DMA error, transfer is stopped
+ ***************************************************************/
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+	BaseType_t woken = pdFALSE;
+
+	if(hspi != link_hspi) return;
+
+	xSemaphoreTakeFromISR(ready_sem, &woken);
+	done_status = HAL_ERROR;
+	xSemaphoreGiveFromISR(done_sem, &woken);
+	portYIELD_FROM_ISR(woken);
+}
@@ -0,0 +1,172 @@
+#include "logger.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+/*
+ * Writers copy messages into the ring and return, USART2 TX DMA sends
+ * the ring in the background. Every DMA transfer is one contiguous part
+ * of the ring, transfer complete interrupt starts the next part.
+ * Writers only reserve and copy with interrupts masked up to
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY, they never wait for the UART.
+ * Call writers only from tasks and interrupts which may use FreeRTOS API.
+ */
+
+static char ring[LOG_RING_SIZE];
+static volatile uint32_t head;		/* total bytes written into the ring */
+static volatile uint32_t tail;		/* total bytes sent by DMA */
+static volatile uint32_t tx_len;	/* bytes of the running DMA transfer, 0 = idle */
+static volatile uint32_t dropped;	/* messages which didn't fit into the ring */
+
+static UART_HandleTypeDef *log_huart;
+static uint8_t levels[LOG_MOD_COUNT];
+
+/***************************************************************
+ * Start DMA transfer of the next contiguous part of the ring
+ * Call with interrupts masked
+ ***************************************************************/
+
+static void log_kick(void)
+{
+	if(log_huart == NULL || tx_len != 0 || head == tail) return;
+
+	uint32_t start = tail & (LOG_RING_SIZE - 1);
+	uint32_t len = head - tail;
+
+	if(len > LOG_RING_SIZE - start) len = LOG_RING_SIZE - start;
+
+	tx_len = len;
+	if(HAL_UART_Transmit_DMA(log_huart, (uint8_t*)&ring[start], len) != HAL_OK)
+	{
+		// UART is busy, next write tries again
+		tx_len = 0;
+	}
+}
+
+/***************************************************************
+ * Initialize the logger
+ * UART should be initialized with TX DMA, data written before
+ * this call is sent now
+ ***************************************************************/
+
+void log_init(UART_HandleTypeDef *huart)
+{
+	for(uint8_t i = 0; i < LOG_MOD_COUNT; i++)
+	{
+		levels[i] = LOG_COMPILE_LEVEL;
+	}
+
+	UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+	log_huart = huart;
+	log_kick();
+	taskEXIT_CRITICAL_FROM_ISR(state);
+}
+
+/***************************************************************
+ * Set runtime level of module
+ * Levels below LOG_COMPILE_LEVEL are compiled out anyway
+ ***************************************************************/
+
+void log_set_level(log_module_t module, uint8_t level)
+{
+	if(module < LOG_MOD_COUNT) levels[module] = level;
+}
+
+/***************************************************************
+ * Get number of messages dropped because the ring was full
+ ***************************************************************/
+
+uint32_t log_dropped(void)
+{
+	return dropped;
+}
+
+/***************************************************************
+ * Copy data into the ring and start DMA if it is idle
+ * Data is dropped as whole message if there is no space
+ * Returns number of bytes written
+ ***************************************************************/
+
+int log_write(const char *data, int len)
+{
+	if(len <= 0) return 0;
+
+	UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+
+	if((uint32_t)len > LOG_RING_SIZE - (head - tail))
+	{
+		dropped++;
+		taskEXIT_CRITICAL_FROM_ISR(state);
+		return 0;
+	}
+
+	// copy with wrap around the end of the ring
+	uint32_t start = head & (LOG_RING_SIZE - 1);
+	uint32_t first = LOG_RING_SIZE - start;
+
+	if(first > (uint32_t)len) first = len;
+	memcpy(&ring[start], data, first);
+	memcpy(ring, data + first, len - first);
+
+	head += len;
+	log_kick();
+
+	taskEXIT_CRITICAL_FROM_ISR(state);
+	return len;
+}
+
+/***************************************************************
+ * Format message and write it into the ring
+ * Message of level below the module level is skipped before
+ * formatting, long message is cut to LOG_LINE_SIZE - 1
+ ***************************************************************/
+
+void log_printf(uint8_t level, log_module_t module, const char *fmt, ...)
+{
+	char line[LOG_LINE_SIZE];
+	va_list args;
+
+	if(module >= LOG_MOD_COUNT || level < levels[module]) return;
+
+	va_start(args, fmt);
+	int len = vsnprintf(line, sizeof(line), fmt, args);
+	va_end(args);
+
+	if(len < 0) return;
+	if(len >= (int)sizeof(line)) len = sizeof(line) - 1;
+
+	log_write(line, len);
+}
+
+/***************************************************************
+ * DMA transfer is finished, send the next part of the ring
+ ***************************************************************/
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+	if(huart != log_huart) return;
+
+	UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+	tail += tx_len;
+	tx_len = 0;
+	log_kick();
+	taskEXIT_CRITICAL_FROM_ISR(state);
+}
+
+/***************************************************************
+ * UART error, the running part is lost, continue with the next
+ ***************************************************************/
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+	// only errors which stopped the TX transfer
+	if(huart != log_huart || huart->gState != HAL_UART_STATE_READY) return;
+
+	UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+	tail += tx_len;
+	tx_len = 0;
+	log_kick();
+	taskEXIT_CRITICAL_FROM_ISR(state);
+}
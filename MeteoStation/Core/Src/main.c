@@ -35,8 +35,6 @@
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
 
-#define DWT_CTRL	(*(volatile uint32_t*)0xE0001000)
-
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -52,10 +50,13 @@ DMA_HandleTypeDef hdma_sdio_tx;
 DMA_HandleTypeDef hdma_sdio_rx;
 
 SPI_HandleTypeDef hspi1;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
 
 TIM_HandleTypeDef htim2;
 
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_tx;
 
 /* USER CODE BEGIN PV */
 
@@ -100,7 +101,8 @@ uint8_t spi_rx_data[6];
 
 // handlers
 TaskHandle_t handle_rtc_task, handle_bme280_task, handle_lcd_task, handle_sd_task, handle_esp32_send;
-QueueHandle_t q_bme280, q_lcd, q_sd, q_esp32;
+QueueHandle_t q_bme280;
+sample_sub_t *sub_lcd, *sub_esp32, *sub_sd;
 SemaphoreHandle_t i2cMutex, spiMutex;
 
 /* USER CODE END 0 */
@@ -129,6 +131,9 @@ int main(void)
 
   /* USER CODE BEGIN SysInit */
 
+  // Cycle counter for microsecond delays, LCD uses it from MX_GPIO_Init
+  dwt_init();
+
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
@@ -142,43 +147,55 @@ int main(void)
   MX_SPI1_Init();
   /* USER CODE BEGIN 2 */
 
+  /* Logger: printf and LOG_x are sent by USART2 TX DMA */
+  log_init(&huart2);
+
+  /* ESP32 link: SPI1 TX/RX DMA with READY handshake on PC4 */
+  esp32_link_init(&hspi1);
+
+  /* I2C1 transport for BME280 and DS1307 */
+  if(i2c_bus_init() != HAL_OK)
+  {
+	  Error_Handler();
+  }
+
   /* BME280 initialization */
   if(bme280_init() != HAL_OK)
   {
-	  HAL_UART_Transmit(&huart2, "BME280_initialization is failed\n", 100, portMAX_DELAY);
+	  LOG_ERROR(LOG_MOD_MAIN, "BME280_initialization is failed\r\n");
   }
   else
   {
-	  HAL_UART_Transmit(&huart2, "BME280_initialization is OK\n", 100, portMAX_DELAY);
+	  LOG_INFO(LOG_MOD_MAIN, "BME280_initialization is OK\r\n");
   }
 
   // get first data
   if(bme280_get_data(&measuring) != HAL_OK)
   {
-	  HAL_UART_Transmit(&huart2, "BME280_get_data is failed\n", 100, portMAX_DELAY);
+	  LOG_ERROR(LOG_MOD_MAIN, "BME280_get_data is failed\r\n");
   }
   else
   {
-	  HAL_UART_Transmit(&huart2, "BME280_get_data is OK\n", 100, portMAX_DELAY);
+	  LOG_INFO(LOG_MOD_MAIN, "BME280_get_data is OK\r\n");
   }
   /* DS1307 initialization */
   if(ds1307_init() != HAL_OK)
   {
-	  HAL_UART_Transmit(&huart2, "DS1307_initialization is failed\n", 100, portMAX_DELAY);
+	  LOG_ERROR(LOG_MOD_MAIN, "DS1307_initialization is failed\r\n");
   }
   else
   {
-	  HAL_UART_Transmit(&huart2, "DS1307_initialization is OK\n", 100, portMAX_DELAY);
+	  LOG_INFO(LOG_MOD_MAIN, "DS1307_initialization is OK\r\n");
   }
 
   /* SET CURR DATA */
+  if(esp32_link_boot_receive(spi_rx_data, sizeof(spi_rx_data)) != HAL_OK)
+  {
+	  // ESP32 is not ready, DS1307 keeps its time
+	  LOG_WARN(LOG_MOD_MAIN, "ESP32 time is not received\r\n");
+  }
+  else
   {
-	  while(HAL_GPIO_ReadPin(GPIOC, GPIO_PIN_4) != 1)
-	  {
-		  HAL_Delay(10);
-	  }
-	  HAL_SPI_Receive(&hspi1, spi_rx_data, sizeof(spi_rx_data), HAL_MAX_DELAY);
-
 	  curr_date.day = SUNDAY;
 	  curr_date.date = spi_rx_data[3];
 	  curr_date.month = spi_rx_data[4];
@@ -191,24 +208,24 @@ int main(void)
 
 	  prev_date.prev_month = spi_rx_data[4] - 1;
 	  prev_date.prev_date = spi_rx_data[3] - 1;
-  }
 
-  if(ds1307_set_current_date(&curr_date) != HAL_OK)
-  {
-	  HAL_UART_Transmit(&huart2, "DS1307_set_date is failed\n", 100, portMAX_DELAY);
-  }
-  else
-  {
-	  HAL_UART_Transmit(&huart2, "DS1307_set_date is OK\n", 100, portMAX_DELAY);
-  }
+	  if(ds1307_set_current_date(&curr_date) != HAL_OK)
+	  {
+		  LOG_ERROR(LOG_MOD_MAIN, "DS1307_set_date is failed\r\n");
+	  }
+	  else
+	  {
+		  LOG_INFO(LOG_MOD_MAIN, "DS1307_set_date is OK\r\n");
+	  }
 
-  if(ds1307_set_current_time(&curr_time) != HAL_OK)
-  {
-	  HAL_UART_Transmit(&huart2, "DS1307_set_time is failed\n", 100, portMAX_DELAY);
-  }
-  else
-  {
-	  HAL_UART_Transmit(&huart2, "DS1307_set_time is OK\n", 100, portMAX_DELAY);
+	  if(ds1307_set_current_time(&curr_time) != HAL_OK)
+	  {
+		  LOG_ERROR(LOG_MOD_MAIN, "DS1307_set_time is failed\r\n");
+	  }
+	  else
+	  {
+		  LOG_INFO(LOG_MOD_MAIN, "DS1307_set_time is OK\r\n");
+	  }
   }
 
   // /LOGS creation
@@ -219,9 +236,6 @@ int main(void)
   }
 
 #if SEGGER_UART_REC
-  // Enable the CYCCNT counter.
-  DWT_CTRL |= (1 << 0);
-
   // Enable SEGGER UART_VIEW
   SEGGER_UART_init(500000);
 
@@ -247,18 +261,21 @@ int main(void)
   status = xTaskCreate(sd_task, "sd_task", 512, NULL, 5, &handle_sd_task);
   configASSERT(status == pdPASS);
 
-  // Create 3 queue for rtc, bme280 and ( lcd & sd )
+  // Create queue for rtc -> bme280
   q_bme280 = xQueueCreate(1, sizeof(meteo_msg_t));
   configASSERT(q_bme280 != NULL);
 
-  q_lcd = xQueueCreate(1, sizeof(meteo_msg_t));
-  configASSERT(q_lcd != NULL);
+  // Create sample bus: bme280 -> ( lcd & esp32 & sd ), each consumer reads independently
+  sample_bus_init();
 
-  q_esp32 = xQueueCreate(1, sizeof(meteo_msg_t));
-  configASSERT(q_esp32 != NULL);
+  sub_lcd = sample_bus_subscribe();
+  configASSERT(sub_lcd != NULL);
 
-  q_sd = xQueueCreate(1, sizeof(meteo_msg_t));
-  configASSERT(q_sd != NULL);
+  sub_esp32 = sample_bus_subscribe();
+  configASSERT(sub_esp32 != NULL);
+
+  sub_sd = sample_bus_subscribe();
+  configASSERT(sub_sd != NULL);
 
   i2cMutex = xSemaphoreCreateMutex();
   configASSERT(i2cMutex != NULL);
@@ -269,8 +286,9 @@ int main(void)
   xSemaphoreGive(i2cMutex);
   xSemaphoreGive(spiMutex);
 
-  /* Timer 2 initialization */
+  /* Timer 2 initialization, it is also time base of software clock */
   __HAL_TIM_SET_COUNTER(&htim2, 0);
+  sw_clock_init(&htim2);
   HAL_TIM_Base_Start_IT(&htim2);
 
   // Start the freeRTOS scheduler
@@ -442,7 +460,7 @@ static void MX_SPI1_Init(void)
   hspi1.Init.CLKPolarity = SPI_POLARITY_LOW;
   hspi1.Init.CLKPhase = SPI_PHASE_2EDGE;
   hspi1.Init.NSS = SPI_NSS_HARD_OUTPUT;
-  hspi1.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_256;
+  hspi1.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_16;
   hspi1.Init.FirstBit = SPI_FIRSTBIT_MSB;
   hspi1.Init.TIMode = SPI_TIMODE_DISABLE;
   hspi1.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
@@ -542,12 +560,22 @@ static void MX_DMA_Init(void)
 {
 
   /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
   __HAL_RCC_DMA2_CLK_ENABLE();
 
   /* DMA interrupt init */
+  /* DMA1_Stream6_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 6, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+  /* DMA2_Stream0_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 6, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
   /* DMA2_Stream3_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, 7, 0);
   HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
+  /* DMA2_Stream5_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Stream5_IRQn, 6, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream5_IRQn);
   /* DMA2_Stream6_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA2_Stream6_IRQn, 7, 0);
   HAL_NVIC_EnableIRQ(DMA2_Stream6_IRQn);
@@ -582,8 +610,8 @@ static void MX_GPIO_Init(void)
 
   /*Configure GPIO pin : PC4 */
   GPIO_InitStruct.Pin = GPIO_PIN_4;
-  GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
-  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_PULLDOWN;
   HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
 
   /*Configure GPIO pin : BOOT1_Pin */
@@ -605,6 +633,10 @@ static void MX_GPIO_Init(void)
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
+  /* EXTI interrupt init*/
+  HAL_NVIC_SetPriority(EXTI4_IRQn, 6, 0);
+  HAL_NVIC_EnableIRQ(EXTI4_IRQn);
+
 /* USER CODE BEGIN MX_GPIO_Init_2 */
   	 /*Configure GPIO pin : PD14 */
   GPIO_InitStruct.Pin = GPIO_PIN_13;
@@ -697,7 +729,7 @@ static void MX_GPIO_Init(void)
 
 int _write(int fd, unsigned char *buf, int len) {
   if (fd == 1 || fd == 2) {
-    HAL_UART_Transmit(&huart2, buf, len, HAL_MAX_DELAY);  // Print to the UART
+    log_write((const char*)buf, len);  // Print to the UART through logger ring, never blocks
   }
   return len;
 }
@@ -743,6 +775,7 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
 
   if(htim->Instance == TIM2)
   {
+	  sw_clock_period_elapsed();
 	  HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_15);
 	  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 	  xTaskNotifyFromISR(handle_rtc_task, 0, eNoAction, &xHigherPriorityTaskWoken);
@@ -0,0 +1,4 @@
+/* SPI frame format is shared with the ESP32 firmware, source is common/meteo_frame.c
+ * CubeIDE builds only folders of this project, so Core compiles the shared file from here
+ */
+#include "../../../common/meteo_frame.c"
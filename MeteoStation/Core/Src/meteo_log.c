@@ -0,0 +1,108 @@
+#include "meteo_log.h"
+#include <string.h>
+
+/* block must fill exactly one sector */
+typedef char meteo_log_block_size_check[(sizeof(meteo_log_block_t) == METEO_LOG_BLOCK_SIZE) ? 1 : -1];
+
+/* CRC32 reflected polynomial 0xEDB88320, table for 4 bits */
+static const uint32_t crc32_table[16] =
+{
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+	0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+	0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+/***************************************************************
+ * Calculate CRC32 of data
+ * Start with crc = 0, continue with result of previous call
+ ***************************************************************/
+
+uint32_t meteo_log_crc32(uint32_t crc, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+
+	crc = ~crc;
+	while(len--)
+	{
+		crc ^= *p++;
+		crc = (crc >> 4) ^ crc32_table[crc & 0x0F];
+		crc = (crc >> 4) ^ crc32_table[crc & 0x0F];
+	}
+
+	return ~crc;
+}
+
+/***************************************************************
+ * CRC32 of block, crc field of header is excluded
+ ***************************************************************/
+
+static uint32_t meteo_log_block_crc(const meteo_log_block_t *block)
+{
+	const uint8_t *p = (const uint8_t*)block;
+	size_t crc_offset = offsetof(meteo_log_header_t, crc);
+
+	uint32_t crc = meteo_log_crc32(0, p, crc_offset);
+	return meteo_log_crc32(crc, p + sizeof(meteo_log_header_t), METEO_LOG_BLOCK_SIZE - sizeof(meteo_log_header_t));
+}
+
+/***************************************************************
+ * Prepare empty block
+ ***************************************************************/
+
+void meteo_log_block_init(meteo_log_block_t *block)
+{
+	memset(block, 0, sizeof(meteo_log_block_t));
+
+	block->header.magic = METEO_LOG_MAGIC;
+	block->header.version = METEO_LOG_VERSION;
+	block->header.record_size = sizeof(meteo_msg_t);
+}
+
+/***************************************************************
+ * Add record into block
+ * Returns 1 if record was added, 0 if block is full
+ ***************************************************************/
+
+int meteo_log_block_add(meteo_log_block_t *block, const meteo_msg_t *msg)
+{
+	if(meteo_log_block_full(block)) return 0;
+
+	if(block->header.count == 0) block->header.first_ts = msg->epoch;
+
+	block->records[block->header.count++] = *msg;
+	return 1;
+}
+
+/***************************************************************
+ * Check if block has no space for next record
+ ***************************************************************/
+
+int meteo_log_block_full(const meteo_log_block_t *block)
+{
+	return block->header.count >= METEO_LOG_RECORDS;
+}
+
+/***************************************************************
+ * Write crc of block into header, do it before writing to card
+ ***************************************************************/
+
+void meteo_log_block_seal(meteo_log_block_t *block)
+{
+	block->header.crc = meteo_log_block_crc(block);
+}
+
+/***************************************************************
+ * Check block read from card
+ * Returns 1 if magic, version, count and crc are valid
+ ***************************************************************/
+
+int meteo_log_block_check(const meteo_log_block_t *block)
+{
+	if(block->header.magic != METEO_LOG_MAGIC) return 0;
+	if(block->header.version != METEO_LOG_VERSION) return 0;
+	if(block->header.record_size != sizeof(meteo_msg_t)) return 0;
+	if(block->header.count > METEO_LOG_RECORDS) return 0;
+
+	return block->header.crc == meteo_log_block_crc(block);
+}
@@ -0,0 +1,165 @@
+#include "meteo_msg.h"
+#include "ds1307.h"
+#include <stdio.h>
+
+#define SECONDS_PER_DAY		86400UL
+
+/***************************************************************
+ * Number of days from 01.01.1970 to the date
+ * Year is full year ( 2026 ), month 1 - 12, date 1 - 31
+ ***************************************************************/
+
+static uint32_t days_from_civil(uint32_t year, uint32_t month, uint32_t date)
+{
+	// year starts in March, so February 29 is the last day of year
+	year -= (month <= 2);
+	uint32_t era = year / 400;
+	uint32_t yoe = year - era * 400;
+	uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + date - 1;
+	uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + doe - 719468;
+}
+
+/***************************************************************
+ * Convert RTC date and time into epoch seconds
+ * RTC year is 00 - 99 ( 2000 - 2099 ), 12 hours format is
+ * converted to 24 hours
+ ***************************************************************/
+
+uint32_t meteo_epoch_from_rtc(const RTC_date_t *date, const RTC_time_t *time)
+{
+	uint32_t hours = time->hours;
+
+	if(time->time_format != DS1307_TIME_FORMAT_24HOUR)
+	{
+		// 12 AM -> 0, 1 PM -> 13
+		hours %= 12;
+		if(time->time_format == DS1307_TIME_FORMAT_12HOUR_PM) hours += 12;
+	}
+
+	return days_from_civil(2000 + date->year, date->month, date->date) * SECONDS_PER_DAY
+			+ hours * 3600 + time->minutes * 60 + time->seconds;
+}
+
+/***************************************************************
+ * Convert epoch seconds into RTC date and time
+ * Time is in 24 hours format, day of week is SUNDAY - SATURDAY
+ ***************************************************************/
+
+void meteo_epoch_to_rtc(uint32_t epoch, RTC_date_t *date, RTC_time_t *time)
+{
+	uint32_t days = epoch / SECONDS_PER_DAY;
+	uint32_t secs = epoch % SECONDS_PER_DAY;
+
+	time->hours = secs / 3600;
+	time->minutes = (secs / 60) % 60;
+	time->seconds = secs % 60;
+	time->time_format = DS1307_TIME_FORMAT_24HOUR;
+
+	// 01.01.1970 was thursday
+	date->day = ((days + 4) % 7) + SUNDAY;
+
+	// inverse of days_from_civil
+	uint32_t z = days + 719468;
+	uint32_t era = z / 146097;
+	uint32_t doe = z - era * 146097;
+	uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	uint32_t mp = (5 * doy + 2) / 153;
+	uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+	uint32_t year = yoe + era * 400 + (month <= 2);
+
+	date->date = doy - (153 * mp + 2) / 5 + 1;
+	date->month = month;
+	date->year = year - 2000;
+}
+
+/***************************************************************
+ * Convert DegC into 0.01 DegC with rounding
+ ***************************************************************/
+
+int16_t meteo_temperature_to_fixed(double temperature)
+{
+	return (int16_t)(temperature * 100.0 + (temperature < 0 ? -0.5 : 0.5));
+}
+
+/***************************************************************
+ * Convert %rH into 0.01 %rH with rounding
+ ***************************************************************/
+
+uint16_t meteo_humidity_to_fixed(double humidity)
+{
+	if(humidity < 0) return 0;
+	return (uint16_t)(humidity * 100.0 + 0.5);
+}
+
+/***************************************************************
+ * Convert hPa into Pa with rounding
+ ***************************************************************/
+
+uint32_t meteo_pressure_to_fixed(double pressure)
+{
+	if(pressure < 0) return 0;
+	return (uint32_t)(pressure * 100.0 + 0.5);
+}
+
+/***************************************************************
+ * Get temperature in DegC
+ ***************************************************************/
+
+float meteo_temperature(const meteo_msg_t *msg)
+{
+	return msg->temperature / 100.0f;
+}
+
+/***************************************************************
+ * Get humidity in %rH
+ ***************************************************************/
+
+float meteo_humidity(const meteo_msg_t *msg)
+{
+	return msg->humidity / 100.0f;
+}
+
+/***************************************************************
+ * Get pressure in hPa
+ ***************************************************************/
+
+float meteo_pressure(const meteo_msg_t *msg)
+{
+	return msg->pressure / 100.0f;
+}
+
+/***************************************************************
+ * Format sample for 2x16 LCD
+ * hh:mm:ssdd.mm.yy
+ * tt.t;ppp.p;hh.hh
+ ***************************************************************/
+
+void meteo_format_lcd(const meteo_msg_t *msg, char *line1, char *line2, size_t len)
+{
+	RTC_date_t date;
+	RTC_time_t time;
+
+	meteo_epoch_to_rtc(msg->epoch, &date, &time);
+
+	snprintf(line1, len, "%02d:%02d:%02d%02d.%02d.%02d", time.hours, time.minutes, time.seconds,
+			date.date, date.month, date.year);
+	snprintf(line2, len, "%02.1f;%03.1f;%02.2f", meteo_temperature(msg), meteo_pressure(msg), meteo_humidity(msg));
+}
+
+/***************************************************************
+ * Format sample as CSV line of day file
+ * hh:mm:ss;tt.t;ppp.p;hh.hh\r\n
+ * Returns length of line
+ ***************************************************************/
+
+int meteo_format_csv(const meteo_msg_t *msg, char *buf, size_t len)
+{
+	uint32_t secs = msg->epoch % SECONDS_PER_DAY;
+
+	return snprintf(buf, len, "%02lu:%02lu:%02lu;%02.1f;%03.1f;%02.2f\r\n",
+			secs / 3600, (secs / 60) % 60, secs % 60,
+			meteo_temperature(msg), meteo_pressure(msg), meteo_humidity(msg));
+}
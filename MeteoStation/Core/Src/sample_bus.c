@@ -0,0 +1,122 @@
+#include "sample_bus.h"
+
+/*
+ * One producer writes every sample once into the ring, consumers read it
+ * with their own cursor. Slow consumer loses its oldest samples and counts
+ * them, other consumers and the producer are never blocked by it.
+ */
+
+static meteo_msg_t ring[SAMPLE_BUS_DEPTH];
+static uint32_t head;	/* sequence number of the next published sample */
+
+static sample_sub_t subs[SAMPLE_BUS_MAX_SUBSCRIBERS];
+static uint8_t subs_count;
+
+/***************************************************************
+ * Initialize the sample bus
+ * Call before the subscribers are created
+ ***************************************************************/
+
+void sample_bus_init(void)
+{
+	head = 0;
+	subs_count = 0;
+}
+
+/***************************************************************
+ * Create new subscriber
+ * Call before vTaskStartScheduler
+ * Subscriber gets only samples published after this call
+ * Returns NULL if there is no free subscriber
+ ***************************************************************/
+
+sample_sub_t* sample_bus_subscribe(void)
+{
+	sample_sub_t *sub;
+
+	if(subs_count >= SAMPLE_BUS_MAX_SUBSCRIBERS) return NULL;
+
+	sub = &subs[subs_count];
+	sub->ready = xSemaphoreCreateBinary();
+	if(sub->ready == NULL) return NULL;
+
+	sub->cursor = head;
+	sub->dropped = 0;
+	subs_count++;
+
+	return sub;
+}
+
+/***************************************************************
+ * Publish sample to all subscribers
+ * Copies sample into the ring once and wakes every subscriber
+ * Never blocks
+ ***************************************************************/
+
+void sample_bus_publish(const meteo_msg_t *msg)
+{
+	taskENTER_CRITICAL();
+	ring[head % SAMPLE_BUS_DEPTH] = *msg;
+	head++;
+	taskEXIT_CRITICAL();
+
+	for(uint8_t i = 0; i < subs_count; i++)
+	{
+		xSemaphoreGive(subs[i].ready);
+	}
+}
+
+/***************************************************************
+ * Receive next sample of the subscriber
+ * Waits up to timeout in total if there is no new sample
+ * Skips samples which were overwritten and counts them as dropped
+ * Returns pdTRUE if sample was copied into msg
+ ***************************************************************/
+
+BaseType_t sample_bus_receive(sample_sub_t *sub, meteo_msg_t *msg, TickType_t timeout)
+{
+	TimeOut_t timeout_state;
+
+	vTaskSetTimeOutState(&timeout_state);
+
+	while(1)
+	{
+		taskENTER_CRITICAL();
+		if(sub->cursor != head)
+		{
+			// consumer is behind more than the ring, jump to the oldest sample
+			if(head - sub->cursor > SAMPLE_BUS_DEPTH)
+			{
+				sub->dropped += head - sub->cursor - SAMPLE_BUS_DEPTH;
+				sub->cursor = head - SAMPLE_BUS_DEPTH;
+			}
+
+			*msg = ring[sub->cursor % SAMPLE_BUS_DEPTH];
+			sub->cursor++;
+			taskEXIT_CRITICAL();
+			return pdTRUE;
+		}
+		taskEXIT_CRITICAL();
+
+		// wait for the next publish, give of a sample which was already read
+		// wakes the task without sample, next wait gets only the ticks left
+		if(xTaskCheckForTimeOut(&timeout_state, &timeout) == pdTRUE)
+		{
+			return pdFALSE;
+		}
+
+		if(xSemaphoreTake(sub->ready, timeout) != pdTRUE)
+		{
+			return pdFALSE;
+		}
+	}
+}
+
+/***************************************************************
+ * Get number of samples which subscriber lost
+ ***************************************************************/
+
+uint32_t sample_bus_dropped(sample_sub_t *sub)
+{
+	return sub->dropped;
+}
@@ -1,13 +1,46 @@
 #include "fatfs.h"
+#include "sd_functions.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include "bsp_driver_sd.h"
+#include "sd_io_stats.h"
+#include "meteo_msg.h"
+#include "meteo_log.h"
+#include "logger.h"
 
 extern char SDPath[4];
 FATFS fs;
 BSP_SD_CardInfo myCardInfo;
 
+// state of the persistent logging session
+static FIL log_file;
+static uint8_t sd_mounted;
+static uint8_t log_file_open;
+static uint32_t log_unsynced;
+
+// counters of the logging session for sd_log_print_stats
+static uint32_t log_fcalls;
+static uint32_t log_bytes;
+
+// path of the log file, tick when the oldest data not written to the card was added
+static char log_path[32];
+static uint32_t log_pending_tick;
+
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_BIN
+// block of the binary log which is filled now, its number in file and path of day index
+static meteo_log_block_t log_block;
+static uint32_t log_block_num;
+static char log_index_path[32];
+#else
+// coalescing buffer of the CSV log, ends at SD_LOG_BUF_SIZE aligned offset of the file
+static char log_buf[SD_LOG_BUF_SIZE];
+static UINT log_buf_len;
+#endif
+
+// block buffer of sd_log_read_range
+static meteo_log_block_t read_block;
+
 /***************************************************************
  * Get the total and free space of the SD card in KB
  * Uses FatFs f_getfree to calculate available clusters
@@ -27,7 +60,7 @@ int sd_get_space_kb(void) {
 	// Convert to KB
 	total_kb = tot_sect / 2;
 	free_kb = fre_sect / 2;
-	printf("💾 Total: %lu KB, Free: %lu KB\r\n", total_kb, free_kb);
+	LOG_INFO(LOG_MOD_SD, "💾 Total: %lu KB, Free: %lu KB\r\n", total_kb, free_kb);
 	return FR_OK;
 }
 
@@ -40,37 +73,42 @@ int sd_get_space_kb(void) {
 int sd_mount(void) {
 	FRESULT res;
 
-	printf("Attempting mount at %s...\r\n", SDPath);
+	LOG_DEBUG(LOG_MOD_SD, "Attempting mount at %s...\r\n", SDPath);
 	res = f_mount(&fs, SDPath, 1);
 	if (res == FR_OK)
 	{
-		printf("SD card mounted successfully at %s\r\n", SDPath);
+		sd_mounted = 1;
+		LOG_INFO(LOG_MOD_SD, "SD card mounted successfully at %s\r\n", SDPath);
 
 		// Capacity and free space reporting
 		sd_get_space_kb();
 
 		// Get Card Info
 		BSP_SD_GetCardInfo(&myCardInfo);
-		printf("Card Type: %s\r\n", myCardInfo.CardType ? "SDSC" : "SDHC/SDXC");
-		printf("Card Version: %s\r\n", myCardInfo.CardVersion ? "CARD_V1_X" : "CARD_V2_X");
-		printf("Card Class: %lu\r\n", myCardInfo.Class);
+		LOG_INFO(LOG_MOD_SD, "Card Type: %s\r\n", myCardInfo.CardType ? "SDSC" : "SDHC/SDXC");
+		LOG_INFO(LOG_MOD_SD, "Card Version: %s\r\n", myCardInfo.CardVersion ? "CARD_V1_X" : "CARD_V2_X");
+		LOG_INFO(LOG_MOD_SD, "Card Class: %lu\r\n", myCardInfo.Class);
 		return FR_OK;
 	}
 
 	// Any other mount error
-	printf("Mount failed with code: %d\r\n", res);
+	LOG_ERROR(LOG_MOD_SD, "Mount failed with code: %d\r\n", res);
 	return res;
 }
 
 /***************************************************************
  * Unmount the SD card
+ * Closes the log file if it is still open
  * Calls f_mount with NULL to unmount
  * Prints success/failure status
  ***************************************************************/
 
 int sd_unmount(void) {
+	sd_log_close();
+
 	FRESULT res = f_mount(NULL, SDPath, 1);
-	printf("SD card unmounted: %s\r\n\r\n\r\n", (res == FR_OK) ? "OK" : "Failed");
+	sd_mounted = 0;
+	LOG_INFO(LOG_MOD_SD, "SD card unmounted: %s\r\n\r\n\r\n", (res == FR_OK) ? "OK" : "Failed");
 	return res;
 }
 
@@ -92,7 +130,7 @@ int sd_write_file(const char *filename, const char *text) {
 	// Write data using f_write
 	res = f_write(&file, text, strlen(text), &bw);
 	f_close(&file);
-	printf("Write %u bytes to %s\r\n", bw, filename);
+	LOG_DEBUG(LOG_MOD_SD, "Write %u bytes to %s\r\n", bw, filename);
 	return (res == FR_OK && bw == strlen(text)) ? FR_OK : FR_DISK_ERR;
 }
 
@@ -122,10 +160,518 @@ int sd_append_file(const char *filename, const char *text) {
 	// Write new data
 	res = f_write(&file, text, strlen(text), &bw);
 	f_close(&file);
-	printf("Appended %u bytes to %s\r\n", bw, filename);
+	LOG_DEBUG(LOG_MOD_SD, "Appended %u bytes to %s\r\n", bw, filename);
 	return (res == FR_OK && bw == strlen(text)) ? FR_OK : FR_DISK_ERR;
 }
 
+/***************************************************************
+ * Check if the SD card filesystem is mounted
+ * Returns 1 after a successful sd_mount, 0 after sd_unmount
+ ***************************************************************/
+
+int sd_is_mounted(void) {
+	return sd_mounted;
+}
+
+/***************************************************************
+ * Make path of day index from path of day log
+ * Extension of log is replaced by SD_LOG_INDEX_EXT
+ ***************************************************************/
+
+static void sd_log_index_path(const char *filename, char *path, size_t len) {
+	const char *dot = strrchr(filename, '.');
+	int name_len = dot ? (int)(dot - filename) : (int)strlen(filename);
+
+	snprintf(path, len, "%.*s.%s", name_len, filename, SD_LOG_INDEX_EXT);
+}
+
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_BIN
+/***************************************************************
+ * Continue the last block of the binary log after reopening
+ * Reads the last block of the open log file
+ * Valid block with free space is loaded to be filled further,
+ * otherwise new block starts after the last full block
+ ***************************************************************/
+
+static void sd_log_resume_block(void) {
+	UINT br;
+	meteo_log_block_init(&log_block);
+	log_block_num = f_size(&log_file) / METEO_LOG_BLOCK_SIZE;
+
+	if (log_block_num == 0) return;
+
+	log_fcalls += 2;
+	if (f_lseek(&log_file, (log_block_num - 1) * METEO_LOG_BLOCK_SIZE) != FR_OK ||
+		f_read(&log_file, &read_block, METEO_LOG_BLOCK_SIZE, &br) != FR_OK || br != METEO_LOG_BLOCK_SIZE) {
+		return;
+	}
+
+	if (meteo_log_block_check(&read_block) && !meteo_log_block_full(&read_block)) {
+		log_block = read_block;
+		log_block_num--;
+	}
+}
+
+/***************************************************************
+ * Write first timestamp of the block into day index
+ * Entry is written only if index has entries of all previous
+ * blocks, otherwise readers find the block by its header
+ ***************************************************************/
+
+static int sd_log_write_index(uint32_t block_num, uint32_t first_ts) {
+	FIL index;
+	UINT bw;
+
+	FRESULT res = f_open(&index, log_index_path, FA_OPEN_ALWAYS | FA_WRITE);
+	log_fcalls++;
+	if (res != FR_OK) {
+		LOG_ERROR(LOG_MOD_SD, "Open index %s failed with code: %d\r\n", log_index_path, res);
+		return res;
+	}
+
+	if (f_size(&index) < block_num * METEO_LOG_INDEX_ENTRY) {
+		f_close(&index);
+		log_fcalls++;
+		LOG_WARN(LOG_MOD_SD, "Index %s is behind the log, block %lu is not indexed\r\n", log_index_path, block_num);
+		return FR_OK;
+	}
+
+	res = f_lseek(&index, block_num * METEO_LOG_INDEX_ENTRY);
+	if (res == FR_OK) res = f_write(&index, &first_ts, METEO_LOG_INDEX_ENTRY, &bw);
+	log_fcalls += 2;
+	log_bytes += bw;
+
+	FRESULT close_res = f_close(&index);
+	log_fcalls++;
+	if (res == FR_OK) res = close_res;
+	if (res != FR_OK) LOG_ERROR(LOG_MOD_SD, "Write index %s failed with code: %d\r\n", log_index_path, res);
+	return res;
+}
+
+/***************************************************************
+ * Write the filled block into its sector of the binary log
+ * Block is written again with every sync until it is full,
+ * the header keeps the number of valid records and crc
+ ***************************************************************/
+
+static int sd_log_write_block(void) {
+	UINT bw;
+
+	meteo_log_block_seal(&log_block);
+
+	FRESULT res = f_lseek(&log_file, log_block_num * METEO_LOG_BLOCK_SIZE);
+	log_fcalls++;
+	if (res == FR_OK) {
+		res = f_write(&log_file, &log_block, METEO_LOG_BLOCK_SIZE, &bw);
+		log_fcalls++;
+		log_bytes += bw;
+		if (res == FR_OK && bw != METEO_LOG_BLOCK_SIZE) res = FR_DISK_ERR;
+	}
+	if (res == FR_OK) {
+		res = f_sync(&log_file);
+		log_fcalls++;
+	}
+
+	if (res != FR_OK) LOG_ERROR(LOG_MOD_SD, "Write log block %lu failed with code: %d\r\n", log_block_num, res);
+	return res;
+}
+#endif
+
+/***************************************************************
+ * Prepare contiguous space of new log file for the full day
+ * f_expand finds SD_LOG_PREALLOC_SIZE of contiguous free clusters
+ * and makes them the start of the next allocation, appends take
+ * them cluster by cluster, so the file is contiguous while its
+ * size is always the end of data: every f_sync writes it and a
+ * file which was not closed is continued at its size
+ * Clusters are not reserved, other files written in the same
+ * time are allocated in the extent too ( day index of binary log
+ * takes its first cluster, the extent has one cluster more )
+ * File grows from any free cluster if there is no contiguous space
+ ***************************************************************/
+
+static void sd_log_prealloc(void) {
+	FSIZE_t size = SD_LOG_PREALLOC_SIZE;
+
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_BIN
+	size += (FSIZE_t)fs.csize * _MIN_SS;
+#endif
+
+	FRESULT res = f_expand(&log_file, size, 0);
+	log_fcalls++;
+
+	LOG_INFO(LOG_MOD_SD, "Log extent of %lu bytes: %s\r\n", (unsigned long)size, (res == FR_OK) ? "OK" : "Not found");
+}
+
+/***************************************************************
+ * Open the log file of the persistent logging session
+ * Closes the previous log file if it is still open
+ * Opens file with FA_OPEN_ALWAYS | FA_WRITE | FA_READ
+ * Contiguous space for the full day is prepared for new file, file
+ * size is the end of data also in a file which was not closed
+ * File of the day which is opened again isn't prepared again
+ * ( f_expand needs empty file ), it grows from its last cluster
+ * and stays contiguous while the next clusters are free
+ * Moves the file pointer to the end once, the file stays open
+ * for the next sd_log_append calls
+ * Binary format continues the last block of the file
+ * CSV buffer kept after sd_log_discard is written into its file
+ ***************************************************************/
+
+int sd_log_open(const char *filename) {
+	sd_log_close();
+
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_CSV
+	// Buffer of other day is written into its file first
+	if (log_buf_len && strcmp(log_path, filename) != 0) {
+		char prev_path[sizeof(log_path)];
+
+		strcpy(prev_path, log_path);
+		if (sd_log_open(prev_path) == FR_OK) sd_log_close();
+		log_buf_len = 0;
+	}
+#endif
+
+	// Open file for append
+	FRESULT res = f_open(&log_file, filename, FA_OPEN_ALWAYS | FA_WRITE | FA_READ);
+	log_fcalls++;
+	if (res != FR_OK) {
+		LOG_ERROR(LOG_MOD_SD, "Open log %s failed with code: %d\r\n", filename, res);
+		return res;
+	}
+
+	// Prepare contiguous space for new file
+	if (f_size(&log_file) == 0) {
+		sd_log_prealloc();
+	}
+
+	// Move pointer to end of data using f_lseek
+	res = f_lseek(&log_file, f_size(&log_file));
+	log_fcalls++;
+	if (res != FR_OK) {
+		f_close(&log_file);
+		LOG_ERROR(LOG_MOD_SD, "Seek log %s failed with code: %d\r\n", filename, res);
+		return res;
+	}
+
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_BIN
+	sd_log_index_path(filename, log_index_path, sizeof(log_index_path));
+	sd_log_resume_block();
+#endif
+
+	snprintf(log_path, sizeof(log_path), "%s", filename);
+	log_file_open = 1;
+	log_unsynced = 0;
+	LOG_INFO(LOG_MOD_SD, "Log %s opened at %lu bytes\r\n", filename, (unsigned long)f_size(&log_file));
+
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_CSV
+	// Write data which was buffered when the card was removed
+	if (log_buf_len) return sd_log_flush();
+#endif
+	return FR_OK;
+}
+
+/***************************************************************
+ * Append text to the open log file
+ * Text is collected in RAM buffer, buffer is written when it
+ * reaches SD_LOG_BUF_SIZE aligned offset of the file, so FatFs
+ * writes whole sectors without read-modify-write
+ * sd_log_flush writes the rest on age, day change and close
+ * Binary format doesn't use this buffer
+ ***************************************************************/
+
+int sd_log_append(const char *text) {
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_CSV
+	UINT len = strlen(text);
+
+	if (!log_file_open) return FR_NOT_ENABLED;
+
+	if (log_buf_len == 0) log_pending_tick = HAL_GetTick();
+
+	while (len) {
+		// Free space until the aligned offset
+		UINT room = SD_LOG_BUF_SIZE - (f_tell(&log_file) % SD_LOG_BUF_SIZE) - log_buf_len;
+		UINT n = (len < room) ? len : room;
+
+		memcpy(&log_buf[log_buf_len], text, n);
+		log_buf_len += n;
+		text += n;
+		len -= n;
+
+		if (n == room) {
+			FRESULT res = sd_log_flush();
+			if (res != FR_OK) return res;
+			if (len) log_pending_tick = HAL_GetTick();
+		}
+	}
+
+	return FR_OK;
+#else
+	(void)text;
+	return FR_INVALID_PARAMETER;
+#endif
+}
+
+/***************************************************************
+ * Write buffered data of the log file to the card
+ * CSV format: writes the buffer and calls f_sync, so directory
+ * entry and FAT are updated without reopening the file
+ * Binary format: writes the block with unsynced records
+ * Buffer is kept if writing failed
+ ***************************************************************/
+
+int sd_log_flush(void) {
+	if (!log_file_open) return FR_NOT_ENABLED;
+
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_BIN
+	if (!log_unsynced) return FR_OK;
+
+	log_unsynced = 0;
+	return sd_log_write_block();
+#else
+	UINT bw;
+
+	if (!log_buf_len) return FR_OK;
+
+	// Write buffer
+	FRESULT res = f_write(&log_file, log_buf, log_buf_len, &bw);
+	log_fcalls++;
+	log_bytes += bw;
+	if (res != FR_OK || bw != log_buf_len) {
+		LOG_ERROR(LOG_MOD_SD, "Append to log failed with code: %d\r\n", res);
+		return (res != FR_OK) ? res : FR_DISK_ERR;
+	}
+	log_buf_len = 0;
+
+	// Flush cached data and file size
+	res = f_sync(&log_file);
+	log_fcalls++;
+	if (res != FR_OK) {
+		LOG_ERROR(LOG_MOD_SD, "Sync log failed with code: %d\r\n", res);
+	}
+	return res;
+#endif
+}
+
+/***************************************************************
+ * Check if buffered data of the log file is older than
+ * SD_LOG_MAX_AGE_MS and has to be written by sd_log_flush
+ ***************************************************************/
+
+int sd_log_flush_due(void) {
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_BIN
+	uint32_t pending = log_unsynced;
+#else
+	uint32_t pending = log_buf_len;
+#endif
+
+	return log_file_open && pending && (HAL_GetTick() - log_pending_tick) >= SD_LOG_MAX_AGE_MS;
+}
+
+/***************************************************************
+ * Append sample record to the open log file
+ * CSV format: record is formatted as text line of sd_log_append
+ * Binary format: record is added into the block in RAM, the
+ * block is written on the sync policy and when it is full.
+ * First record of the block writes the block into day index
+ ***************************************************************/
+
+int sd_log_append_record(const meteo_msg_t *msg) {
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_BIN
+	FRESULT res = FR_OK;
+
+	if (!log_file_open) return FR_NOT_ENABLED;
+
+	if (log_block.header.count == 0) {
+		sd_log_write_index(log_block_num, msg->epoch);
+	}
+
+	meteo_log_block_add(&log_block, msg);
+	if (log_unsynced == 0) log_pending_tick = HAL_GetTick();
+
+	// Write the block on the sync policy and when it is full
+	if (meteo_log_block_full(&log_block) || ++log_unsynced >= SD_LOG_SYNC_INTERVAL) {
+		log_unsynced = 0;
+		res = sd_log_write_block();
+
+		if (meteo_log_block_full(&log_block)) {
+			log_block_num++;
+			meteo_log_block_init(&log_block);
+		}
+	}
+
+	return res;
+#else
+	char line[64];
+
+	meteo_format_csv(msg, line, sizeof(line));
+	return sd_log_append(line);
+#endif
+}
+
+/***************************************************************
+ * Close the log file of the persistent logging session
+ * Writes buffered data with sd_log_flush
+ * File has no clusters after end of data ( sd_log_prealloc )
+ * f_close syncs the pending data before closing
+ * Does nothing if no log file is open
+ ***************************************************************/
+
+int sd_log_close(void) {
+	if (!log_file_open) return FR_OK;
+
+	// Write data which was buffered after the last flush
+	sd_log_flush();
+
+	log_file_open = 0;
+	log_unsynced = 0;
+
+	FRESULT res = f_close(&log_file);
+	log_fcalls++;
+	LOG_INFO(LOG_MOD_SD, "Log closed: %s\r\n", (res == FR_OK) ? "OK" : "Failed");
+	return res;
+}
+
+/***************************************************************
+ * Drop the log file of the persistent logging session
+ * Used when the card was removed, nothing is written to the card
+ * CSV buffer is kept and written by the next sd_log_open
+ * Binary records added after the last f_sync are lost
+ ***************************************************************/
+
+void sd_log_discard(void) {
+	log_file_open = 0;
+	log_unsynced = 0;
+}
+
+/***************************************************************
+ * Check if the log file of the session is open
+ ***************************************************************/
+
+int sd_log_is_open(void) {
+	return log_file_open;
+}
+
+/***************************************************************
+ * Print the cost of the logging session
+ * Uses FatFs call and byte counters of the session and the
+ * sector counters of the SD I/O shim ( sd_io_stats.h )
+ * Prints the totals and the average per sample
+ ***************************************************************/
+
+void sd_log_print_stats(uint32_t samples) {
+#if SD_IO_STATS
+	sd_io_stats_t io;
+
+	if (samples == 0) return;
+
+	sd_io_stats_get(&io);
+	LOG_INFO(LOG_MOD_SD, "SD log: %lu samples, %lu f_* calls, %lu bytes written\r\n",
+			samples, log_fcalls, log_bytes);
+	LOG_INFO(LOG_MOD_SD, "SD I/O: %lu read cmds (%lu sectors), %lu write cmds (%lu sectors), %lu errors\r\n",
+			io.read_cmds, io.sectors_read, io.write_cmds, io.sectors_written, io.errors);
+	LOG_INFO(LOG_MOD_SD, "SD per sample: %lu.%02lu sectors, %lu.%02lu ms\r\n",
+			(io.sectors_read + io.sectors_written) / samples,
+			((io.sectors_read + io.sectors_written) * 100 / samples) % 100,
+			io.busy_ms / samples, (io.busy_ms * 100 / samples) % 100);
+#endif
+}
+
+/***************************************************************
+ * Read records of binary day log in time range
+ * Binary search in day index finds the last block starting
+ * not later than from, log is read from this sector
+ * Blocks after the index and blocks with bad crc are scanned
+ * by headers, reading stops after the first record later than to
+ * or at zero block of preallocated space ( files of old firmware )
+ * Cluster link map table makes seeks without FAT access
+ * File of the open logging session can't be read ( FR_LOCKED )
+ ***************************************************************/
+
+int sd_log_read_range(const char *filename, uint32_t from, uint32_t to, meteo_msg_t *records, int max_records, int *record_count) {
+	FIL file;
+	UINT br;
+	DWORD clmt[SD_LOG_CLMT_SIZE];
+	char index_path[32];
+	uint32_t start_block = 0;
+	uint32_t bad_blocks = 0;
+	int done = 0;
+	*record_count = 0;
+
+	// Binary search of start block in the day index
+	sd_log_index_path(filename, index_path, sizeof(index_path));
+	FRESULT res = f_open(&file, index_path, FA_READ);
+	if (res == FR_OK) {
+		uint32_t lo = 0, hi = f_size(&file) / METEO_LOG_INDEX_ENTRY;
+
+		while (lo < hi) {
+			uint32_t mid = lo + (hi - lo) / 2;
+			uint32_t ts;
+
+			if (f_lseek(&file, mid * METEO_LOG_INDEX_ENTRY) != FR_OK ||
+				f_read(&file, &ts, METEO_LOG_INDEX_ENTRY, &br) != FR_OK || br != METEO_LOG_INDEX_ENTRY) {
+				lo = 0;
+				break;
+			}
+
+			if (ts <= from) lo = mid + 1;
+			else hi = mid;
+		}
+		start_block = lo ? lo - 1 : 0;
+		f_close(&file);
+	} else {
+		LOG_WARN(LOG_MOD_SD, "Index %s can't be opened (%d), log is read from start\r\n", index_path, res);
+	}
+
+	// Open binary log
+	res = f_open(&file, filename, FA_READ);
+	if (res != FR_OK) {
+		LOG_ERROR(LOG_MOD_SD, "Failed to open log: %s (%d)\r\n", filename, res);
+		return res;
+	}
+
+	// Build cluster link map table, fragmented file is read with FAT
+	file.cltbl = clmt;
+	clmt[0] = SD_LOG_CLMT_SIZE;
+	if (f_lseek(&file, CREATE_LINKMAP) != FR_OK) {
+		file.cltbl = NULL;
+	}
+
+	res = f_lseek(&file, start_block * METEO_LOG_BLOCK_SIZE);
+
+	// Read blocks until the end of range
+	while (res == FR_OK && !done && *record_count < max_records) {
+		res = f_read(&file, &read_block, METEO_LOG_BLOCK_SIZE, &br);
+		if (res != FR_OK || br != METEO_LOG_BLOCK_SIZE) break;
+
+		// Zero filled preallocated space after end of data ( files of old firmware )
+		if (read_block.header.magic == 0) break;
+
+		if (!meteo_log_block_check(&read_block)) {
+			bad_blocks++;
+			continue;
+		}
+
+		if (read_block.header.first_ts > to) break;
+
+		for (int i = 0; i < read_block.header.count && *record_count < max_records; i++) {
+			const meteo_msg_t *rec = &read_block.records[i];
+
+			if (rec->epoch < from) continue;
+			if (rec->epoch > to) {
+				done = 1;
+				break;
+			}
+			records[(*record_count)++] = *rec;
+		}
+	}
+
+	f_close(&file);
+
+	LOG_INFO(LOG_MOD_SD, "Read %d records from %s, %lu bad blocks\r\n", *record_count, filename, bad_blocks);
+	return res;
+}
+
 /***************************************************************
  * Read data from a file into a buffer
  * Opens file for reading
@@ -141,14 +687,14 @@ int sd_read_file(const char *filename, char *buffer, UINT bufsize, UINT *bytes_r
 	// Open file for reading
 	FRESULT res = f_open(&file, filename, FA_READ);
 	if (res != FR_OK) {
-		printf("f_open failed with code: %d\r\n", res);
+		LOG_ERROR(LOG_MOD_SD, "f_open failed with code: %d\r\n", res);
 		return res;
 	}
 
 	// Read file content using f_read
 	res = f_read(&file, buffer, bufsize - 1, bytes_read);
 	if (res != FR_OK) {
-		printf("f_read failed with code: %d\r\n", res);
+		LOG_ERROR(LOG_MOD_SD, "f_read failed with code: %d\r\n", res);
 		f_close(&file);
 		return res;
 	}
@@ -158,21 +704,14 @@ int sd_read_file(const char *filename, char *buffer, UINT bufsize, UINT *bytes_r
 
 	res = f_close(&file);
 	if (res != FR_OK) {
-		printf("f_close failed with code: %d\r\n", res);
+		LOG_ERROR(LOG_MOD_SD, "f_close failed with code: %d\r\n", res);
 		return res;
 	}
 
-	printf("Read %u bytes from %s\r\n", *bytes_read, filename);
+	LOG_INFO(LOG_MOD_SD, "Read %u bytes from %s\r\n", *bytes_read, filename);
 	return FR_OK;
 }
 
-// we can add new field
-typedef struct CsvRecord {
-	char field1[32];
-	char field2[32];
-	int value;
-} CsvRecord;
-
 /***************************************************************
  * Read CSV file into an array of CsvRecord structures
  * Parses each line into fields separated by commas
@@ -188,10 +727,10 @@ int sd_read_csv(const char *filename, CsvRecord *records, int max_records, int *
 	// Open CSV file
 	FRESULT res = f_open(&file, filename, FA_READ);
 	if (res != FR_OK) {
-		printf("Failed to open CSV: %s (%d)", filename, res);
+		LOG_ERROR(LOG_MOD_SD, "Failed to open CSV: %s (%d)", filename, res);
 		return res;
 	}
-	printf("📄 Reading CSV: %s\r\n", filename);
+	LOG_INFO(LOG_MOD_SD, "📄 Reading CSV: %s\r\n", filename);
 
 	// Loop through lines with f_gets
 	while (f_gets(line, sizeof(line), &file) && *record_count < max_records) {
@@ -224,7 +763,7 @@ int sd_read_csv(const char *filename, CsvRecord *records, int max_records, int *
 
 	// Print parsed data
 	for (int i = 0; i < *record_count; i++) {
-		printf("[%d] %s | %s | %d", i,
+		LOG_INFO(LOG_MOD_SD, "[%d] %s | %s | %d", i,
 				records[i].field1,
 				records[i].field2,
 				records[i].value);
@@ -241,7 +780,7 @@ int sd_read_csv(const char *filename, CsvRecord *records, int max_records, int *
 
 int sd_delete_file(const char *filename) {
 	FRESULT res = f_unlink(filename);
-	printf("Delete %s: %s\r\n", filename, (res == FR_OK ? "OK" : "Failed"));
+	LOG_INFO(LOG_MOD_SD, "Delete %s: %s\r\n", filename, (res == FR_OK ? "OK" : "Failed"));
 	return res;
 }
 
@@ -253,7 +792,7 @@ int sd_delete_file(const char *filename) {
 
 int sd_rename_file(const char *oldname, const char *newname) {
 	FRESULT res = f_rename(oldname, newname);
-	printf("Rename %s to %s: %s\r\n", oldname, newname, (res == FR_OK ? "OK" : "Failed"));
+	LOG_INFO(LOG_MOD_SD, "Rename %s to %s: %s\r\n", oldname, newname, (res == FR_OK ? "OK" : "Failed"));
 	return res;
 }
 
@@ -265,7 +804,7 @@ int sd_rename_file(const char *oldname, const char *newname) {
 
 FRESULT sd_create_directory(const char *path) {
 	FRESULT res = f_mkdir(path);
-	printf("Create directory %s: %s\r\n", path, (res == FR_OK ? "OK" : "Failed"));
+	LOG_DEBUG(LOG_MOD_SD, "Create directory %s: %s\r\n", path, (res == FR_OK ? "OK" : "Failed"));
 	return res;
 }
 
@@ -285,7 +824,7 @@ void sd_list_directory_recursive(const char *path, int depth) {
 	// Open directory
 	FRESULT res = f_opendir(&dir, path);
 	if (res != FR_OK) {
-		printf("%*s[ERR] Cannot open: %s\r\n", depth * 2, "", path);
+		LOG_ERROR(LOG_MOD_SD, "%*s[ERR] Cannot open: %s\r\n", depth * 2, "", path);
 		return;
 	}
 
@@ -300,7 +839,7 @@ void sd_list_directory_recursive(const char *path, int depth) {
 		// If entry is directory, call recursively
 		if (fno.fattrib & AM_DIR) {
 			if (strcmp(name, ".") && strcmp(name, "..")) {
-				printf("%*s📁 %s\r\n", depth * 2, "", name);
+				LOG_INFO(LOG_MOD_SD, "%*s📁 %s\r\n", depth * 2, "", name);
 				char newpath[128];
 				snprintf(newpath, sizeof(newpath), "%s/%s", path, name);
 
@@ -309,7 +848,7 @@ void sd_list_directory_recursive(const char *path, int depth) {
 			}
 		} else {
 			// If entry is file, print file info
-			printf("%*s📄 %s (%lu bytes)\r\n", depth * 2, "", name, (unsigned long)fno.fsize);
+			LOG_INFO(LOG_MOD_SD, "%*s📄 %s (%lu bytes)\r\n", depth * 2, "", name, (unsigned long)fno.fsize);
 		}
 	}
 	f_closedir(&dir);
@@ -322,8 +861,8 @@ void sd_list_directory_recursive(const char *path, int depth) {
 
 void sd_list_files(void) {
 	// Print header
-	printf("📂 Files on SD Card:\r\n");
+	LOG_INFO(LOG_MOD_SD, "📂 Files on SD Card:\r\n");
 
 	sd_list_directory_recursive(SDPath, 0);
-	printf("\r\n\r\n");
+	LOG_INFO(LOG_MOD_SD, "\r\n\r\n");
 }
@@ -0,0 +1,104 @@
+#include "sd_io_stats.h"
+#include <string.h>
+
+#if SD_IO_STATS
+
+/* driver called by the shim, SD_Driver on the target */
+static const Diskio_drvTypeDef *io_drv;
+static sd_io_stats_t io_stats;
+
+/***************************************************************
+ * Count one disk_read / disk_write command and its time
+ ***************************************************************/
+
+static void sd_io_count(uint32_t *cmds, uint32_t *sectors, UINT count, uint32_t start, DRESULT res)
+{
+	(*cmds)++;
+	*sectors += count;
+	io_stats.busy_ms += HAL_GetTick() - start;
+	if(res != RES_OK) io_stats.errors++;
+}
+
+static DSTATUS sd_io_initialize(BYTE lun)
+{
+	return io_drv->disk_initialize(lun);
+}
+
+static DSTATUS sd_io_status(BYTE lun)
+{
+	return io_drv->disk_status(lun);
+}
+
+static DRESULT sd_io_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
+{
+	uint32_t start = HAL_GetTick();
+	DRESULT res = io_drv->disk_read(lun, buff, sector, count);
+
+	sd_io_count(&io_stats.read_cmds, &io_stats.sectors_read, count, start, res);
+	return res;
+}
+
+#if _USE_WRITE == 1
+static DRESULT sd_io_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+{
+	uint32_t start = HAL_GetTick();
+	DRESULT res = io_drv->disk_write(lun, buff, sector, count);
+
+	sd_io_count(&io_stats.write_cmds, &io_stats.sectors_written, count, start, res);
+	return res;
+}
+#endif
+
+#if _USE_IOCTL == 1
+static DRESULT sd_io_ioctl(BYTE lun, BYTE cmd, void *buff)
+{
+	return io_drv->disk_ioctl(lun, cmd, buff);
+}
+#endif
+
+static const Diskio_drvTypeDef sd_io_driver =
+{
+	sd_io_initialize,
+	sd_io_status,
+	sd_io_read,
+#if _USE_WRITE == 1
+	sd_io_write,
+#endif
+#if _USE_IOCTL == 1
+	sd_io_ioctl,
+#endif
+};
+
+/***************************************************************
+ * Put the counting shim between FatFs and the disk driver
+ * Driver linked to path is unlinked, the shim is linked to the
+ * same drive number, so path stays valid
+ * Returns 0 on success like FATFS_LinkDriver
+ ***************************************************************/
+
+uint8_t sd_io_stats_link(const Diskio_drvTypeDef *drv, char *path)
+{
+	io_drv = drv;
+	FATFS_UnLinkDriver(path);
+	return FATFS_LinkDriver(&sd_io_driver, path);
+}
+
+/***************************************************************
+ * Get a copy of the counters
+ ***************************************************************/
+
+void sd_io_stats_get(sd_io_stats_t *stats)
+{
+	*stats = io_stats;
+}
+
+/***************************************************************
+ * Clear the counters
+ ***************************************************************/
+
+void sd_io_stats_reset(void)
+{
+	memset(&io_stats, 0, sizeof(io_stats));
+}
+
+#endif /* SD_IO_STATS */
@@ -0,0 +1,225 @@
+#include "sw_clock.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/*
+ * Clock time is a line through the reference point:
+ * time = ref_us + elapsed + elapsed * drift + slew
+ * elapsed is measured by TIM2 periods and counter, drift is estimated
+ * from offsets of the reference clock, the offset of the last sync is
+ * applied as slew with max SW_CLOCK_SLEW_PPM rate, so clock never jumps.
+ * Reference point is moved to now ( fold ) on sync and once an hour,
+ * so the products stay small.
+ */
+
+#define SW_CLOCK_FOLD_US		3600000000ULL
+
+static TIM_HandleTypeDef *clock_htim;
+static volatile uint32_t tim_periods;
+
+static uint64_t ref_raw;		/* TIM2 ticks of the reference point */
+static uint64_t ref_us;			/* clock time of the reference point */
+static int64_t slew_us;			/* offset not applied at the reference point */
+static int32_t drift_ppb;
+static uint64_t sync_raw;		/* TIM2 ticks of the last sync */
+static uint8_t synced;
+
+static sw_clock_stats_t stats;
+
+/***************************************************************
+ * Get TIM2 ticks since start
+ * Call with interrupts masked, period which elapsed while the
+ * interrupt is masked is counted by its pending flag
+ ***************************************************************/
+
+static uint64_t sw_clock_raw(void)
+{
+	uint32_t periods = tim_periods;
+	uint32_t cnt = __HAL_TIM_GET_COUNTER(clock_htim);
+
+	if(__HAL_TIM_GET_FLAG(clock_htim, TIM_FLAG_UPDATE) && cnt < SW_CLOCK_TIM_PERIOD / 2)
+	{
+		periods++;
+	}
+
+	return (uint64_t)periods * SW_CLOCK_TIM_PERIOD + cnt;
+}
+
+/***************************************************************
+ * Part of slew applied after elapsed us
+ ***************************************************************/
+
+static int64_t sw_clock_slew_at(uint64_t elapsed_us)
+{
+	int64_t max = (int64_t)(elapsed_us * SW_CLOCK_SLEW_PPM / 1000000);
+
+	if(slew_us > max) return max;
+	if(slew_us < -max) return -max;
+	return slew_us;
+}
+
+/***************************************************************
+ * Clock time at TIM2 ticks
+ ***************************************************************/
+
+static uint64_t sw_clock_time_at(uint64_t raw)
+{
+	uint64_t elapsed_us = (raw - ref_raw) * SW_CLOCK_TICK_US;
+	int64_t drift_us = (int64_t)elapsed_us * drift_ppb / 1000000000;
+
+	return ref_us + elapsed_us + drift_us + sw_clock_slew_at(elapsed_us);
+}
+
+/***************************************************************
+ * Move reference point to TIM2 ticks
+ ***************************************************************/
+
+static void sw_clock_fold(uint64_t raw)
+{
+	uint64_t elapsed_us = (raw - ref_raw) * SW_CLOCK_TICK_US;
+
+	ref_us = sw_clock_time_at(raw);
+	slew_us -= sw_clock_slew_at(elapsed_us);
+	ref_raw = raw;
+}
+
+/***************************************************************
+ * Initialize the clock on TIM2 before it is started
+ * Clock is not synced until the first sw_clock_sync
+ ***************************************************************/
+
+void sw_clock_init(TIM_HandleTypeDef *htim)
+{
+	clock_htim = htim;
+	tim_periods = 0;
+	ref_raw = 0;
+	ref_us = 0;
+	slew_us = 0;
+	drift_ppb = 0;
+	synced = 0;
+
+	// update flag of timer initialization is not elapsed period
+	__HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_UPDATE);
+}
+
+/***************************************************************
+ * Count TIM2 period, call from period elapsed callback
+ ***************************************************************/
+
+void sw_clock_period_elapsed(void)
+{
+	tim_periods++;
+}
+
+/***************************************************************
+ * Get clock time in us since 01.01.1970
+ ***************************************************************/
+
+uint64_t sw_clock_now_us(void)
+{
+	UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+
+	uint64_t raw = sw_clock_raw();
+	if((raw - ref_raw) * SW_CLOCK_TICK_US >= SW_CLOCK_FOLD_US) sw_clock_fold(raw);
+
+	uint64_t now = sw_clock_time_at(raw);
+
+	taskEXIT_CRITICAL_FROM_ISR(state);
+	return now;
+}
+
+/***************************************************************
+ * Get clock time in seconds since 01.01.1970
+ ***************************************************************/
+
+uint32_t sw_clock_now(void)
+{
+	return (uint32_t)(sw_clock_now_us() / 1000000);
+}
+
+/***************************************************************
+ * Check if clock got the reference time
+ ***************************************************************/
+
+int sw_clock_is_synced(void)
+{
+	return synced;
+}
+
+/***************************************************************
+ * Apply reference time read just now
+ * First reference and offset bigger than SW_CLOCK_STEP_US step
+ * the clock, smaller offset is slewed
+ * Offset which is left after the planned slew is drift of TIM2
+ * base against reference, half of it corrects the drift
+ ***************************************************************/
+
+void sw_clock_sync(uint64_t ref, sw_clock_src_t src)
+{
+	UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+
+	uint64_t raw = sw_clock_raw();
+	sw_clock_fold(raw);
+
+	int64_t offset = (int64_t)(ref - ref_us);
+	uint64_t interval_us = (raw - sync_raw) * SW_CLOCK_TICK_US;
+
+	if(!synced || offset > SW_CLOCK_STEP_US || offset < -SW_CLOCK_STEP_US)
+	{
+		// step
+		ref_us = ref;
+		slew_us = 0;
+		stats.steps++;
+	}
+	else
+	{
+		// drift since last sync, slew which is not applied yet is not drift
+		if(interval_us >= SW_CLOCK_MIN_DRIFT_S * 1000000ULL)
+		{
+			int64_t drift = drift_ppb + (offset - slew_us) * 1000000000 / (int64_t)interval_us / 2;
+
+			if(drift > SW_CLOCK_MAX_FREQ_PPB) drift = SW_CLOCK_MAX_FREQ_PPB;
+			if(drift < -SW_CLOCK_MAX_FREQ_PPB) drift = -SW_CLOCK_MAX_FREQ_PPB;
+			drift_ppb = (int32_t)drift;
+		}
+
+		slew_us = offset;
+	}
+
+	synced = 1;
+	sync_raw = raw;
+
+	stats.syncs++;
+	stats.last_offset_us = (int32_t)offset;
+	stats.drift_ppb = drift_ppb;
+	stats.last_src = src;
+
+	taskEXIT_CRITICAL_FROM_ISR(state);
+}
+
+/***************************************************************
+ * Check if the clock should be synced from reference
+ * True before the first sync and after SW_CLOCK_SYNC_INTERVAL_S
+ ***************************************************************/
+
+int sw_clock_sync_due(void)
+{
+	if(!synced) return 1;
+
+	UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+	uint64_t interval_us = (sw_clock_raw() - sync_raw) * SW_CLOCK_TICK_US;
+	taskEXIT_CRITICAL_FROM_ISR(state);
+
+	return interval_us >= SW_CLOCK_SYNC_INTERVAL_S * 1000000ULL;
+}
+
+/***************************************************************
+ * Get statistics of syncs
+ ***************************************************************/
+
+void sw_clock_get_stats(sw_clock_stats_t *out)
+{
+	UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+	*out = stats;
+	taskEXIT_CRITICAL_FROM_ISR(state);
+}
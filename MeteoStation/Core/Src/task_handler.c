@@ -1,10 +1,15 @@
 #include "main.h"
 #include "sd_functions.h"
+#include "meteo_msg.h"
+#include "meteo_frame.h"
 #include "stdio.h"
 
+/* records of SPI frame are meteo_msg_t */
+typedef char meteo_frame_record_check[(sizeof(meteo_msg_t) == METEO_FRAME_RECORD_SIZE) ? 1 : -1];
+
 void sd_create_new_dir(char *path, int year, int month, size_t len)
 {
-	sd_mount();
+	// SD card should be mounted
 	year += 2000;
 
 	// /LOGS
@@ -17,8 +22,6 @@ void sd_create_new_dir(char *path, int year, int month, size_t len)
     // /LOGS/YYYY/MM
     snprintf(path, len, "/LOGS/%04d/%02d", year, month);
     sd_create_directory(path);
-
-    sd_unmount();
 }
 
 void sd_create_new_file(char *path, int date, char* format, size_t len)
@@ -26,44 +29,91 @@ void sd_create_new_file(char *path, int date, char* format, size_t len)
 	snprintf(path + 13, len - 13, "/%02d.%s", date, format);
 }
 
+static HAL_StatusTypeDef rtc_read_ds1307(uint32_t *epoch)
+{
+	HAL_StatusTypeDef ret;
+
+	xSemaphoreTake(i2cMutex, portMAX_DELAY);
+	ret = ds1307_get_datetime(&curr_date, &curr_time);
+	xSemaphoreGive(i2cMutex);
+
+	if(ret == HAL_OK) *epoch = meteo_epoch_from_rtc(&curr_date, &curr_time);
+	return ret;
+}
+
+static HAL_StatusTypeDef rtc_sync_ds1307(void)
+{
+	HAL_StatusTypeDef ret;
+	uint32_t first, epoch;
+
+	// DS1307 has 1 s resolution, so wait shortly before its predicted second edge
+	if(sw_clock_is_synced())
+	{
+		uint32_t frac_ms = (uint32_t)(sw_clock_now_us() % 1000000) / 1000;
+		if(frac_ms < 1000 - SW_CLOCK_EDGE_LEAD_MS)
+		{
+			vTaskDelay(pdMS_TO_TICKS(1000 - SW_CLOCK_EDGE_LEAD_MS - frac_ms));
+		}
+	}
+
+	ret = rtc_read_ds1307(&first);
+	if(ret != HAL_OK) return ret;
+
+	// Poll until seconds change, the edge is in the last poll period
+	for(uint32_t i = 0; i < SW_CLOCK_EDGE_POLLS; i++)
+	{
+		vTaskDelay(pdMS_TO_TICKS(SW_CLOCK_EDGE_POLL_MS));
+
+		ret = rtc_read_ds1307(&epoch);
+		if(ret != HAL_OK) return ret;
+
+		if(epoch != first)
+		{
+			sw_clock_sync((uint64_t)epoch * 1000000 + SW_CLOCK_EDGE_POLL_MS * 500, SW_CLOCK_SRC_DS1307);
+			return HAL_OK;
+		}
+	}
+
+	return HAL_TIMEOUT;
+}
+
 void rtc_task(void* param)
 {
 	meteo_msg_t msg;
+	sw_clock_stats_t clock_stats;
+
 	while(1)
 	{
 		xTaskNotifyWait(0, 0, NULL, portMAX_DELAY);
 
-		// DS1307
-		xSemaphoreTake(i2cMutex, portMAX_DELAY);
-		if(ds1307_get_current_time(&curr_time) != HAL_OK)
+		msg.flags = 0;
+
+		// DS1307 disciplines the software clock on the sync interval only
+		if(sw_clock_sync_due())
 		{
-			printf("DS1307_get_time is failed");
+			if(rtc_sync_ds1307() != HAL_OK)
+			{
+				LOG_ERROR(LOG_MOD_RTC, "DS1307_get_datetime is failed\r\n");
+			}
+			else
+			{
+				sw_clock_get_stats(&clock_stats);
+				LOG_INFO(LOG_MOD_RTC, "Clock sync: offset %ld us, drift %ld ppb, steps %lu\r\n",
+						(long)clock_stats.last_offset_us, (long)clock_stats.drift_ppb, clock_stats.steps);
+			}
 		}
-		if(ds1307_get_current_date(&curr_date) != HAL_OK)
+
+		if(!sw_clock_is_synced())
 		{
-			printf("DS1307_get_date is failed");
+			msg.flags |= METEO_FLAG_RTC_ERR;
 		}
-		xSemaphoreGive(i2cMutex);
 
 		// RTC
 		//HAL_RTC_GetTime(&hrtc, &sTime, RTC_FORMAT_BIN);
 		//HAL_RTC_GetDate(&hrtc, &sDate, RTC_FORMAT_BIN);
 
-		// Get current value of date, month and year for sd task
-		msg.date = curr_date.date;
-		msg.month = curr_date.month;
-		msg.year = curr_date.year;
-
-		/*msg.date = sDate.Date;
-		msg.month = sDate.Month;
-		msg.year = sDate.Year;*/
-
-		// Write time and date into buffer
-		// ds1307
-		snprintf(msg.timestamp, sizeof(msg.timestamp), "%02d:%02d:%02d%02d.%02d.%02d", curr_time.hours, curr_time.minutes, curr_time.seconds, curr_date.date, curr_date.month, curr_date.year);
-
-		// rtc
-		//snprintf(msg.timestamp, sizeof(msg.timestamp), "%02d:%02d:%02d%02d.%02d.%02d", sTime.Hours, sTime.Minutes, sTime.Seconds, sDate.Date, sDate.Month, sDate.Year);
+		// Write time and date as epoch seconds of software clock, text is formatted only for lcd and sd
+		msg.epoch = sw_clock_now();
 
 		// Send data to bme280 task
 		xQueueSend(q_bme280, &msg, portMAX_DELAY);
@@ -81,17 +131,18 @@ void bme280_task(void* param)
 		xSemaphoreTake(i2cMutex, portMAX_DELAY);
 		if(bme280_get_data(&measuring) != HAL_OK)
 		{
-			printf("DME280_get_data is failed");
+			LOG_ERROR(LOG_MOD_BME280, "DME280_get_data is failed\r\n");
+			msg.flags |= METEO_FLAG_SENSOR_ERR;
 		}
 		xSemaphoreGive(i2cMutex);
 
-		// Write date into structure
-		msg.temperature = (float)measuring.temperature;
-		msg.pressure = (float)measuring.pressure;
-		msg.humidity = (float)measuring.humidity;
+		// Write date into structure in fixed point
+		msg.temperature = meteo_temperature_to_fixed(measuring.temperature);
+		msg.pressure = meteo_pressure_to_fixed(measuring.pressure);
+		msg.humidity = meteo_humidity_to_fixed(measuring.humidity);
 
-		// Send data to lcd and sd tasks
-		xQueueSend(q_lcd, &msg, portMAX_DELAY);
+		// Publish data for lcd, esp32 and sd tasks
+		sample_bus_publish(&msg);
 	}
 }
 
@@ -99,54 +150,81 @@ extern void lcd_task(void* param)
 {
 	// structure for time, date and measuring
 	meteo_msg_t msg;
+	static char time_buf[17];
 	static char meas_buf[17];
 
 	while(1)
 	{
 		// get data
-		xQueueReceive(q_lcd, &msg, portMAX_DELAY);
-
-		snprintf(meas_buf, sizeof(meas_buf), "%02.1f;%03.1f;%02.2f", msg.temperature, msg.pressure, msg.humidity);
+		sample_bus_receive(sub_lcd, &msg, portMAX_DELAY);
 
 		// print data in format
-		/* hh:mm:ssdd:mm:yy
+		/* hh:mm:ssdd.mm.yy
 		 * tt.t;ppp.p;hh.hh\0
 		 */
-		lcd_set_cursor(1, 1);
-		lcd_print_string(msg.timestamp);
-
-		lcd_set_cursor(2, 1);
-		lcd_print_string(meas_buf);
+		meteo_format_lcd(&msg, time_buf, meas_buf, sizeof(meas_buf));
 
-		xQueueSend(q_esp32, &msg, portMAX_DELAY);
+		// only changed cells are sent to the display
+		lcd_fb_write(1, 1, time_buf);
+		lcd_fb_write(2, 1, meas_buf);
+		lcd_fb_flush();
 	}
 }
 
 void esp32(void* param)
 {
-	meteo_msg_t msg;
-
-	// structure for SPI transmission
-	static char rx_dummy_buf[sizeof(measurement_t)];
-	measurement_t meas;
+	static meteo_msg_t batch[METEO_FRAME_MAX_RECORDS];
+	static uint8_t frame[METEO_FRAME_SPI_SIZE];
+	uint16_t seq = 0;
+	uint8_t count, link_up = 1;
+	esp32_link_stats_t stats;
 
 	while(1)
 	{
-		// get data
-		xQueueReceive(q_esp32, &msg, portMAX_DELAY);
+		// wait for data, queued frames are retried meanwhile
+		TickType_t wait = esp32_link_pending() ? pdMS_TO_TICKS(ESP32_LINK_RETRY_MS) : portMAX_DELAY;
 
-		meas.temperature = msg.temperature;
-		meas.pressure = msg.pressure;
-		meas.humidity = msg.humidity;
-
-		xSemaphoreTake(spiMutex, portMAX_DELAY);
+		if(sample_bus_receive(sub_esp32, &batch[0], wait) == pdTRUE)
+		{
+			// take samples which are already waiting into the same frame
+			count = 1;
+			while(count < METEO_FRAME_MAX_RECORDS && sample_bus_receive(sub_esp32, &batch[count], 0) == pdTRUE)
+			{
+				count++;
+			}
+
+			// transaction has fixed length, rest of it is zeros
+			memset(frame, 0, sizeof(frame));
+			meteo_frame_encode(frame, sizeof(frame), METEO_FRAME_TYPE_SAMPLES, seq++, batch, count);
+			esp32_link_queue(frame);
+		}
 
-		// transmit the measurment
-		HAL_SPI_Transmit(&hspi1, (uint8_t*)&meas, sizeof(measurement_t), HAL_MAX_DELAY);
+		// send frames in order, stop at the first one which ESP32 doesn't take
+		HAL_StatusTypeDef ret = HAL_OK;
 
+		xSemaphoreTake(spiMutex, portMAX_DELAY);
+		while(esp32_link_pending() && ret == HAL_OK)
+		{
+			ret = esp32_link_send_pending();
+		}
 		xSemaphoreGive(spiMutex);
 
-		xQueueSend(q_sd, &msg, portMAX_DELAY);
+		// report only changes of the link state
+		if((ret == HAL_OK) != link_up)
+		{
+			link_up = (ret == HAL_OK);
+			esp32_link_get_stats(&stats);
+
+			if(link_up)
+			{
+				LOG_INFO(LOG_MOD_ESP32, "ESP32 link is up: sent %lu, dropped %lu, timeouts %lu, errors %lu\r\n",
+						stats.sent, stats.dropped, stats.timeouts, stats.errors);
+			}
+			else
+			{
+				LOG_WARN(LOG_MOD_ESP32, "ESP32 link is down, %u frames are queued\r\n", esp32_link_pending());
+			}
+		}
 	}
 }
 
@@ -154,49 +232,109 @@ extern void sd_task(void* param)
 {
 	// structure for time, date and measuring
 	meteo_msg_t msg;
-	char sd_file_data[64];
-	int32_t time_info_end = 8;
+	RTC_date_t date = {0};
+	RTC_time_t time;
+	uint32_t samples = 0;
+	GPIO_PinState card_pin, prev_card_pin = GPIO_PIN_RESET;
 
 	while(1)
 	{
-		// get data
-		xQueueReceive(q_sd, &msg, portMAX_DELAY);
+		// get data, wake up to check the card pin and age of buffered data
+		BaseType_t new_sample = sample_bus_receive(sub_sd, &msg, pdMS_TO_TICKS(SD_LOG_POLL_MS));
 
-		// Create new directory if month or year was changed
-		if(prev_date.prev_month != msg.month)
+		// Card pin is read first, removed card is never accessed ( every access waits SD_TIMEOUT )
+		card_pin = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_10);
+
+		if(new_sample == pdTRUE)
 		{
-			prev_date.prev_month = msg.month;
-			sd_create_new_dir(curr_path, msg.year, msg.month, sizeof(curr_path));
+			meteo_epoch_to_rtc(msg.epoch, &date, &time);
+
+			// Close the log file if month, year or date was changed, it will be reopened in new path
+			if(prev_date.prev_month != date.month || prev_date.prev_date != date.date)
+			{
+				prev_date.prev_month = date.month;
+				prev_date.prev_date = date.date;
+
+				// Without card only the session is dropped, sd_log_open writes kept CSV buffer
+				// into the file of the previous day
+				if(card_pin != GPIO_PIN_RESET) sd_log_discard();
+				else sd_log_close();
+			}
 		}
 
-		// Create new file if date was changed
-		if(prev_date.prev_date != msg.date)
+		// Card was removed, drop the session without access to the card, CSV buffer is kept
+		if(card_pin != GPIO_PIN_RESET)
 		{
-			prev_date.prev_date = msg.date;
-			sd_create_new_file(curr_path, msg.date, "csv", sizeof(curr_path));
+			if(sd_is_mounted())
+			{
+				sd_log_discard();
+				sd_unmount();
+			}
+			prev_card_pin = card_pin;
+			continue;
+		}
 
-			// Create title in head of file if you need this
-			/*sd_mount();
-			sd_append_file(curr_path, "time;temperature;pressure;humidity\r\n");
-			sd_unmount();*/
+		// Without new sample the card is accessed only to write buffered data
+		// when the card was inserted again or when the data is too old
+		if(new_sample != pdTRUE)
+		{
+			if(prev_card_pin == card_pin && !sd_log_flush_due()) continue;
+			if(date.month == 0) continue;
 		}
+		prev_card_pin = card_pin;
 
-		// Form the buffer for write into file
-		/*
-		 * hh:mm:ss;tt.t;ppp.p;hh.hh\0
-		 */
-		snprintf(sd_file_data, time_info_end + 1, "%s", msg.timestamp);
-		snprintf(&sd_file_data[time_info_end], sizeof(sd_file_data) - time_info_end, ";%02.1f;%03.1f;%02.2f\r\n",
-		         msg.temperature, msg.pressure, msg.humidity);
+		// Mount once and keep the card mounted between samples
+		if(!sd_is_mounted() && sd_mount() != FR_OK)
+		{
+			continue;
+		}
+
+		// Open the file of current day, create new directory and file if they don't exist
+		if(!sd_log_is_open())
+		{
+			sd_create_new_dir(curr_path, date.year, date.month, sizeof(curr_path));
+			sd_create_new_file(curr_path, date.date, SD_LOG_EXT, sizeof(curr_path));
+
+			if(sd_log_open(curr_path) != FR_OK)
+			{
+				// remount on next sample
+				sd_unmount();
+				continue;
+			}
+
+			// Create title in head of file if you need this
+			/*sd_log_append("time;temperature;pressure;humidity\r\n");*/
+		}
 
-		// Write data buffer into current file
+		if(new_sample != pdTRUE)
+		{
+			// Write buffered data which reached max age
+			if(sd_log_flush() != FR_OK)
+			{
+				// remount on next sample
+				sd_unmount();
+			}
+			continue;
+		}
 
-		if(HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_10) == GPIO_PIN_RESET)
+		// Write sample into current file
+		/* csv: hh:mm:ss;tt.t;ppp.p;hh.hh
+		 * bin: meteo_msg_t in blocks of meteo_log.h
+		 */
+		if(sd_log_append_record(&msg) != FR_OK)
 		{
-			sd_mount();
-			sd_append_file(curr_path, sd_file_data);
+			// remount on next sample
 			sd_unmount();
 		}
+
+		// Print the SD cost per sample
+		samples++;
+		if(SD_LOG_STATS_INTERVAL && (samples % SD_LOG_STATS_INTERVAL) == 0)
+		{
+			sd_log_print_stats(samples);
+			LOG_INFO(LOG_MOD_SD, "Sample bus dropped: lcd %lu, esp32 %lu, sd %lu\r\n",
+					sample_bus_dropped(sub_lcd), sample_bus_dropped(sub_esp32), sample_bus_dropped(sub_sd));
+			LOG_INFO(LOG_MOD_SD, "Log messages dropped: %lu\r\n", log_dropped());
+		}
 	}
 }
-
@@ -28,17 +28,14 @@ HAL_StatusTypeDef bme280_init(void)
 	uint8_t rx_buf2[BME280_CALIB2_SIZE];
 
 	/* Proof the id */
-	ret = HAL_I2C_Mem_Read(&hi2c1, BME280_I2C_ADDR | 0x01, BME280_ID_ADDR, 1, &id, 1, BME280_TIMEOUT);
+	ret = i2c_bus_mem_read(BME280_I2C_ADDR, BME280_ID_ADDR, &id, 1);
 	if(ret != HAL_OK) return ret;
 
-	HAL_I2C_IsDeviceReady(&hi2c1, BME280_I2C_ADDR, 10, BME280_TIMEOUT);
 	/* Get all calibrating data */
-	ret = HAL_I2C_Mem_Read(&hi2c1, BME280_I2C_ADDR | 0x01, BME280_CALIB1_ADDR, 1, rx_buf1, BME280_CALIB1_SIZE, BME280_TIMEOUT);
+	ret = i2c_bus_mem_read(BME280_I2C_ADDR, BME280_CALIB1_ADDR, rx_buf1, BME280_CALIB1_SIZE);
 	if(ret != HAL_OK) return ret;
 
-	HAL_I2C_IsDeviceReady(&hi2c1, BME280_I2C_ADDR, 10, BME280_TIMEOUT);
-
-	ret = HAL_I2C_Mem_Read(&hi2c1, BME280_I2C_ADDR | 0x01, BME280_CALIB2_ADDR, 1, rx_buf2, BME280_CALIB2_SIZE, BME280_TIMEOUT);
+	ret = i2c_bus_mem_read(BME280_I2C_ADDR, BME280_CALIB2_ADDR, rx_buf2, BME280_CALIB2_SIZE);
 	if(ret != HAL_OK) return ret;
 
 	/* Set all calibrating data into static definition structure ( calib ) */
@@ -56,7 +53,7 @@ HAL_StatusTypeDef bme280_init(void)
 	calib.dig_P8 = (int16_t)(rx_buf1[20] | (rx_buf1[21] << 8));
 	calib.dig_P9 = (int16_t)(rx_buf1[22] | (rx_buf1[23] << 8));
 
-	calib.dig_H1 = (uint8_t)(rx_buf1[24]);
+	calib.dig_H1 = (uint8_t)(rx_buf1[25]);
 	calib.dig_H2 = (int16_t)(rx_buf2[0] | rx_buf2[1] << 8);
 	calib.dig_H3 = (uint8_t)(rx_buf2[2]);
 	calib.dig_H4 = (int16_t)((rx_buf2[3] << 4) | (rx_buf2[4] & 0x0F));
@@ -65,30 +62,24 @@ HAL_StatusTypeDef bme280_init(void)
 
 
 	/* Configure bme modul setting data into ( ctrl_hum / ctrl_meas / config ) */
-	HAL_I2C_IsDeviceReady(&hi2c1, BME280_I2C_ADDR, 10, BME280_TIMEOUT);
-
 	// CTRL_HUM configuration
 	uint8_t tempreg = BME280_OSRS_H;
 
-	ret = HAL_I2C_Mem_Write(&hi2c1, BME280_I2C_ADDR, BME280_CTRL_HUM_ADDR, 1, &tempreg, 1, BME280_TIMEOUT);
+	ret = i2c_bus_mem_write(BME280_I2C_ADDR, BME280_CTRL_HUM_ADDR, &tempreg, 1);
 	if(ret != HAL_OK) return ret;
 
-	HAL_I2C_IsDeviceReady(&hi2c1, BME280_I2C_ADDR, 10, BME280_TIMEOUT);
-
 	// CTRL_MEAS configuration
 	tempreg = 0;
 	tempreg = BME280_MODE + BME280_OSRS_P + BME280_OSRS_T;
 
-	ret = HAL_I2C_Mem_Write(&hi2c1, BME280_I2C_ADDR, BME280_CTRL_MEAS_ADDR, 1, &tempreg, 1, BME280_TIMEOUT);
+	ret = i2c_bus_mem_write(BME280_I2C_ADDR, BME280_CTRL_MEAS_ADDR, &tempreg, 1);
 	if(ret != HAL_OK) return ret;
 
-	HAL_I2C_IsDeviceReady(&hi2c1, BME280_I2C_ADDR, 10, BME280_TIMEOUT);
-
 	// CONFIG configuration
 	tempreg = 0;
 	tempreg = BME280_SPI3W_EN + BME280_FILTER + BME280_T_SB;
 
-	ret = HAL_I2C_Mem_Write(&hi2c1, BME280_I2C_ADDR, BME280_CONFIG_ADDR, 1, &tempreg, 1, BME280_TIMEOUT);
+	ret = i2c_bus_mem_write(BME280_I2C_ADDR, BME280_CONFIG_ADDR, &tempreg, 1);
 	if(ret != HAL_OK) return ret;
 
 	return ret;
@@ -154,43 +145,44 @@ static BME280_U32_t bme280_compensate_H_int32(BME280_S32_t adc_H)
 	return (BME280_U32_t)(v_x1_u32r>>12);
 }
 
+/*********************************************************************
+ * @fn      		  - bme280_get_data
+ *
+ * @brief             - This function reads temperature, humidity and pressure
+ *
+ * @param[in]         - structure for measured data
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - HAL state
+ *
+ * @Note              - all data registers are read in one burst, so the three
+ * 						values are from the same conversion
+
+ */
+
 HAL_StatusTypeDef bme280_get_data(BME280_data_t* data)
 {
 	/* this value x100 or x1000 */
 	BME280_S32_t temp, press, hum;
 	HAL_StatusTypeDef ret;
-	uint8_t rx_buf[3];
+	uint8_t rx_buf[BME280_DATA_SIZE];
 
-	/* get temperature */
-	ret = HAL_I2C_Mem_Read(&hi2c1, BME280_I2C_ADDR | 0x01, BME280_TEMPERATURE_ADDR, 1, rx_buf, 3, BME280_TIMEOUT);
+	/* get pressure, temperature and humidity ( 0xF7 - 0xFE ) */
+	ret = i2c_bus_mem_read(BME280_I2C_ADDR, BME280_DATA_ADDR, rx_buf, BME280_DATA_SIZE);
 	if(ret != HAL_OK) return ret;
 
-	temp = (BME280_S32_t)((rx_buf[0] << 12) | (rx_buf[1] << 4) | (rx_buf[2] >> 4));
+	press = (BME280_S32_t)((rx_buf[0] << 12) | (rx_buf[1] << 4) | (rx_buf[2] >> 4));
+	temp = (BME280_S32_t)((rx_buf[3] << 12) | (rx_buf[4] << 4) | (rx_buf[5] >> 4));
+	hum = (BME280_S32_t)((rx_buf[6] << 8) | rx_buf[7]);
 
-	// DegC
+	// DegC, temperature first because it sets t_fine for pressure and humidity
 	data->temperature = (BME280_compensate_T_int32(temp) / 100.0);
 
-	HAL_I2C_IsDeviceReady(&hi2c1, BME280_I2C_ADDR | 0x01, 10, BME280_TIMEOUT);
-
-	/* get humidity */
-	ret = HAL_I2C_Mem_Read(&hi2c1, BME280_I2C_ADDR | 0x01, BME280_HUMIDITY_ADDR, 1, rx_buf, 2, BME280_TIMEOUT);
-	if(ret != HAL_OK) return ret;
-
-
-	hum = (BME280_S32_t)((rx_buf[0] << 8) | rx_buf[1]);
-
 	// %rH
 	data->humidity = (bme280_compensate_H_int32(hum) / 1024.0);
 
-	HAL_I2C_IsDeviceReady(&hi2c1, BME280_I2C_ADDR | 0x01, 10, BME280_TIMEOUT);
-
-	/* get pressure */
-	ret = HAL_I2C_Mem_Read(&hi2c1, BME280_I2C_ADDR | 0x01, BME280_PRESSURE_ADDR, 1, rx_buf, 3, BME280_TIMEOUT);
-	if(ret != HAL_OK) return ret;
-
 	// hPa
-	press = (BME280_S32_t)((rx_buf[0] << 12) | (rx_buf[1] << 4) | (rx_buf[2] >> 4));
-
 	data->pressure = (BME280_compensate_P_int64(press) / 25600.0);
 
 	return ret;
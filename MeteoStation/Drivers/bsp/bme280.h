@@ -2,9 +2,7 @@
 #define BSP_BME280_H_
 
 #include "main.h"
-
-// I2C handle I2C1
-extern I2C_HandleTypeDef hi2c1;
+#include "i2c_bus.h"
 
 /* Some definition for work with BME280 */
 
@@ -12,10 +10,9 @@ extern I2C_HandleTypeDef hi2c1;
 #define BME280_I2C						I2C
 #define BME280_GPIO_PORT				GPIOB
 #define	BME280_I2C_ADDR					(0x76 << 1)
-#define BME280_TIMEOUT					1000
 
 #define BME280_CALIB1_ADDR				0x88
-#define BME280_CALIB1_SIZE				25
+#define BME280_CALIB1_SIZE				26	// 0x88 - 0xA1, 0xA0 is not used
 #define BME280_CALIB2_ADDR				0xE1
 #define BME280_CALIB2_SIZE				7
 
@@ -43,6 +40,10 @@ extern I2C_HandleTypeDef hi2c1;
 #define BME280_TEMPERATURE_ADDR			0xFA
 #define BME280_HUMIDITY_ADDR			0xFD
 
+/* All data registers 0xF7 - 0xFE ( press / temp / hum ) in one burst */
+#define BME280_DATA_ADDR				BME280_PRESSURE_ADDR
+#define BME280_DATA_SIZE				8
+
 typedef int32_t BME280_S32_t;
 typedef uint32_t BME280_U32_t;
 typedef int64_t BME280_S64_t;
@@ -5,6 +5,18 @@ static DS1307_rx_t ds1307_read(uint8_t reg_addr);
 static uint8_t binary_to_bcd(uint8_t bin);
 static uint8_t bcd_to_binary(uint8_t bcd);
 
+/* valid bits of time and date registers, index is register address */
+static const uint8_t ds1307_reg_mask[DS1307_DATETIME_SIZE] =
+{
+	0x7F,	// seconds, bit 7 is clock halt
+	0x7F,	// minutes
+	0x3F,	// hours in 24 hours format, 12 hours format is 0x1F
+	0x07,	// day
+	0x3F,	// date
+	0x1F,	// month
+	0xFF	// year
+};
+
 /*********************************************************************
  * @fn      		  - ds1307_write
  *
@@ -28,7 +40,7 @@ static HAL_StatusTypeDef ds1307_write(uint8_t val, uint8_t reg_addr)
 	tx[0] = reg_addr;
 	tx[1] = val;
 
-	ret = HAL_I2C_Master_Transmit(&hi2c1, (uint16_t)(DS1307_I2C_ADDR), tx, 2, 1000);
+	ret = i2c_bus_transmit(DS1307_I2C_ADDR, tx, 2);
 	if(ret != HAL_OK) return ret;
 
 	return ret;
@@ -55,14 +67,11 @@ static DS1307_rx_t ds1307_read(uint8_t reg_addr)
 	ret.data = 0;
 
 	// send pointer to register
-	ret.state = HAL_I2C_Master_Transmit(&hi2c1, (uint16_t)(DS1307_I2C_ADDR), &reg_addr, 1, DS1307_TIMEOUT);
-	if(ret.state != HAL_OK) return ret;
-
-	ret.state = HAL_I2C_IsDeviceReady(&hi2c1, (uint16_t)(DS1307_I2C_ADDR), 10, DS1307_TIMEOUT);
+	ret.state = i2c_bus_transmit(DS1307_I2C_ADDR, &reg_addr, 1);
 	if(ret.state != HAL_OK) return ret;
 
 	// read from that register
-	ret.state = HAL_I2C_Master_Receive(&hi2c1, (uint16_t)(DS1307_I2C_ADDR) | 0x01, &ret.data, 1, DS1307_TIMEOUT);
+	ret.state = i2c_bus_receive(DS1307_I2C_ADDR, &ret.data, 1);
 	if(ret.state != HAL_OK) return ret;
 
 	return ret;
@@ -339,3 +348,61 @@ HAL_StatusTypeDef ds1307_get_current_date(RTC_date_t *rtc_date)
 
 	return ret.state;
 }
+
+/*********************************************************************
+ * @fn      		  - ds1307_get_datetime
+ *
+ * @brief             - This function allows us to get current time and date
+ *
+ * @param[in]         - date of RTC
+ * @param[in]         - time of RTC
+ * @param[in]         -
+ *
+ * @return            - HAL state
+ *
+ * @Note              - registers 0x00 - 0x06 are read in one burst, DS1307
+ * 						latches them at START, so seconds can't roll over
+ * 						between time and date
+
+ */
+
+HAL_StatusTypeDef ds1307_get_datetime(RTC_date_t *rtc_date, RTC_time_t *rtc_time)
+{
+	HAL_StatusTypeDef ret;
+	uint8_t regs[DS1307_DATETIME_SIZE];
+	uint8_t hours;
+
+	ret = i2c_bus_mem_read(DS1307_I2C_ADDR, DS1307_ADDR_SEC, regs, DS1307_DATETIME_SIZE);
+	if(ret != HAL_OK) return ret;
+
+	// check time format of hours register
+	hours = regs[DS1307_ADDR_HOUR];
+	if((hours & (1 << 6)) == RESET)
+	{
+		// 24 hours format
+		rtc_time->time_format = DS1307_TIME_FORMAT_24HOUR;
+	}
+	else
+	{
+		// 12 hours format, bit 5 is PM
+		rtc_time->time_format = !((hours & (1 << 5)) == 0);
+		regs[DS1307_ADDR_HOUR] &= 0x1F;
+	}
+
+	// clear control bits and change format to binary
+	for(uint8_t i = 0; i < DS1307_DATETIME_SIZE; i++)
+	{
+		regs[i] = bcd_to_binary(regs[i] & ds1307_reg_mask[i]);
+	}
+
+	rtc_time->seconds = regs[DS1307_ADDR_SEC];
+	rtc_time->minutes = regs[DS1307_ADDR_MIN];
+	rtc_time->hours = regs[DS1307_ADDR_HOUR];
+
+	rtc_date->day = regs[DS1307_ADDR_DAY];
+	rtc_date->date = regs[DS1307_ADDR_DATA];
+	rtc_date->month = regs[DS1307_ADDR_MONTH];
+	rtc_date->year = regs[DS1307_ADDR_YEAR];
+
+	return ret;
+}
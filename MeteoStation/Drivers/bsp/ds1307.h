@@ -2,14 +2,12 @@
 #define BSP_DS1307_H_
 
 #include "main.h"
-
-extern I2C_HandleTypeDef hi2c1;
+#include "i2c_bus.h"
 
 /* Application configurable items */
 #define DS1307_I2C						I2C1
 #define DS1307_I2C_SPEED				100000
 #define DS1307_I2C_PUPD					GPIO_NOPULL // we don't use internal pull up
-#define DS1307_TIMEOUT					1000
 
 /* Register addresses */
 #define DS1307_ADDR_SEC					0x00
@@ -20,6 +18,9 @@ extern I2C_HandleTypeDef hi2c1;
 #define DS1307_ADDR_MONTH				0x05
 #define DS1307_ADDR_YEAR				0x06
 
+/* Time and date registers 0x00 - 0x06 read in one burst */
+#define DS1307_DATETIME_SIZE			7
+
 /* Time formats */
 #define DS1307_TIME_FORMAT_12HOUR_AM	0
 #define DS1307_TIME_FORMAT_12HOUR_PM	1
@@ -54,4 +55,7 @@ HAL_StatusTypeDef ds1307_get_current_time(RTC_time_t *time);
 HAL_StatusTypeDef ds1307_set_current_date(RTC_date_t *date);
 HAL_StatusTypeDef ds1307_get_current_date(RTC_date_t *date);
 
+/* Get time and date from one snapshot of registers */
+HAL_StatusTypeDef ds1307_get_datetime(RTC_date_t *date, RTC_time_t *time);
+
 #endif /* BSP_DS1307_H_ */
@@ -0,0 +1,106 @@
+#include "dwt.h"
+
+/*********************************************************************
+ * @fn      		  - dwt_init
+ *
+ * @brief             - This function enables the CYCCNT counter of DWT
+ *
+ * @param[in]         -
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - none
+ *
+ * @Note              - counter isn't reset, SEGGER SYSVIEW uses it for timestamps
+
+ */
+
+void dwt_init(void)
+{
+	// enable trace, without it DWT doesn't count
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/*********************************************************************
+ * @fn      		  - dwt_cycles
+ *
+ * @brief             - This function returns current value of cycle counter
+ *
+ * @param[in]         -
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - cycles, it wraps around every ~25 s at 168 MHz
+ *
+ * @Note              - none
+
+ */
+
+uint32_t dwt_cycles(void)
+{
+	return DWT->CYCCNT;
+}
+
+/*********************************************************************
+ * @fn      		  - dwt_delay_cycles
+ *
+ * @brief             - This function waits given number of core cycles
+ *
+ * @param[in]         - cycles
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - none
+ *
+ * @Note              - unsigned difference works across counter wrap
+
+ */
+
+void dwt_delay_cycles(uint32_t cycles)
+{
+	uint32_t start = DWT->CYCCNT;
+
+	while((DWT->CYCCNT - start) < cycles);
+}
+
+/*********************************************************************
+ * @fn      		  - dwt_delay_ns
+ *
+ * @brief             - This function waits at least given number of nanoseconds
+ *
+ * @param[in]         - ns
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - none
+ *
+ * @Note              - rounded up to one cycle, call overhead makes it longer
+
+ */
+
+void dwt_delay_ns(uint32_t ns)
+{
+	dwt_delay_cycles((ns * DWT_CYCLES_PER_US + 999U) / 1000U);
+}
+
+/*********************************************************************
+ * @fn      		  - dwt_delay_us
+ *
+ * @brief             - This function waits given number of microseconds
+ *
+ * @param[in]         - us
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - none
+ *
+ * @Note              - none
+
+ */
+
+void dwt_delay_us(uint32_t us)
+{
+	dwt_delay_cycles(us * DWT_CYCLES_PER_US);
+}
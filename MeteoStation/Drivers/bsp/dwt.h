@@ -0,0 +1,18 @@
+#ifndef BSP_DWT_H_
+#define BSP_DWT_H_
+
+#include "main.h"
+
+/* Cycles of core clock in one microsecond, 168 at 168 MHz */
+#define DWT_CYCLES_PER_US				(SystemCoreClock / 1000000U)
+
+/* Function prototypes */
+void dwt_init(void);
+uint32_t dwt_cycles(void);
+
+/* Busy wait functions, they don't give CPU to other tasks, use for short delays only */
+void dwt_delay_cycles(uint32_t cycles);
+void dwt_delay_ns(uint32_t ns);
+void dwt_delay_us(uint32_t us);
+
+#endif /* BSP_DWT_H_ */
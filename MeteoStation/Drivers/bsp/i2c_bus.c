@@ -0,0 +1,328 @@
+#include "i2c_bus.h"
+#include "dwt.h"
+
+static SemaphoreHandle_t i2c_done;
+static volatile HAL_StatusTypeDef i2c_result;
+
+static int i2c_bus_use_it(void);
+static HAL_StatusTypeDef i2c_bus_wait(HAL_StatusTypeDef start);
+static void i2c_bus_complete_from_isr(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef result);
+static void i2c_bus_delay(void);
+
+/*********************************************************************
+ * @fn      		  - i2c_bus_init
+ *
+ * @brief             - This function creates the semaphore for transfer completion
+ *
+ * @param[in]         -
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - HAL state
+ *
+ * @Note              - call before the first transfer, after MX_I2C1_Init
+
+ */
+
+HAL_StatusTypeDef i2c_bus_init(void)
+{
+	i2c_done = xSemaphoreCreateBinary();
+	if(i2c_done == NULL) return HAL_ERROR;
+
+	return HAL_OK;
+}
+
+/*********************************************************************
+ * @fn      		  - i2c_bus_use_it
+ *
+ * @brief             - This function checks if the transfer can wait in interrupt mode
+ *
+ * @param[in]         -
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - 1 if scheduler is running, otherwise 0
+ *
+ * @Note              - before StartScheduler task can't block, blocking HAL API is used
+
+ */
+
+static int i2c_bus_use_it(void)
+{
+	return (i2c_done != NULL) && (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+}
+
+/*********************************************************************
+ * @fn      		  - i2c_bus_wait
+ *
+ * @brief             - This function puts the task to sleep until the transfer is finished
+ *
+ * @param[in]         - HAL state of the transfer start
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - HAL state
+ *
+ * @Note              - on timeout or bus error the bus is recovered
+
+ */
+
+static HAL_StatusTypeDef i2c_bus_wait(HAL_StatusTypeDef start)
+{
+	if(start != HAL_OK)
+	{
+		// peripheral is stuck in busy state
+		if(start == HAL_BUSY) i2c_bus_recover();
+		return start;
+	}
+
+	// sleep until the callback gives the semaphore
+	if(xSemaphoreTake(i2c_done, pdMS_TO_TICKS(I2C_BUS_TIMEOUT)) != pdTRUE)
+	{
+		i2c_bus_recover();
+		return HAL_TIMEOUT;
+	}
+
+	// NACK is the device answer, other errors need the bus recovery
+	if(i2c_result != HAL_OK && (HAL_I2C_GetError(&hi2c1) & ~HAL_I2C_ERROR_AF) != 0)
+	{
+		i2c_bus_recover();
+	}
+
+	return i2c_result;
+}
+
+/*********************************************************************
+ * @fn      		  - i2c_bus_mem_read
+ *
+ * @brief             - This function reads registers of device
+ *
+ * @param[in]         - device address
+ * @param[in]         - address of the first register
+ * @param[in]         - buffer and length
+ *
+ * @return            - HAL state
+ *
+ * @Note              - none
+
+ */
+
+HAL_StatusTypeDef i2c_bus_mem_read(uint16_t dev_addr, uint8_t reg_addr, uint8_t *buf, uint16_t len)
+{
+	if(!i2c_bus_use_it())
+	{
+		return HAL_I2C_Mem_Read(&hi2c1, dev_addr, reg_addr, 1, buf, len, I2C_BUS_TIMEOUT);
+	}
+
+	// drop completion of the previous timed out transfer
+	xSemaphoreTake(i2c_done, 0);
+
+	return i2c_bus_wait(HAL_I2C_Mem_Read_IT(&hi2c1, dev_addr, reg_addr, 1, buf, len));
+}
+
+/*********************************************************************
+ * @fn      		  - i2c_bus_mem_write
+ *
+ * @brief             - This function writes registers of device
+ *
+ * @param[in]         - device address
+ * @param[in]         - address of the first register
+ * @param[in]         - buffer and length
+ *
+ * @return            - HAL state
+ *
+ * @Note              - none
+
+ */
+
+HAL_StatusTypeDef i2c_bus_mem_write(uint16_t dev_addr, uint8_t reg_addr, uint8_t *buf, uint16_t len)
+{
+	if(!i2c_bus_use_it())
+	{
+		return HAL_I2C_Mem_Write(&hi2c1, dev_addr, reg_addr, 1, buf, len, I2C_BUS_TIMEOUT);
+	}
+
+	xSemaphoreTake(i2c_done, 0);
+
+	return i2c_bus_wait(HAL_I2C_Mem_Write_IT(&hi2c1, dev_addr, reg_addr, 1, buf, len));
+}
+
+/*********************************************************************
+ * @fn      		  - i2c_bus_transmit
+ *
+ * @brief             - This function sends bytes to device
+ *
+ * @param[in]         - device address
+ * @param[in]         - buffer
+ * @param[in]         - length
+ *
+ * @return            - HAL state
+ *
+ * @Note              - none
+
+ */
+
+HAL_StatusTypeDef i2c_bus_transmit(uint16_t dev_addr, uint8_t *buf, uint16_t len)
+{
+	if(!i2c_bus_use_it())
+	{
+		return HAL_I2C_Master_Transmit(&hi2c1, dev_addr, buf, len, I2C_BUS_TIMEOUT);
+	}
+
+	xSemaphoreTake(i2c_done, 0);
+
+	return i2c_bus_wait(HAL_I2C_Master_Transmit_IT(&hi2c1, dev_addr, buf, len));
+}
+
+/*********************************************************************
+ * @fn      		  - i2c_bus_receive
+ *
+ * @brief             - This function receives bytes from device
+ *
+ * @param[in]         - device address
+ * @param[in]         - buffer
+ * @param[in]         - length
+ *
+ * @return            - HAL state
+ *
+ * @Note              - none
+
+ */
+
+HAL_StatusTypeDef i2c_bus_receive(uint16_t dev_addr, uint8_t *buf, uint16_t len)
+{
+	if(!i2c_bus_use_it())
+	{
+		return HAL_I2C_Master_Receive(&hi2c1, dev_addr, buf, len, I2C_BUS_TIMEOUT);
+	}
+
+	xSemaphoreTake(i2c_done, 0);
+
+	return i2c_bus_wait(HAL_I2C_Master_Receive_IT(&hi2c1, dev_addr, buf, len));
+}
+
+/*********************************************************************
+ * @fn      		  - i2c_bus_delay
+ *
+ * @brief             - This function waits half of SCL period for bus recovery
+ *
+ * @param[in]         -
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - none
+ *
+ * @Note              - DWT cycle counter, independent of core clock and optimization
+
+ */
+
+static void i2c_bus_delay(void)
+{
+	dwt_delay_us(I2C_BUS_RECOVERY_HALF_US);
+}
+
+/*********************************************************************
+ * @fn      		  - i2c_bus_recover
+ *
+ * @brief             - This function frees the bus after error or timeout
+ *
+ * @param[in]         -
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - none
+ *
+ * @Note              - clocks SCL until slave releases SDA, sends STOP and
+ * 						initializes I2C1 again
+
+ */
+
+void i2c_bus_recover(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	HAL_I2C_DeInit(&hi2c1);
+
+	// 1. SCL and SDA -> open drain outputs, both released
+	GPIO_InitStruct.Pin = I2C_BUS_SCL_PIN | I2C_BUS_SDA_PIN;
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+	HAL_GPIO_WritePin(I2C_BUS_GPIO_PORT, I2C_BUS_SCL_PIN | I2C_BUS_SDA_PIN, GPIO_PIN_SET);
+	HAL_GPIO_Init(I2C_BUS_GPIO_PORT, &GPIO_InitStruct);
+
+	// 2. clock SCL until the slave releases SDA
+	for(uint8_t i = 0; i < I2C_BUS_RECOVERY_CLOCKS; i++)
+	{
+		if(HAL_GPIO_ReadPin(I2C_BUS_GPIO_PORT, I2C_BUS_SDA_PIN) == GPIO_PIN_SET) break;
+
+		HAL_GPIO_WritePin(I2C_BUS_GPIO_PORT, I2C_BUS_SCL_PIN, GPIO_PIN_RESET);
+		i2c_bus_delay();
+		HAL_GPIO_WritePin(I2C_BUS_GPIO_PORT, I2C_BUS_SCL_PIN, GPIO_PIN_SET);
+		i2c_bus_delay();
+	}
+
+	// 3. STOP condition: SDA from low to high while SCL is high
+	HAL_GPIO_WritePin(I2C_BUS_GPIO_PORT, I2C_BUS_SDA_PIN, GPIO_PIN_RESET);
+	i2c_bus_delay();
+	HAL_GPIO_WritePin(I2C_BUS_GPIO_PORT, I2C_BUS_SDA_PIN, GPIO_PIN_SET);
+	i2c_bus_delay();
+
+	// 4. return pins to I2C1 ( MspInit ) and initialize peripheral
+	HAL_I2C_Init(&hi2c1);
+}
+
+/*********************************************************************
+ * @fn      		  - i2c_bus_complete_from_isr
+ *
+ * @brief             - This function wakes the task which waits for transfer
+ *
+ * @param[in]         - I2C handle
+ * @param[in]         - result of the transfer
+ * @param[in]         -
+ *
+ * @return            - none
+ *
+ * @Note              - called from HAL callbacks in interrupt
+
+ */
+
+static void i2c_bus_complete_from_isr(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef result)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	if(hi2c->Instance != I2C1 || i2c_done == NULL) return;
+
+	i2c_result = result;
+	xSemaphoreGiveFromISR(i2c_done, &xHigherPriorityTaskWoken);
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/*
+ * HAL CALLBACKS
+ */
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	i2c_bus_complete_from_isr(hi2c, HAL_OK);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	i2c_bus_complete_from_isr(hi2c, HAL_OK);
+}
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	i2c_bus_complete_from_isr(hi2c, HAL_OK);
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	i2c_bus_complete_from_isr(hi2c, HAL_OK);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	i2c_bus_complete_from_isr(hi2c, HAL_ERROR);
+}
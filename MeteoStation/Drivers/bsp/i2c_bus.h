@@ -0,0 +1,27 @@
+#ifndef BSP_I2C_BUS_H_
+#define BSP_I2C_BUS_H_
+
+#include "main.h"
+
+// I2C handle I2C1
+extern I2C_HandleTypeDef hi2c1;
+
+/* Application configurable items */
+#define I2C_BUS_TIMEOUT					20	/* ms for one transfer */
+#define I2C_BUS_GPIO_PORT				GPIOB
+#define I2C_BUS_SCL_PIN					GPIO_PIN_8
+#define I2C_BUS_SDA_PIN					GPIO_PIN_9
+#define I2C_BUS_RECOVERY_CLOCKS			9
+#define I2C_BUS_RECOVERY_HALF_US		5	/* half of SCL period of recovery, 100 kHz */
+
+/* Function prototypes */
+HAL_StatusTypeDef i2c_bus_init(void);
+void i2c_bus_recover(void);
+
+/* Transfer functions, device address is 8 bit ( addr << 1 ) */
+HAL_StatusTypeDef i2c_bus_mem_read(uint16_t dev_addr, uint8_t reg_addr, uint8_t *buf, uint16_t len);
+HAL_StatusTypeDef i2c_bus_mem_write(uint16_t dev_addr, uint8_t reg_addr, uint8_t *buf, uint16_t len);
+HAL_StatusTypeDef i2c_bus_transmit(uint16_t dev_addr, uint8_t *buf, uint16_t len);
+HAL_StatusTypeDef i2c_bus_receive(uint16_t dev_addr, uint8_t *buf, uint16_t len);
+
+#endif /* BSP_I2C_BUS_H_ */
@@ -1,11 +1,18 @@
 #include "lcd.h"
 
-#include "lcd.h"
-
 static void write_4_bits(uint8_t num);
 static void write_4_bits_init(uint8_t num);
 static void lcd_enable(void);
 static void lcd_busy_wait(void);
+static void lcd_data_pins_mode(uint32_t mode);
+
+/* Framebuffer: text written by tasks and text shown on display */
+static char fb_next[LCD_ROWS][LCD_COLUMNS];
+static char fb_shown[LCD_ROWS][LCD_COLUMNS];
+
+/* Address counter of display, column LCD_COLUMNS means unknown position */
+static uint8_t fb_cursor_row;
+static uint8_t fb_cursor_col;
 
 /*********************************************************************
  * @fn      		  - write_4_bits
@@ -18,7 +25,7 @@ static void lcd_busy_wait(void);
  *
  * @return            - none
  *
- * @Note              - Use freeRTOS API like TaskDelay
+ * @Note              - Use DWT delay for EN pulse
 
  */
 
@@ -75,7 +82,7 @@ static void write_4_bits_init(uint8_t num)
  *
  * @return            - none
  *
- * @Note              - none
+ * @Note              - only EN pulse, execution time is waited after whole byte
 
  */
 
@@ -83,11 +90,42 @@ static void lcd_enable(void)
 {
 	// from low to high
 	HAL_GPIO_WritePin(LCD_GPIO_PORT, LCD_GPIO_EN, GPIO_PIN_SET);
-	vTaskDelay(1);
+	dwt_delay_ns(LCD_EN_PULSE_NS);
 
 	// from high to low
 	HAL_GPIO_WritePin(LCD_GPIO_PORT, LCD_GPIO_EN, GPIO_PIN_RESET);
-	vTaskDelay(1);// execution time > 37 micro seconds
+	dwt_delay_ns(LCD_EN_PULSE_NS);
+}
+
+/*********************************************************************
+ * @fn      		  - lcd_data_pins_mode
+ *
+ * @brief             - This function switches D4-D7 between input and output
+ *
+ * @param[in]         - mode, 0 for input or 1 for output
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - none
+ *
+ * @Note              - writes MODER directly, pull and speed stay from MX_GPIO_Init
+
+ */
+
+static void lcd_data_pins_mode(uint32_t mode)
+{
+	uint32_t moder = LCD_GPIO_PORT->MODER;
+
+	for(uint32_t pin = 0; pin < 16; pin++)
+	{
+		if(LCD_GPIO_DATA & (1U << pin))
+		{
+			moder &= ~(GPIO_MODER_MODER0 << (pin * 2));
+			moder |= (mode << (pin * 2));
+		}
+	}
+
+	LCD_GPIO_PORT->MODER = moder;
 }
 
 /*********************************************************************
@@ -101,44 +139,43 @@ static void lcd_enable(void)
  *
  * @return            - none
  *
- * @Note              - none
+ * @Note              - pins are switched to input once for all polls,
+ * 						waiting is limited by LCD_BUSY_TIMEOUT_US
 
  */
 
 static void lcd_busy_wait(void)
 {
-	GPIO_InitTypeDef GPIO_InitStruct = {0};
-
 	// 1. D4-D7 -> input
-	GPIO_InitStruct.Pin = LCD_GPIO_D4 | LCD_GPIO_D5 | LCD_GPIO_D6 | LCD_GPIO_D7;
-	GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
-	GPIO_InitStruct.Pull = GPIO_NOPULL;
-	HAL_GPIO_Init(LCD_GPIO_PORT, &GPIO_InitStruct);
+	lcd_data_pins_mode(0);
 
 	HAL_GPIO_WritePin(LCD_GPIO_PORT, LCD_GPIO_RS, GPIO_PIN_RESET); // command
 	HAL_GPIO_WritePin(LCD_GPIO_PORT, LCD_GPIO_RW, GPIO_PIN_SET);   // read
 
+	uint32_t start = dwt_cycles();
+	uint32_t timeout = LCD_BUSY_TIMEOUT_US * DWT_CYCLES_PER_US;
 	uint8_t busy = 1;
 
-	while (busy)
+	while (busy && (dwt_cycles() - start) < timeout)
 	{
 		// EN high
 		HAL_GPIO_WritePin(LCD_GPIO_PORT, LCD_GPIO_EN, GPIO_PIN_SET);
+		dwt_delay_ns(LCD_DATA_DELAY_NS);
 
 		// read D7
 		busy = HAL_GPIO_ReadPin(LCD_GPIO_PORT, LCD_GPIO_D7);
 
 		// EN low
+		dwt_delay_ns(LCD_EN_PULSE_NS - LCD_DATA_DELAY_NS);
 		HAL_GPIO_WritePin(LCD_GPIO_PORT, LCD_GPIO_EN, GPIO_PIN_RESET);
+		dwt_delay_ns(LCD_EN_PULSE_NS);
 
 		// dummy second cycle
-		HAL_GPIO_WritePin(LCD_GPIO_PORT, LCD_GPIO_EN, GPIO_PIN_SET);
-		HAL_GPIO_WritePin(LCD_GPIO_PORT, LCD_GPIO_EN, GPIO_PIN_RESET);
+		lcd_enable();
 	}
 
 	// return pins to OUTPUT mode
-	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
-	HAL_GPIO_Init(LCD_GPIO_PORT, &GPIO_InitStruct);
+	lcd_data_pins_mode(1);
 
 	HAL_GPIO_WritePin(LCD_GPIO_PORT, LCD_GPIO_RW, GPIO_PIN_RESET);
 }
@@ -193,6 +230,12 @@ void lcd_init(void)
 
 	/* Entry command */
 	lcd_send_command_init(LCD_CMD_INCADD);
+
+	/* Cleared display shows spaces, cursor is at home */
+	memset(fb_next, ' ', sizeof(fb_next));
+	memset(fb_shown, ' ', sizeof(fb_shown));
+	fb_cursor_row = 0;
+	fb_cursor_col = 0;
 }
 
 /*********************************************************************
@@ -223,6 +266,8 @@ void lcd_send_command(uint8_t cmd)
 
 	/* send lower 4 bits */
 	write_4_bits(cmd & 0x0F);
+
+	dwt_delay_us(LCD_EXEC_TIME_US);
 }
 
 /*********************************************************************
@@ -283,6 +328,8 @@ void lcd_print_char(uint8_t data)
 
 	/* send lower 4 bits */
 	write_4_bits(data & 0x0F);
+
+	dwt_delay_us(LCD_EXEC_TIME_US);
 }
 
 /*********************************************************************
@@ -415,3 +462,98 @@ void lcd_set_cursor(uint8_t row, uint8_t column)
       break;
   }
 }
+
+/*********************************************************************
+ * @fn      		  - lcd_fb_write
+ *
+ * @brief             - This function writes text into framebuffer
+ *
+ * @param[in]         - row from 1 to 2
+ * @param[in]         -	column from 1 to 16
+ * @param[in]         - text, it is cut at the end of row
+ *
+ * @return            - none
+ *
+ * @Note              - display is not changed until lcd_fb_flush
+
+ */
+
+void lcd_fb_write(uint8_t row, uint8_t column, const char *text)
+{
+	if(row < 1 || row > LCD_ROWS || column < 1) return;
+
+	for(uint8_t col = column - 1; col < LCD_COLUMNS && *text != '\0'; col++)
+	{
+		fb_next[row - 1][col] = *text++;
+	}
+}
+
+/*********************************************************************
+ * @fn      		  - lcd_fb_flush
+ *
+ * @brief             - This function sends changed cells of framebuffer to LCD
+ *
+ * @param[in]         -
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - none
+ *
+ * @Note              - cursor is moved only if it isn't already at the cell,
+ * 						gap of one unchanged cell is rewritten instead,
+ * 						it costs the same as cursor command
+
+ */
+
+void lcd_fb_flush(void)
+{
+	for(uint8_t row = 0; row < LCD_ROWS; row++)
+	{
+		for(uint8_t col = 0; col < LCD_COLUMNS; col++)
+		{
+			if(fb_next[row][col] == fb_shown[row][col]) continue;
+
+			// one unchanged cell before cursor target is written through
+			if(fb_cursor_row == row && fb_cursor_col + 1 == col)
+			{
+				lcd_print_char((uint8_t)fb_next[row][fb_cursor_col]);
+				fb_shown[row][fb_cursor_col] = fb_next[row][fb_cursor_col];
+				fb_cursor_col++;
+			}
+
+			if(fb_cursor_row != row || fb_cursor_col != col)
+			{
+				lcd_set_cursor(row + 1, col + 1);
+				fb_cursor_row = row;
+				fb_cursor_col = col;
+			}
+
+			lcd_print_char((uint8_t)fb_next[row][col]);
+			fb_shown[row][col] = fb_next[row][col];
+
+			// address counter doesn't continue into next row
+			fb_cursor_col++;
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      		  - lcd_fb_invalidate
+ *
+ * @brief             - This function makes next flush send all cells
+ *
+ * @param[in]         -
+ * @param[in]         -
+ * @param[in]         -
+ *
+ * @return            - none
+ *
+ * @Note              - use it if display was changed without framebuffer
+
+ */
+
+void lcd_fb_invalidate(void)
+{
+	memset(fb_shown, 0, sizeof(fb_shown));
+	fb_cursor_col = LCD_COLUMNS;
+}
@@ -2,6 +2,7 @@
 #define BSP_LCD_H_
 
 #include "main.h"
+#include "dwt.h"
 
 /* Application configurable items */
 #define LCD_GPIO_PORT					GPIOD
@@ -15,6 +16,17 @@
 #define LCD_GPIO_D5						GPIO_PIN_4
 #define LCD_GPIO_D6						GPIO_PIN_5
 #define LCD_GPIO_D7						GPIO_PIN_6
+#define LCD_GPIO_DATA					(LCD_GPIO_D4 | LCD_GPIO_D5 | LCD_GPIO_D6 | LCD_GPIO_D7)
+
+/* Timings from HD44780 datasheet */
+#define LCD_EN_PULSE_NS					500		/* EN high and low time, cycle is 1000 ns */
+#define LCD_DATA_DELAY_NS				360		/* from EN high to valid busy flag */
+#define LCD_EXEC_TIME_US				40		/* command and data execution time is 37 us */
+#define LCD_BUSY_TIMEOUT_US				5000	/* clear and return home take 1.52 ms */
+
+/* Display size */
+#define LCD_ROWS						2
+#define LCD_COLUMNS						16
 
 /* LCD commands */
 #define LCD_CMD_4DL_2N_5X8F				0x28 /* 4 bit, 2 lines, 5x8 font-size */
@@ -42,6 +54,11 @@ void lcd_display_clear_init(void);
 void lcd_display_return_home(void);
 void lcd_set_cursor(uint8_t row, uint8_t column);
 
+/* Framebuffer APIs, text is written into RAM and flush sends only changed cells */
+void lcd_fb_write(uint8_t row, uint8_t column, const char *text);
+void lcd_fb_flush(void);
+void lcd_fb_invalidate(void);
+
 
 
 #endif /* BSP_LCD_H_ */
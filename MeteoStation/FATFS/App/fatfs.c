@@ -34,6 +34,10 @@ void MX_FATFS_Init(void)
 
   /* USER CODE BEGIN Init */
   /* additional user code for init */
+#if SD_IO_STATS
+  /* FatFs calls SD_Driver through the I/O counting shim */
+  retSD = sd_io_stats_link(&SD_Driver, SDPath);
+#endif
   /* USER CODE END Init */
 }
 
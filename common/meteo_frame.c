@@ -0,0 +1,194 @@
+#include "meteo_frame.h"
+#include <string.h>
+
+/* result of check of parser buffer */
+#define FRAME_MORE			0
+#define FRAME_GOOD			1
+#define FRAME_BAD_SYNC		2
+#define FRAME_BAD_HEADER	3
+#define FRAME_BAD_CRC		4
+
+/* header must be 8 bytes on both compilers */
+typedef char meteo_frame_header_size_check[(sizeof(meteo_frame_header_t) == 8) ? 1 : -1];
+
+/* CRC16-CCITT polynomial 0x1021, table for 4 bits */
+static const uint16_t crc16_table[16] =
+{
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/***************************************************************
+ * Calculate CRC16 of data
+ * Start with crc = 0xFFFF, continue with result of previous call
+ ***************************************************************/
+
+uint16_t meteo_frame_crc16(uint16_t crc, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+
+	while(len--)
+	{
+		crc = (uint16_t)(crc << 4) ^ crc16_table[(crc >> 12) ^ (*p >> 4)];
+		crc = (uint16_t)(crc << 4) ^ crc16_table[(crc >> 12) ^ (*p & 0x0F)];
+		p++;
+	}
+
+	return crc;
+}
+
+/***************************************************************
+ * Build frame in buf
+ * Returns frame length, 0 if count or size is wrong
+ ***************************************************************/
+
+size_t meteo_frame_encode(uint8_t *buf, size_t size, uint8_t type, uint16_t seq, const void *records, uint8_t count)
+{
+	meteo_frame_header_t *header = (meteo_frame_header_t*)buf;
+	size_t payload = (size_t)count * METEO_FRAME_RECORD_SIZE;
+	size_t len = sizeof(meteo_frame_header_t) + payload + METEO_FRAME_CRC_SIZE;
+
+	if(count > METEO_FRAME_MAX_RECORDS || len > size) return 0;
+
+	header->sync[0] = METEO_FRAME_SYNC0;
+	header->sync[1] = METEO_FRAME_SYNC1;
+	header->version = METEO_FRAME_VERSION;
+	header->type = type;
+	header->seq = seq;
+	header->count = count;
+	header->record_size = METEO_FRAME_RECORD_SIZE;
+
+	if(payload) memcpy(buf + sizeof(meteo_frame_header_t), records, payload);
+
+	// crc doesn't cover sync bytes
+	uint16_t crc = meteo_frame_crc16(0xFFFF, buf + 2, len - 2 - METEO_FRAME_CRC_SIZE);
+	buf[len - 2] = (uint8_t)(crc & 0xFF);
+	buf[len - 1] = (uint8_t)(crc >> 8);
+
+	return len;
+}
+
+/***************************************************************
+ * Prepare parser, statistics are cleared
+ ***************************************************************/
+
+void meteo_frame_parser_init(meteo_frame_parser_t *parser)
+{
+	memset(parser, 0, sizeof(meteo_frame_parser_t));
+}
+
+/***************************************************************
+ * Check bytes collected in parser buffer
+ * Wrong byte is found as soon as it arrives, so a frame that
+ * starts inside a bad one is not missed
+ ***************************************************************/
+
+static int meteo_frame_check(const meteo_frame_parser_t *parser)
+{
+	const uint8_t *buf = parser->buf;
+	const meteo_frame_header_t *header = (const meteo_frame_header_t*)buf;
+
+	if(buf[0] != METEO_FRAME_SYNC0) return FRAME_BAD_SYNC;
+	if(parser->len < 2) return FRAME_MORE;
+	if(buf[1] != METEO_FRAME_SYNC1) return FRAME_BAD_SYNC;
+	if(parser->len < sizeof(meteo_frame_header_t)) return FRAME_MORE;
+
+	if(header->version != METEO_FRAME_VERSION || header->type != METEO_FRAME_TYPE_SAMPLES ||
+	   header->count > METEO_FRAME_MAX_RECORDS || header->record_size != METEO_FRAME_RECORD_SIZE)
+	{
+		return FRAME_BAD_HEADER;
+	}
+
+	size_t len = sizeof(meteo_frame_header_t) + (size_t)header->count * METEO_FRAME_RECORD_SIZE + METEO_FRAME_CRC_SIZE;
+	if(parser->len < len) return FRAME_MORE;
+
+	uint16_t crc = meteo_frame_crc16(0xFFFF, buf + 2, len - 2 - METEO_FRAME_CRC_SIZE);
+	if(buf[len - 2] != (uint8_t)(crc & 0xFF) || buf[len - 1] != (uint8_t)(crc >> 8)) return FRAME_BAD_CRC;
+
+	return FRAME_GOOD;
+}
+
+/***************************************************************
+ * Take decoded frame from parser buffer and check sequence
+ * Bytes after the frame stay in the buffer, they were collected
+ * while a false frame start before this frame was checked
+ ***************************************************************/
+
+static void meteo_frame_take(meteo_frame_parser_t *parser, meteo_frame_t *frame)
+{
+	const meteo_frame_header_t *header = (const meteo_frame_header_t*)parser->buf;
+	size_t len = sizeof(meteo_frame_header_t) + (size_t)header->count * METEO_FRAME_RECORD_SIZE + METEO_FRAME_CRC_SIZE;
+
+	frame->type = header->type;
+	frame->seq = header->seq;
+	frame->count = header->count;
+	memcpy(frame->payload, parser->buf + sizeof(meteo_frame_header_t), (size_t)frame->count * METEO_FRAME_RECORD_SIZE);
+
+	// sequence number behind expected one means restart of sender, it isn't counted
+	if(parser->seq_valid)
+	{
+		uint16_t gap = (uint16_t)(frame->seq - parser->next_seq);
+		if(gap < 0x8000) parser->lost += gap;
+	}
+
+	parser->next_seq = (uint16_t)(frame->seq + 1);
+	parser->seq_valid = 1;
+	parser->frames++;
+	parser->len -= len;
+	memmove(parser->buf, parser->buf + len, parser->len);
+}
+
+/***************************************************************
+ * Feed bytes into parser
+ * Stops after the first decoded frame, status is METEO_FRAME_OK
+ * Returns number of used bytes, call again with the rest of data
+ * Bytes kept after the previous frame are checked first, so a
+ * frame may be returned without using new bytes
+ * On error the first byte is dropped and search continues in
+ * the collected bytes, so parser resynchronizes by itself
+ ***************************************************************/
+
+size_t meteo_frame_parse(meteo_frame_parser_t *parser, const uint8_t *data, size_t len, meteo_frame_t *frame, meteo_frame_status_t *status)
+{
+	size_t used = 0;
+
+	*status = METEO_FRAME_NONE;
+
+	for(;;)
+	{
+		while(parser->len > 0)
+		{
+			int ret = meteo_frame_check(parser);
+
+			if(ret == FRAME_MORE) break;
+
+			if(ret == FRAME_GOOD)
+			{
+				meteo_frame_take(parser, frame);
+				*status = METEO_FRAME_OK;
+				return used;
+			}
+
+			if(ret == FRAME_BAD_HEADER) parser->header_errors++;
+			else if(ret == FRAME_BAD_CRC) parser->crc_errors++;
+			else if(parser->buf[0] != 0) parser->skipped++;
+
+			parser->len--;
+			memmove(parser->buf, parser->buf + 1, parser->len);
+		}
+
+		if(used == len) break;
+		parser->buf[parser->len++] = data[used++];
+	}
+
+	return used;
+}
+
+/***************************************************************
+ * Copy record of decoded frame, record size is METEO_FRAME_RECORD_SIZE
+ ***************************************************************/
+
+void meteo_frame_get_record(const meteo_frame_t *frame, uint8_t index, void *record)
+{
+	memcpy(record, frame->payload + (size_t)index * METEO_FRAME_RECORD_SIZE, METEO_FRAME_RECORD_SIZE);
+}
@@ -0,0 +1,93 @@
+#ifndef METEO_FRAME_H_
+#define METEO_FRAME_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* STM32 -> ESP32 SPI frame, shared by both firmwares
+ *
+ * | sync 0xA5 0x5A | version | type | seq | count | record_size | records | crc |
+ *
+ * every SPI transaction is METEO_FRAME_SPI_SIZE bytes, frame starts at byte 0
+ * and the rest is filled with zeros, parser doesn't depend on it and
+ * finds frames in any byte stream
+ * crc is CRC16-CCITT ( 0x1021, init 0xFFFF ) from version to the last record
+ * all values are little endian
+ */
+
+#define METEO_FRAME_SYNC0			0xA5
+#define METEO_FRAME_SYNC1			0x5A
+#define METEO_FRAME_VERSION			1
+
+/* frame types */
+#define METEO_FRAME_TYPE_SAMPLES	0x01	/* records are meteo_msg_t ( measurement_t on ESP32 ) */
+
+#define METEO_FRAME_RECORD_SIZE		13		/* sizeof(meteo_msg_t) */
+#define METEO_FRAME_MAX_RECORDS		8
+
+typedef struct __attribute__((packed))
+{
+	uint8_t sync[2];		/* METEO_FRAME_SYNC0, METEO_FRAME_SYNC1 */
+	uint8_t version;		/* METEO_FRAME_VERSION */
+	uint8_t type;			/* METEO_FRAME_TYPE_x */
+	uint16_t seq;			/* incremented for every frame, wraps around */
+	uint8_t count;			/* number of records */
+	uint8_t record_size;	/* METEO_FRAME_RECORD_SIZE */
+
+}meteo_frame_header_t;
+
+#define METEO_FRAME_CRC_SIZE		2
+#define METEO_FRAME_MAX_PAYLOAD		(METEO_FRAME_MAX_RECORDS * METEO_FRAME_RECORD_SIZE)
+#define METEO_FRAME_MAX_SIZE		(sizeof(meteo_frame_header_t) + METEO_FRAME_MAX_PAYLOAD + METEO_FRAME_CRC_SIZE)
+
+/* length of one SPI transaction, multiple of 4 for ESP32 slave DMA */
+#define METEO_FRAME_SPI_SIZE		((METEO_FRAME_MAX_SIZE + 3) & ~3U)
+
+/* decoded frame */
+typedef struct
+{
+	uint8_t type;
+	uint16_t seq;
+	uint8_t count;
+	uint8_t payload[METEO_FRAME_MAX_PAYLOAD];
+
+}meteo_frame_t;
+
+/* parser result */
+typedef enum
+{
+	METEO_FRAME_NONE = 0,		/* more bytes needed */
+	METEO_FRAME_OK,				/* frame is decoded */
+
+}meteo_frame_status_t;
+
+/* stream parser, keeps part of frame between calls */
+typedef struct
+{
+	uint8_t buf[METEO_FRAME_MAX_SIZE];
+	uint16_t len;
+
+	uint16_t next_seq;			/* expected sequence number */
+	uint8_t seq_valid;			/* set after the first frame */
+
+	/* statistics */
+	uint32_t frames;			/* good frames */
+	uint32_t crc_errors;		/* frames with bad crc */
+	uint32_t header_errors;		/* sync found, but version, type or sizes are wrong */
+	uint32_t skipped;			/* bytes dropped while searching sync, zero padding isn't counted */
+	uint32_t lost;				/* frames missing in sequence */
+
+}meteo_frame_parser_t;
+
+/* CRC16-CCITT */
+uint16_t meteo_frame_crc16(uint16_t crc, const void *data, size_t len);
+
+/* Encoder, returns frame length or 0 if it doesn't fit into buf */
+size_t meteo_frame_encode(uint8_t *buf, size_t size, uint8_t type, uint16_t seq, const void *records, uint8_t count);
+
+/* Decoder */
+void meteo_frame_parser_init(meteo_frame_parser_t *parser);
+size_t meteo_frame_parse(meteo_frame_parser_t *parser, const uint8_t *data, size_t len, meteo_frame_t *frame, meteo_frame_status_t *status);
+void meteo_frame_get_record(const meteo_frame_t *frame, uint8_t index, void *record);
+
+#endif /* METEO_FRAME_H_ */
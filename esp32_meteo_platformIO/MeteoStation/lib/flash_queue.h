@@ -0,0 +1,49 @@
+#ifndef FLASH_QUEUE_H
+#define FLASH_QUEUE_H
+
+#include "esp_err.h"
+#include "global_values.h"
+
+// Persistent FIFO of samples in raw data partition, see partitions.csv
+#define FLASH_QUEUE_PARTITION   "meteoq"
+#define FLASH_QUEUE_SUBTYPE     0x40
+#define FLASH_QUEUE_MAGIC       0x3151514DUL   // "MQQ1"
+
+// Partition is a ring of sectors, sectors are erased in order, so wear is even.
+// Every sector starts with header slot, then slots of records.
+#define FLASH_QUEUE_SECTOR_SIZE 4096
+#define FLASH_QUEUE_SLOT_SIZE   16
+#define FLASH_QUEUE_SLOTS       (FLASH_QUEUE_SECTOR_SIZE / FLASH_QUEUE_SLOT_SIZE)   // slot 0 is header
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         // FLASH_QUEUE_MAGIC
+    uint32_t seq;           // incremented for every erased sector, the biggest one is head
+    uint8_t reserved[8];
+} flash_queue_header_t;
+
+typedef struct __attribute__((packed)) {
+    measurement_t sample;
+    uint8_t crc;            // CRC8 of sample, slot with bad crc is skipped
+    uint8_t written;        // 0xFF empty, FLASH_QUEUE_WRITTEN after write
+    uint8_t sent;           // 0xFF pending, 0x00 sent, bits are only cleared
+} flash_queue_slot_t;
+
+#define FLASH_QUEUE_WRITTEN     0x5A
+#define FLASH_QUEUE_SENT        0x00
+
+typedef struct {
+    uint32_t pending;       // samples waiting for upload
+    uint32_t stored;        // samples written since boot
+    uint32_t dropped;       // oldest samples erased because queue was full
+    uint32_t errors;        // flash read/write errors
+} flash_queue_stats_t;
+
+// Queue is used only by set_data_on_site_task, functions are not thread safe
+esp_err_t flash_queue_init(void);
+esp_err_t flash_queue_push(const measurement_t *sample);
+uint32_t flash_queue_count(void);
+int flash_queue_peek(measurement_t *samples, int max);
+esp_err_t flash_queue_pop(int count);
+void flash_queue_get_stats(flash_queue_stats_t *stats);
+
+#endif // FLASH_QUEUE_H
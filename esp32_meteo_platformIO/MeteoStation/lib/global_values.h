@@ -13,17 +13,26 @@
 #define SPI_MOSI_PIN 26
 #define READY_PIN 12
 
-// Structure to hold measurement data
+// Structure to hold measurement data, same layout as meteo_msg_t on stm32
 typedef struct __attribute__((packed)) {
-    float temperature;
-    float humidity;
-    float pressure;
+    uint32_t epoch;         // utc seconds since 1970, stm32 sends its local wall clock
+    int16_t temperature;    // 0.01 degC
+    uint16_t humidity;      // 0.01 %rH
+    uint32_t pressure;      // Pa
+    uint8_t flags;
 } measurement_t;
 
+#define METEO_FLAG_RTC_ERR      (1 << 0)
+#define METEO_FLAG_SENSOR_ERR   (1 << 1)
+
 extern spi_host_device_t SPI_HOST_STM;
+
+// Wall clock of stm32 minus utc, fixed when the time is sent to stm32 at boot
+extern int32_t stm32_utc_offset;
 extern SemaphoreHandle_t spi_mutex;
 
-// queue to hold measurement data
+// queue to hold measurement data, upload task moves them to flash while server is down
+#define METEO_QUEUE_LENGTH 32
 extern QueueHandle_t meteo_data_queue;
 
 #endif // GLOBAL_VALUES_H
\ No newline at end of file
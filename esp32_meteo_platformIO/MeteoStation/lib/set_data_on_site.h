@@ -6,7 +6,33 @@
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
 
+// Batch is posted after UPLOAD_BATCH_MAX samples or UPLOAD_BATCH_MS after its first sample
+#define UPLOAD_BATCH_MAX 6
+#define UPLOAD_BATCH_MS 60000
+#define UPLOAD_SAMPLE_JSON_SIZE 96  // max length of one sample in JSON array
+
+// Samples from flash queue are posted in bigger batches, failed upload is retried after UPLOAD_RETRY_MS
+#define UPLOAD_FLASH_BATCH 30
+#define UPLOAD_RETRY_MS 30000
+
+// Statistics are logged after every HTTPS_STATS_PERIOD requests
+#define HTTPS_STATS_PERIOD 10
+
+// Statistics of persistent https client
+typedef struct {
+    uint32_t requests;      // requests with 2xx response
+    uint32_t failures;      // transport errors and other responses
+    uint32_t rejected;      // 4xx responses, their batch is not retried
+    uint32_t dropped;       // samples of rejected batches
+    uint32_t connects;      // client was created, first one and after errors
+    uint32_t last_ms;       // latency of the last request
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint64_t total_ms;      // sum of latency of all requests
+} https_stats_t;
+
 void set_data_on_site_task(void*);
+void https_get_stats(https_stats_t *stats);
 void spi_get_meteo_data_task(void*);
 esp_err_t https_event_handler(esp_http_client_event_handle_t event);
 
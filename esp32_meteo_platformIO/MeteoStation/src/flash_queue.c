@@ -0,0 +1,321 @@
+#include "flash_queue.h"
+#include "esp_partition.h"
+#include <string.h>
+
+static const char *TAG = "flash_queue";
+
+_Static_assert(sizeof(flash_queue_header_t) == FLASH_QUEUE_SLOT_SIZE, "header must fill one slot");
+_Static_assert(sizeof(flash_queue_slot_t) == FLASH_QUEUE_SLOT_SIZE, "record must fill one slot");
+
+static const esp_partition_t *partition = NULL;
+static uint32_t sectors;
+
+// next slot to write and the oldest pending slot
+static uint32_t head_sector, head_slot;
+static uint32_t tail_sector, tail_slot;
+static uint32_t head_seq;
+
+static flash_queue_stats_t stats;
+
+// CRC8, polynomial 0x07
+static uint8_t crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+
+    while(len--)
+    {
+        crc ^= *data++;
+        for(int i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static size_t slot_offset(uint32_t sector, uint32_t slot)
+{
+    return (size_t)sector * FLASH_QUEUE_SECTOR_SIZE + (size_t)slot * FLASH_QUEUE_SLOT_SIZE;
+}
+
+static bool sector_valid(uint32_t sector, uint32_t *seq)
+{
+    flash_queue_header_t header;
+
+    if(esp_partition_read(partition, slot_offset(sector, 0), &header, sizeof(header)) != ESP_OK)
+    {
+        stats.errors++;
+        return false;
+    }
+
+    if(header.magic != FLASH_QUEUE_MAGIC) return false;
+
+    if(seq) *seq = header.seq;
+    return true;
+}
+
+static esp_err_t sector_start(uint32_t sector, uint32_t seq)
+{
+    flash_queue_header_t header;
+
+    memset(&header, 0xFF, sizeof(header));
+    header.magic = FLASH_QUEUE_MAGIC;
+    header.seq = seq;
+
+    esp_err_t ret = esp_partition_erase_range(partition, slot_offset(sector, 0), FLASH_QUEUE_SECTOR_SIZE);
+    if(ret == ESP_OK) ret = esp_partition_write(partition, slot_offset(sector, 0), &header, sizeof(header));
+    if(ret != ESP_OK) stats.errors++;
+
+    return ret;
+}
+
+// Slot torn by power loss has written mark 0xFF too, but it can't be written again
+static bool slot_empty(const flash_queue_slot_t *slot)
+{
+    const uint8_t *bytes = (const uint8_t*)slot;
+
+    for(size_t i = 0; i < sizeof(*slot); i++)
+    {
+        if(bytes[i] != 0xFF) return false;
+    }
+
+    return true;
+}
+
+static bool slot_pending(const flash_queue_slot_t *slot)
+{
+    return slot->written == FLASH_QUEUE_WRITTEN && slot->sent == 0xFF &&
+           slot->crc == crc8((const uint8_t*)&slot->sample, sizeof(measurement_t));
+}
+
+// Find the next pending slot from (sector, slot) up to head, position is updated
+static bool next_pending(uint32_t *sector, uint32_t *slot, flash_queue_slot_t *out)
+{
+    while(!(*sector == head_sector && *slot >= head_slot))
+    {
+        if(*slot >= FLASH_QUEUE_SLOTS)
+        {
+            *sector = (*sector + 1) % sectors;
+            *slot = 1;
+
+            // erased or broken sector, its records are lost
+            if(*sector != head_sector && !sector_valid(*sector, NULL)) *slot = FLASH_QUEUE_SLOTS;
+            continue;
+        }
+
+        if(esp_partition_read(partition, slot_offset(*sector, *slot), out, sizeof(*out)) != ESP_OK)
+        {
+            stats.errors++;
+            return false;
+        }
+
+        if(slot_empty(out))
+        {
+            // rest of this sector was never written
+            *slot = FLASH_QUEUE_SLOTS;
+            continue;
+        }
+
+        if(slot_pending(out)) return true;
+        (*slot)++;
+    }
+
+    return false;
+}
+
+esp_err_t flash_queue_init(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, FLASH_QUEUE_SUBTYPE, FLASH_QUEUE_PARTITION);
+    if(partition == NULL)
+    {
+        ESP_LOGE(TAG, "Partition %s is not found", FLASH_QUEUE_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    sectors = partition->size / FLASH_QUEUE_SECTOR_SIZE;
+    if(sectors < 2) return ESP_ERR_INVALID_SIZE;
+
+    // Head is the sector with the biggest sequence number
+    bool found = false;
+    for(uint32_t i = 0; i < sectors; i++)
+    {
+        uint32_t seq;
+        if(sector_valid(i, &seq) && (!found || (int32_t)(seq - head_seq) > 0))
+        {
+            head_sector = i;
+            head_seq = seq;
+            found = true;
+        }
+    }
+
+    if(!found)
+    {
+        ESP_LOGI(TAG, "Partition is empty, formatting");
+        head_sector = 0;
+        head_seq = 1;
+        head_slot = 1;
+        tail_sector = head_sector;
+        tail_slot = head_slot;
+        return sector_start(head_sector, head_seq);
+    }
+
+    // First empty slot of head sector
+    flash_queue_slot_t slot;
+    for(head_slot = 1; head_slot < FLASH_QUEUE_SLOTS; head_slot++)
+    {
+        if(esp_partition_read(partition, slot_offset(head_sector, head_slot), &slot, sizeof(slot)) != ESP_OK) return ESP_FAIL;
+        if(slot_empty(&slot)) break;
+    }
+
+    // Oldest sector follows head in the ring, find the first pending slot and count the rest
+    uint32_t sector = (head_sector + 1) % sectors, pos = 1;
+    bool tail_found = false;
+
+    if(!sector_valid(sector, NULL)) pos = FLASH_QUEUE_SLOTS;
+
+    stats.pending = 0;
+    while(next_pending(&sector, &pos, &slot))
+    {
+        if(!tail_found)
+        {
+            tail_sector = sector;
+            tail_slot = pos;
+            tail_found = true;
+        }
+        stats.pending++;
+        pos++;
+    }
+
+    if(!tail_found)
+    {
+        tail_sector = head_sector;
+        tail_slot = head_slot;
+    }
+
+    ESP_LOGI(TAG, "%lu sectors, head %lu:%lu, %lu samples pending", (unsigned long)sectors,
+             (unsigned long)head_sector, (unsigned long)head_slot, (unsigned long)stats.pending);
+
+    return ESP_OK;
+}
+
+esp_err_t flash_queue_push(const measurement_t *sample)
+{
+    if(partition == NULL) return ESP_ERR_INVALID_STATE;
+
+    if(head_slot >= FLASH_QUEUE_SLOTS)
+    {
+        uint32_t next = (head_sector + 1) % sectors;
+
+        // queue is full, the oldest sector is erased with its samples
+        if(stats.pending > 0 && tail_sector == next)
+        {
+            flash_queue_slot_t slot;
+            uint32_t sector = tail_sector, pos = tail_slot, lost = 0;
+
+            while(sector == next && next_pending(&sector, &pos, &slot) && sector == next)
+            {
+                lost++;
+                pos++;
+            }
+
+            stats.pending -= lost;
+            stats.dropped += lost;
+
+            tail_sector = (next + 1) % sectors;
+            tail_slot = 1;
+            ESP_LOGW(TAG, "Queue is full, %lu oldest samples are dropped", (unsigned long)lost);
+        }
+
+        esp_err_t ret = sector_start(next, head_seq + 1);
+        if(ret != ESP_OK) return ret;
+
+        head_sector = next;
+        head_seq++;
+        head_slot = 1;
+    }
+
+    flash_queue_slot_t slot;
+    memset(&slot, 0xFF, sizeof(slot));
+    slot.sample = *sample;
+    slot.crc = crc8((const uint8_t*)sample, sizeof(measurement_t));
+    slot.written = FLASH_QUEUE_WRITTEN;
+
+    esp_err_t ret = esp_partition_write(partition, slot_offset(head_sector, head_slot), &slot, sizeof(slot));
+    if(ret != ESP_OK)
+    {
+        stats.errors++;
+        return ret;
+    }
+
+    if(stats.pending == 0)
+    {
+        tail_sector = head_sector;
+        tail_slot = head_slot;
+    }
+
+    head_slot++;
+    stats.pending++;
+    stats.stored++;
+
+    return ESP_OK;
+}
+
+uint32_t flash_queue_count(void)
+{
+    return stats.pending;
+}
+
+// Read up to max oldest samples, they stay in queue until flash_queue_pop
+int flash_queue_peek(measurement_t *samples, int max)
+{
+    flash_queue_slot_t slot;
+    uint32_t sector = tail_sector, pos = tail_slot;
+    int count = 0;
+
+    if(partition == NULL) return 0;
+
+    while(count < max && next_pending(&sector, &pos, &slot))
+    {
+        samples[count++] = slot.sample;
+        pos++;
+    }
+
+    return count;
+}
+
+// Mark count oldest samples as sent, sector is erased only when head comes to it again
+esp_err_t flash_queue_pop(int count)
+{
+    static const uint8_t sent = FLASH_QUEUE_SENT;
+    flash_queue_slot_t slot;
+
+    if(partition == NULL) return ESP_ERR_INVALID_STATE;
+
+    while(count > 0 && next_pending(&tail_sector, &tail_slot, &slot))
+    {
+        size_t offset = slot_offset(tail_sector, tail_slot) + offsetof(flash_queue_slot_t, sent);
+        if(esp_partition_write(partition, offset, &sent, sizeof(sent)) != ESP_OK)
+        {
+            stats.errors++;
+            return ESP_FAIL;
+        }
+
+        tail_slot++;
+        stats.pending--;
+        count--;
+    }
+
+    if(stats.pending == 0)
+    {
+        tail_sector = head_sector;
+        tail_slot = head_slot;
+    }
+
+    return ESP_OK;
+}
+
+void flash_queue_get_stats(flash_queue_stats_t *stats_out)
+{
+    *stats_out = stats;
+}
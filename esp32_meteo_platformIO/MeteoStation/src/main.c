@@ -5,6 +5,8 @@
 #include "esp_sntp.h"
 #include "time.h"
 #include "global_values.h"
+#include "flash_queue.h"
+#include "soc/gpio_reg.h"
 
 static const char *TAG = "main";
 TaskHandle_t set_data_on_site_handle = NULL;
@@ -12,6 +14,9 @@ TaskHandle_t spi_get_meteo_data_handle = NULL;
 
 static struct tm g_timeinfo;
 
+// Offset of the wall clock sent to stm32 from utc, stm32 clock doesn't follow DST changes
+int32_t stm32_utc_offset = 0;
+
 //WORD_ALIGNED_ATTR static char spi_slave_tx_buf[32];
 WORD_ALIGNED_ATTR static char spi_slave_rx_buf[32];
 
@@ -65,14 +70,34 @@ esp_err_t get_curr_time()
     time(&now);
     localtime_r(&now, &g_timeinfo);
 
+    // newlib has no tm_gmtoff, offset is the difference of local and utc fields
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    int32_t days = g_timeinfo.tm_yday - utc.tm_yday;
+    if(g_timeinfo.tm_year != utc.tm_year) days = (g_timeinfo.tm_year > utc.tm_year) ? 1 : -1;
+    stm32_utc_offset = days * 86400 + (g_timeinfo.tm_hour - utc.tm_hour) * 3600 +
+                       (g_timeinfo.tm_min - utc.tm_min) * 60 + (g_timeinfo.tm_sec - utc.tm_sec);
+
     // Format and print the date and time
     char strftime_buf[64];
     strftime(strftime_buf, sizeof(strftime_buf), "%H:%M:%S%d.%m.%y", &g_timeinfo);
-    ESP_LOGI(TAG, "Current time: %s", strftime_buf);
+    ESP_LOGI(TAG, "Current time: %s, utc offset %ld s", strftime_buf, (long)stm32_utc_offset);
 
     return ESP_OK;
 }
 
+// Called after transaction is queued, stm32 may clock it now
+static void IRAM_ATTR spi_post_setup_cb(spi_slave_transaction_t *trans)
+{
+    WRITE_PERI_REG(GPIO_OUT_W1TS_REG, (1 << READY_PIN));
+}
+
+// Called after transaction is finished, stm32 waits for the next rising edge
+static void IRAM_ATTR spi_post_trans_cb(spi_slave_transaction_t *trans)
+{
+    WRITE_PERI_REG(GPIO_OUT_W1TC_REG, (1 << READY_PIN));
+}
+
 esp_err_t spi_init(void)
 {
     // Create SPI mutex
@@ -94,6 +119,8 @@ esp_err_t spi_init(void)
         .spics_io_num = SPI_NSS_PIN,
         .flags = 0,
         .queue_size = 10,
+        .post_setup_cb = spi_post_setup_cb,
+        .post_trans_cb = spi_post_trans_cb,
     };
 
     // Initialize SPI bus
@@ -121,13 +148,12 @@ void set_curr_time(void)
 
     ESP_LOGI(TAG, "Wait for spi tanssmit: %s", data);
 
+    // READY is driven by spi callbacks
     xSemaphoreTake(spi_mutex, portMAX_DELAY);
-    gpio_set_level(READY_PIN, 1); // Indicate ready to receive
     esp_err_t ret = spi_slave_transmit(SPI_HOST_STM, &trans_desc, portMAX_DELAY);
     xSemaphoreGive(spi_mutex);
 
     printf("SPI transmit result: %d\n", ret);
-    gpio_set_level(READY_PIN, 0); // Indicate ready to receive
 }
 
 void app_main() 
@@ -181,8 +207,15 @@ void app_main()
 
     vTaskDelay(pdMS_TO_TICKS(2000)); // Delay before starting the task
 
+    // Samples which were not uploaded are kept in flash, so failure here only loses them on power off
+    ret = flash_queue_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Flash queue initialization failed");
+    }
+    else ESP_LOGI(TAG, "Flash queue initialization successful");
+
     // Create queue
-    meteo_data_queue = xQueueCreate(2, sizeof(measurement_t));
+    meteo_data_queue = xQueueCreate(METEO_QUEUE_LENGTH, sizeof(measurement_t));
 
     xTaskCreate(&spi_get_meteo_data_task, "spi_get_meteo_data_task", 4096, NULL, 5, &spi_get_meteo_data_handle);
     configASSERT(spi_get_meteo_data_handle != NULL);
@@ -1,5 +1,12 @@
 #include "set_data_on_site.h"
 #include "global_values.h"
+#include "meteo_frame.h"
+#include "flash_queue.h"
+#include "esp_timer.h"
+#include "time.h"
+
+// records of SPI frame are measurement_t
+_Static_assert(sizeof(measurement_t) == METEO_FRAME_RECORD_SIZE, "measurement_t doesn't match SPI frame record");
 
 static const char *TAG = "https_client_task";
 static const char *TAG2 = "spi_meteo_data";
@@ -10,20 +17,30 @@ extern QueueHandle_t meteo_data_queue;
 // SPI mutex
 extern SemaphoreHandle_t spi_mutex;
 
+// Long-lived client, connection and TLS session are kept between requests
+static esp_http_client_handle_t https_handle = NULL;
+static https_stats_t https_stats = { .min_ms = UINT32_MAX };
+
 void spi_get_meteo_data_task(void* pvParameters)
 {
     static measurement_t meteo_data;
-    // Implementation to get meteo data from SPI
-    uint8_t rx_buf[sizeof(measurement_t)];
-    uint8_t tx_buf[sizeof(measurement_t)] = {0};
+    static meteo_frame_parser_t parser;
+    static meteo_frame_t frame;
+    // Implementation to get meteo data from SPI, one transaction carries one frame
+    WORD_ALIGNED_ATTR static uint8_t rx_buf[METEO_FRAME_SPI_SIZE];
+    WORD_ALIGNED_ATTR static uint8_t tx_buf[METEO_FRAME_SPI_SIZE] = {0};
 
     spi_slave_transaction_t data = 
     {
         .tx_buffer = tx_buf,
         .rx_buffer = rx_buf,
-        .length = 8 * sizeof(measurement_t),
+        .length = 8 * METEO_FRAME_SPI_SIZE,
     };
 
+    meteo_frame_parser_init(&parser);
+    uint32_t errors = 0;
+    uint32_t overflows = 0;
+
     while(1)
     {
         ESP_LOGI(TAG2, "Waiting for spi data");
@@ -33,17 +50,262 @@ void spi_get_meteo_data_task(void* pvParameters)
         esp_err_t ret = spi_slave_transmit(SPI_HOST_STM, &data, portMAX_DELAY);
         xSemaphoreGive(spi_mutex);
 
-        memcpy(&meteo_data, rx_buf, sizeof(measurement_t));
+        if(ret != ESP_OK)
+        {
+            ESP_LOGE(TAG2, "Get data from spi error with code: %d", ret);
+            continue;
+        }
+
+        // Parser keeps bytes between transactions, so frame shifted by a slip is still found
+        size_t len = data.trans_len / 8;
+        size_t used = 0;
+        while(used < len)
+        {
+            meteo_frame_status_t status;
+            used += meteo_frame_parse(&parser, rx_buf + used, len - used, &frame, &status);
+            if(status != METEO_FRAME_OK) continue;
+
+            ESP_LOGI(TAG2, "Frame seq: %u, records: %u", frame.seq, frame.count);
 
-        ESP_LOGI(TAG2, "temp: %.2f, press: %.2f, hum: %.2f", meteo_data.temperature, meteo_data.pressure, meteo_data.humidity);
+            for(uint8_t i = 0; i < frame.count; i++)
+            {
+                meteo_frame_get_record(&frame, i, &meteo_data);
 
-        xQueueSend(meteo_data_queue, &meteo_data, portMAX_DELAY);
+                ESP_LOGI(TAG2, "epoch: %lu, temp: %.2f, press: %.2f, hum: %.2f, flags: 0x%02x", (unsigned long)meteo_data.epoch,
+                         meteo_data.temperature / 100.0, meteo_data.pressure / 100.0, meteo_data.humidity / 100.0, meteo_data.flags);
 
-        if(ret != ESP_OK)
+                // Samples are queued and kept in flash as utc, offset of the stm32 clock is the one of
+                // boot time, current TZ rule would shift them by an hour after a DST change
+                // Stamp now if stm32 clock was not read, sample may be uploaded from flash much later
+                if(meteo_data.flags & METEO_FLAG_RTC_ERR) meteo_data.epoch = (uint32_t)time(NULL);
+                else meteo_data.epoch -= stm32_utc_offset;
+
+                // Don't block SPI, stm32 keeps sending while upload task is busy with flash or server
+                if(xQueueSend(meteo_data_queue, &meteo_data, 0) != pdTRUE)
+                {
+                    overflows++;
+                    ESP_LOGW(TAG2, "Meteo data queue is full, sample is dropped (%lu total)", (unsigned long)overflows);
+                }
+            }
+        }
+
+        // Report only when something went wrong since the last report
+        uint32_t total = parser.crc_errors + parser.header_errors + parser.skipped + parser.lost;
+        if(total != errors)
         {
-            ESP_LOGE(TAG2, "Get data from spi error with code: %d", ret);
+            errors = total;
+            ESP_LOGW(TAG2, "Frame errors: crc %lu, header %lu, skipped bytes %lu, lost frames %lu (good %lu)",
+                     (unsigned long)parser.crc_errors, (unsigned long)parser.header_errors,
+                     (unsigned long)parser.skipped, (unsigned long)parser.lost, (unsigned long)parser.frames);
+        }
+    }
+}
+
+static esp_err_t https_client_open(void)
+{
+    esp_http_client_config_t https_config = {
+        .url = CONFIG_SERVER_URL,
+        .keep_alive_enable = true,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .event_handler = https_event_handler,
+        .method = HTTP_METHOD_POST,
+    };
+
+    https_handle = esp_http_client_init(&https_config);
+    if(https_handle == NULL)
+    {
+        ESP_LOGE(TAG, "Client init error");
+        return ESP_FAIL;
+    }
+
+    https_stats.connects++;
+
+    // Header stays for all requests of this client
+    esp_err_t ret = esp_http_client_set_header(https_handle, "Content-Type", "application/json");
+    if(ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Set header error with code: %d", ret);
+    }
+
+    return ret;
+}
+
+static void https_client_close(void)
+{
+    if(https_handle == NULL) return;
+
+    esp_err_t ret = esp_http_client_cleanup(https_handle);
+    if(ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Client cleanup error with code: %d", ret);
+    }
+
+    https_handle = NULL;
+}
+
+// Post data with persistent client, client is created again only after transport error
+// Returns ESP_ERR_INVALID_RESPONSE if the server refused the data with 4xx
+static esp_err_t https_post(const char *data, int len)
+{
+    if(https_handle == NULL && https_client_open() != ESP_OK)
+    {
+        https_client_close();
+        https_stats.failures++;
+        return ESP_FAIL;
+    }
+
+    esp_err_t ret = esp_http_client_set_post_field(https_handle, data, len);
+    if(ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Set post field error with code: %d", ret);
+        https_stats.failures++;
+        return ret;
+    }
+
+    int64_t start = esp_timer_get_time();
+    ret = esp_http_client_perform(https_handle);
+    uint32_t latency_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+    if(ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Client perform error with code: %d, reconnect on next request", ret);
+        https_client_close();
+        https_stats.failures++;
+        return ret;
+    }
+
+    int status_code = esp_http_client_get_status_code(https_handle);
+    if(status_code < 200 || status_code >= 300)
+    {
+        ESP_LOGE(TAG, "HTTP Status Code: %d", status_code);
+        https_stats.failures++;
+
+        // Server refused the data itself, the same request would fail again
+        // 408 and 429 are only about timing, they are retried like 5xx
+        if(status_code >= 400 && status_code < 500 && status_code != 408 && status_code != 429)
+        {
+            https_stats.rejected++;
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        return ESP_FAIL;
+    }
+
+    https_stats.requests++;
+    https_stats.last_ms = latency_ms;
+    https_stats.total_ms += latency_ms;
+    if(latency_ms < https_stats.min_ms) https_stats.min_ms = latency_ms;
+    if(latency_ms > https_stats.max_ms) https_stats.max_ms = latency_ms;
+
+    ESP_LOGI(TAG, "HTTP Status Code: %d, latency: %lu ms", status_code, (unsigned long)latency_ms);
+    return ESP_OK;
+}
+
+void https_get_stats(https_stats_t *stats)
+{
+    *stats = https_stats;
+}
+
+// [{"ts": utc seconds, "temperature": .., "pressure": .., "humidity": ..}, ...]
+// Only whole samples which fit with the closing "]" are formatted, count gets their number
+// Returns length of the text or -1 if not even one sample fits
+static int format_batch(char *buf, size_t size, const measurement_t *batch, uint8_t *count)
+{
+    int len = snprintf(buf, size, "[");
+    uint8_t i;
+
+    for(i = 0; i < *count; i++)
+    {
+        int n = snprintf(buf + len, size - len, "%s{\"ts\": %lld, \"temperature\": %.2f, \"pressure\": %.2f, \"humidity\": %.2f}",
+                         i ? ", " : "", (long long)batch[i].epoch,
+                         batch[i].temperature / 100.0, batch[i].pressure / 100.0, batch[i].humidity / 100.0);
+
+        // Cut sample is overwritten by "]", it goes with the next batch
+        if(n < 0 || (size_t)(len + n) + sizeof("]") > size) break;
+        len += n;
+    }
+
+    if(i == 0) return -1;
+    *count = i;
+
+    len += snprintf(buf + len, size - len, "]");
+    return len;
+}
+
+static void log_stats(void)
+{
+    uint32_t total = https_stats.requests + https_stats.failures;
+    if(total % HTTPS_STATS_PERIOD != 0 || https_stats.requests == 0) return;
+
+    ESP_LOGI(TAG, "Requests: %lu ok, %lu failed, %lu rejected (%lu samples dropped), %lu connects, "
+             "latency ms: last %lu, min %lu, avg %lu, max %lu",
+             (unsigned long)https_stats.requests, (unsigned long)https_stats.failures,
+             (unsigned long)https_stats.rejected, (unsigned long)https_stats.dropped,
+             (unsigned long)https_stats.connects, (unsigned long)https_stats.last_ms,
+             (unsigned long)https_stats.min_ms, (unsigned long)(https_stats.total_ms / https_stats.requests),
+             (unsigned long)https_stats.max_ms);
+
+    flash_queue_stats_t queue_stats;
+    flash_queue_get_stats(&queue_stats);
+    ESP_LOGI(TAG, "Flash queue: %lu pending, %lu stored, %lu dropped, %lu errors",
+             (unsigned long)queue_stats.pending, (unsigned long)queue_stats.stored,
+             (unsigned long)queue_stats.dropped, (unsigned long)queue_stats.errors);
+}
+
+// Count gets the number of samples which were posted, the rest is left for the next batch
+static esp_err_t upload_batch(const measurement_t *batch, uint8_t *count)
+{
+    static char post_data[UPLOAD_FLASH_BATCH * UPLOAD_SAMPLE_JSON_SIZE + 2];
+    uint8_t requested = *count;
+
+    int len = format_batch(post_data, sizeof(post_data), batch, count);
+    if(len < 0)
+    {
+        // Sample can never be posted, it is dropped like a rejected one so it doesn't block the rest
+        ESP_LOGE(TAG, "Sample doesn't fit into %u bytes of request, it is dropped", (unsigned)sizeof(post_data));
+        *count = 1;
+        https_stats.dropped++;
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if(*count < requested)
+    {
+        ESP_LOGW(TAG, "Batch is cut to %u of %u samples", *count, requested);
+    }
+    ESP_LOGI(TAG, "Posting batch of %u samples", *count);
+
+    esp_err_t ret = https_post(post_data, len);
+    if(ret == ESP_ERR_INVALID_RESPONSE)
+    {
+        ESP_LOGW(TAG, "Batch of %u samples is rejected by server, it is dropped", *count);
+        https_stats.dropped += *count;
+    }
+    log_stats();
+
+    return ret;
+}
+
+static void store_sample(const measurement_t *sample)
+{
+    if(sample->flags & METEO_FLAG_SENSOR_ERR) return;
+
+    if(flash_queue_push(sample) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Sample can't be stored in flash, it is lost");
+    }
+}
+
+// Server is down, keep moving new samples to flash until the next attempt
+static void wait_retry(void)
+{
+    static measurement_t meteo_data;
+    TickType_t start = xTaskGetTickCount();
+    TickType_t elapsed;
+
+    while((elapsed = xTaskGetTickCount() - start) < pdMS_TO_TICKS(UPLOAD_RETRY_MS))
+    {
+        if(xQueueReceive(meteo_data_queue, &meteo_data, pdMS_TO_TICKS(UPLOAD_RETRY_MS) - elapsed) == pdTRUE)
+        {
+            store_sample(&meteo_data);
         }
-        else ESP_LOGI(TAG2, "Get data from spi sucssed with code: %d", ret);
     }
 }
 
@@ -54,63 +316,77 @@ void set_data_on_site_task(void* pvParameters)
     // Add code to fetch and log the current time
 
     static measurement_t meteo_data;
-    static char post_data[256];
+    static measurement_t batch[UPLOAD_FLASH_BATCH];
+    uint8_t count = 0;
+    TickType_t first_tick = 0;
 
     while(1)
     {
-        xQueueReceive(meteo_data_queue, &meteo_data, portMAX_DELAY);
-
-        memset(post_data, 0, sizeof(post_data));
-        snprintf(post_data, sizeof(post_data), "{\"temperature\": %.2f, \"pressure\": %.2f, \"humidity\": %.2f}", meteo_data.temperature, meteo_data.pressure, meteo_data.humidity);
-
-        esp_http_client_config_t https_config = {
-            .url = "https://esp32-web-production.up.railway.app/api/data",
-            .keep_alive_enable = true,
-            .crt_bundle_attach = esp_crt_bundle_attach,
-            .event_handler = https_event_handler,
-            .method = HTTP_METHOD_POST,
-        };
+        // Samples from offline period are sent first, new ones wait behind them in flash so order is kept
+        if(flash_queue_count() > 0)
+        {
+            while(xQueueReceive(meteo_data_queue, &meteo_data, 0) == pdTRUE) store_sample(&meteo_data);
 
-        esp_http_client_handle_t https_handle = esp_http_client_init(&https_config);
+            // Rejected batch leaves the queue too, otherwise it would block all samples behind it
+            int n = flash_queue_peek(batch, UPLOAD_FLASH_BATCH);
+            uint8_t sent = (n > 0) ? (uint8_t)n : 0;
+            esp_err_t ret = (n > 0) ? upload_batch(batch, &sent) : ESP_FAIL;
+            if(ret == ESP_OK || ret == ESP_ERR_INVALID_RESPONSE)
+            {
+                flash_queue_pop(sent);
+                continue;
+            }
 
-        // Set POST data header and POST field
-        esp_err_t ret = esp_http_client_set_header(https_handle, "Content-Type", "application/json");
-        if(ret != ESP_OK)
-        {
-            ESP_LOGE(TAG, "Set header error with code: %d", ret);
+            wait_retry();
+            continue;
         }
-        else ESP_LOGI(TAG, "Set header sucssed with code: %d", ret);
 
-        ret = esp_http_client_set_post_field(https_handle, post_data, strlen(post_data));
-        if(ret != ESP_OK)
+        // Wait for the next sample, but not longer than age limit of the batch
+        TickType_t wait = portMAX_DELAY;
+        if(count > 0)
         {
-            ESP_LOGE(TAG, "Set post field error with code: %d", ret);
+            TickType_t age = xTaskGetTickCount() - first_tick;
+            wait = (age < pdMS_TO_TICKS(UPLOAD_BATCH_MS)) ? pdMS_TO_TICKS(UPLOAD_BATCH_MS) - age : 0;
         }
-        else ESP_LOGI(TAG, "Set post field sucssed with code: %d", ret);
 
-        ret = esp_http_client_perform(https_handle);
-        if(ret != ESP_OK)
+        if(xQueueReceive(meteo_data_queue, &meteo_data, wait) == pdTRUE)
         {
-            ESP_LOGE(TAG, "Client perform error with code: %d", ret);
-        }
-        else ESP_LOGI(TAG, "Client perform sucssed with code: %d", ret);
+            if(meteo_data.flags & METEO_FLAG_SENSOR_ERR)
+            {
+                ESP_LOGW(TAG, "Sample without measuring is skipped");
+                continue;
+            }
 
-        int status_code = esp_http_client_get_status_code(https_handle);
-        ESP_LOGI(TAG, "HTTP Status Code: %d", status_code);
+            if(count == 0) first_tick = xTaskGetTickCount();
+            batch[count++] = meteo_data;
 
-        ret = esp_http_client_cleanup(https_handle);
+            if(count < UPLOAD_BATCH_MAX) continue;
+        }
 
-        if(ret != ESP_OK)
+        if(count == 0) continue;
+
+        // Only transport errors and 5xx are worth retrying from flash
+        uint8_t sent = count;
+        esp_err_t ret = upload_batch(batch, &sent);
+        if(ret != ESP_OK && ret != ESP_ERR_INVALID_RESPONSE)
         {
-            ESP_LOGE(TAG, "Client cleanup error with code: %d", ret);
+            ESP_LOGW(TAG, "Upload failed, %u samples are stored in flash", count);
+            for(uint8_t i = 0; i < count; i++) store_sample(&batch[i]);
+            count = 0;
+
+            wait_retry();
+            continue;
         }
-        else ESP_LOGI(TAG, "Client cleanup sucssed with code: %d", ret);
+
+        // Samples cut from the batch go first with the flash queue
+        for(uint8_t i = sent; i < count; i++) store_sample(&batch[i]);
+        count = 0;
     }
 }
 
 esp_err_t https_event_handler(esp_http_client_event_handle_t event)
 {
-    ESP_LOGI(TAG, "Client handler start");
+    ESP_LOGD(TAG, "Client handler start");
     esp_http_client_event_id_t event_id = (esp_http_client_event_id_t)event->event_id;
 
     switch(event_id)
@@ -0,0 +1,27 @@
+// Helpers of the in-process benchmarks
+
+// Sample of a 10 s series with daily and slower changes, values have one decimal like ingested ones
+const sampleAt = (i, start = Date.UTC(2025, 0, 1)) => ({
+  temperature: Math.round((15 + 8 * Math.sin(i / 8640 * 2 * Math.PI) + 3 * Math.sin(i / 613)) * 10) / 10,
+  pressure: Math.round((1013 + 9 * Math.cos(i / 25000)) * 10) / 10,
+  humidity: Math.round((55 + 25 * Math.sin(i / 4320 + 1)) * 10) / 10,
+  timestamp: start + i * 10000
+});
+
+// Runs fn until minMs passed, returns ns per call
+const measure = (fn, minMs = 300) => {
+  fn();
+  let calls = 0;
+  const started = process.hrtime.bigint();
+  let elapsed = 0;
+  while (elapsed < minMs * 1e6) {
+    fn();
+    calls++;
+    elapsed = Number(process.hrtime.bigint() - started);
+  }
+  return elapsed / calls;
+};
+
+const formatNs = (ns) => ns >= 1e6 ? `${(ns / 1e6).toFixed(2)} ms` : ns >= 1e3 ? `${(ns / 1e3).toFixed(1)} us` : `${ns.toFixed(0)} ns`;
+
+module.exports = { sampleAt, measure, formatNs };
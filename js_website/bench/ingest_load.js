@@ -0,0 +1,135 @@
+// Load generator: the same samples posted one per request to /api/data and
+// in batches to /api/data/bulk against a server process with empty storage.
+// Usage: node bench/ingest_load.js [samples=20000] [batch=30] [concurrency=4]
+const { spawn } = require("child_process");
+const fs = require("fs");
+const http = require("http");
+const net = require("net");
+const os = require("os");
+const path = require("path");
+
+const SAMPLES = parseInt(process.argv[2], 10) || 20000;
+const BATCH = parseInt(process.argv[3], 10) || 30;
+const CONCURRENCY = parseInt(process.argv[4], 10) || 4;
+
+const freePort = () => new Promise((resolve) => {
+  const srv = net.createServer().listen(0, () => {
+    const { port } = srv.address();
+    srv.close(() => resolve(port));
+  });
+});
+
+// utime + stime of a process in ms, null where /proc is missing
+const cpuMs = (pid) => {
+  try {
+    const fields = fs.readFileSync(`/proc/${pid}/stat`, "utf8").split(") ")[1].split(" ");
+    return (parseInt(fields[11], 10) + parseInt(fields[12], 10)) * 1000 / 100;
+  } catch (err) {
+    return null;
+  }
+};
+
+const startServer = async () => {
+  const port = await freePort();
+  const dataDir = fs.mkdtempSync(path.join(os.tmpdir(), "meteo-load-"));
+  const child = spawn(process.execPath, [path.join(__dirname, "..", "server.js")], {
+    env: { ...process.env, PORT: String(port), DATA_DIR: dataDir, MAX_HISTORY: String(SAMPLES) },
+    stdio: ["ignore", "pipe", "inherit"]
+  });
+
+  await new Promise((resolve, reject) => {
+    child.once("exit", (code) => reject(new Error(`server exited with ${code}`)));
+    child.stdout.on("data", (chunk) => {
+      if (chunk.toString().includes("Server running")) resolve();
+    });
+  });
+
+  return {
+    port,
+    pid: child.pid,
+    stop: () => new Promise((resolve) => {
+      child.removeAllListeners("exit");
+      child.once("exit", () => {
+        fs.rmSync(dataDir, { recursive: true, force: true });
+        resolve();
+      });
+      child.kill("SIGTERM");
+    })
+  };
+};
+
+const post = (agent, port, url, body) => new Promise((resolve, reject) => {
+  const data = JSON.stringify(body);
+  const req = http.request({
+    agent, port, path: url, method: "POST",
+    headers: { "Content-Type": "application/json", "Content-Length": Buffer.byteLength(data) }
+  }, (res) => {
+    const chunks = [];
+    res.on("data", (chunk) => chunks.push(chunk));
+    res.on("end", () => {
+      if (res.statusCode !== 200) return reject(new Error(`${url}: status ${res.statusCode}`));
+      resolve(Buffer.concat(chunks).toString());
+    });
+  });
+  req.on("error", reject);
+  req.end(data);
+});
+
+const sample = (i) => ({
+  temperature: 20 + Math.sin(i / 500) * 5,
+  pressure: 1013 + Math.cos(i / 700) * 8,
+  humidity: 50 + Math.sin(i / 300) * 20
+});
+
+// Requests are taken from a shared counter by CONCURRENCY keep-alive clients
+const run = async (name, requests, send) => {
+  const server = await startServer();
+  const agent = new http.Agent({ keepAlive: true, maxSockets: CONCURRENCY });
+  const cpuStart = cpuMs(server.pid);
+  const started = process.hrtime.bigint();
+
+  let next = 0;
+  let accepted = 0;
+  const worker = async () => {
+    while (next < requests) {
+      const count = await send(agent, server.port, next++);
+      accepted += count;
+    }
+  };
+  await Promise.all(Array.from({ length: CONCURRENCY }, worker));
+
+  const ms = Number(process.hrtime.bigint() - started) / 1e6;
+  const cpu = cpuMs(server.pid);
+  agent.destroy();
+  await server.stop();
+
+  console.log(
+    `${name.padEnd(7)} ${String(requests).padStart(6)} requests ${String(accepted).padStart(7)} samples ` +
+    `${ms.toFixed(0).padStart(6)} ms ${(accepted * 1000 / ms).toFixed(0).padStart(7)} samples/s` +
+    (cpu === null ? "" : ` server cpu ${((cpu - cpuStart) / accepted * 1000).toFixed(1)} ms/1000 samples`)
+  );
+};
+
+const main = async () => {
+  console.log(`${SAMPLES} samples, batch ${BATCH}, ${CONCURRENCY} clients`);
+
+  await run("single", SAMPLES, async (agent, port, i) => {
+    await post(agent, port, "/api/data", sample(i));
+    return 1;
+  });
+
+  // Batches of concurrent clients may arrive out of order, older ones are dropped by the server
+  const base = Math.floor(Date.now() / 1000) - SAMPLES * 10;
+  await run("bulk", Math.ceil(SAMPLES / BATCH), async (agent, port, b) => {
+    const batch = [];
+    for (let i = b * BATCH; i < Math.min((b + 1) * BATCH, SAMPLES); i++) {
+      batch.push({ ts: base + i * 10, ...sample(i) });
+    }
+    return JSON.parse(await post(agent, port, "/api/data/bulk", batch)).accepted;
+  });
+};
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
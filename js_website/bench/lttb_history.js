@@ -0,0 +1,34 @@
+// /api/history response size and server CPU against stored points: the
+// whole history as before, and ?points=N series decimated with LTTB,
+// computed without the response cache like after every new sample.
+// Usage: node bench/lttb_history.js [points=1000]
+const { HistoryStore } = require("../server");
+const { sampleAt, measure, formatNs } = require("./common");
+
+const POINTS = parseInt(process.argv[2], 10) || 1000;
+const LENGTHS = [10000, 100000, 1000000];
+const METRICS = ["temperature", "humidity", "pressure"];
+
+// Body of /api/history?points=N
+const downsampled = (history, points) => {
+  const series = {};
+  for (const metric of METRICS) {
+    series[metric] = history.downsample(metric, 0, history.length, points);
+  }
+  return JSON.stringify({ count: history.length, next: history.firstSeq + history.length, ...series });
+};
+
+const full = (history) => JSON.stringify(history.toArray());
+
+const formatBytes = (bytes) => bytes >= 1e6 ? `${(bytes / 1e6).toFixed(1)} MB` : `${(bytes / 1e3).toFixed(1)} KB`;
+
+for (const length of LENGTHS) {
+  const history = new HistoryStore(length);
+  for (let i = 0; i < length; i++) history.push(sampleAt(i));
+
+  for (const [name, body] of [["full", () => full(history)], [`points=${POINTS}`, () => downsampled(history, POINTS)]]) {
+    const bytes = Buffer.byteLength(body());
+    const ns = measure(body);
+    console.log(`${String(length).padStart(8)} stored  ${name.padEnd(12)} ${formatBytes(bytes).padStart(9)}  ${formatNs(ns).padStart(10)} cpu`);
+  }
+}
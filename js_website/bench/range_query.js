@@ -0,0 +1,52 @@
+// /api/history?from=&to=&limit= latency on a million stored points: binary
+// search over the ring against filtering the materialised history, for
+// windows of different size at random positions. The ring is wrapped.
+// Usage: node bench/range_query.js [stored=1000000]
+const { HistoryStore } = require("../server");
+const { sampleAt, measure, formatNs } = require("./common");
+
+const STORED = parseInt(process.argv[2], 10) || 1000000;
+const WINDOWS = [10, 1000, 100000];
+const LIMIT = 1000; // PAGE_LIMIT
+
+const history = new HistoryStore(STORED);
+for (let i = 0; i < STORED + STORED / 4; i++) history.push(sampleAt(i));
+
+const first = history.timestampAt(0);
+const step = history.timestampAt(1) - first;
+
+// First page of the window, like the endpoint
+const indexed = (from, to) => {
+  const { start, end } = history.range(from, to);
+  const stop = Math.min(start + LIMIT, end);
+  return JSON.stringify({ items: history.toArray(start, stop), nextCursor: stop < end ? String(history.firstSeq + stop) : null });
+};
+
+const scan = (from, to) => {
+  const items = history.toArray().filter(h => h.timestamp >= from && h.timestamp <= to);
+  return JSON.stringify({ items: items.slice(0, LIMIT) });
+};
+
+let seed = 1;
+const random = () => {
+  seed = (seed * 1103515245 + 12345) % 2147483648;
+  return seed / 2147483648;
+};
+
+console.log(`${history.length} stored points, first page of ${LIMIT}`);
+for (const size of WINDOWS) {
+  const window = () => {
+    const from = first + Math.floor(random() * (history.length - size)) * step;
+    return [from, from + (size - 1) * step];
+  };
+
+  // check both give the same page
+  const [from, to] = window();
+  if (JSON.parse(indexed(from, to)).items.length !== JSON.parse(scan(from, to)).items.length) {
+    throw new Error(`window of ${size}: pages differ`);
+  }
+
+  const fast = measure(() => indexed(...window()));
+  const slow = measure(() => scan(...window()), 1000);
+  console.log(`window ${String(size).padStart(7)}  binary search ${formatNs(fast).padStart(10)}  full scan ${formatNs(slow).padStart(10)}`);
+}
@@ -0,0 +1,49 @@
+// Ingest cost of a full store, every append evicts the oldest sample:
+// HistoryStore ring against the array with push() and shift() it replaced.
+// Usage: node bench/ring_ingest.js [appends=50000]
+const { HistoryStore } = require("../server");
+const { sampleAt, formatNs } = require("./common");
+
+const APPENDS = parseInt(process.argv[2], 10) || 50000;
+const CAPACITIES = [10000, 100000, 1000000];
+
+// Previous store: objects with ISO time, shift() moves the whole array
+const arrayStore = (capacity) => {
+  const history = [];
+  return (sample) => {
+    history.push({ ...sample, time: new Date(sample.timestamp).toISOString() });
+    if (history.length > capacity) history.shift();
+  };
+};
+
+const ringStore = (capacity) => {
+  const history = new HistoryStore(capacity);
+  return (sample) => history.push(sample);
+};
+
+const run = (name, makeStore, capacity) => {
+  const append = makeStore(capacity);
+  for (let i = 0; i < capacity; i++) append(sampleAt(i));
+
+  const samples = Array.from({ length: APPENDS }, (_, i) => sampleAt(capacity + i));
+  const started = process.hrtime.bigint();
+  for (const sample of samples) append(sample);
+  const ns = Number(process.hrtime.bigint() - started) / APPENDS;
+
+  console.log(`${name.padEnd(6)} ${String(capacity).padStart(8)}  ${formatNs(ns).padStart(10)} per append  ` +
+    `${(1e9 / ns).toFixed(0).padStart(9)} appends/s`);
+};
+
+// Compiled code for both stores before the first measurement
+const warmRing = ringStore(1000);
+const warmArray = arrayStore(1000);
+for (let i = 0; i < 100000; i++) {
+  warmRing(sampleAt(i));
+  warmArray(sampleAt(i));
+}
+
+console.log(`${APPENDS} appends into a full store`);
+for (const capacity of CAPACITIES) {
+  run("ring", ringStore, capacity);
+  run("array", arrayStore, capacity);
+}
@@ -0,0 +1,71 @@
+// /api/stats latency against history length: O(1) summaries of HistoryStore
+// against the previous full scan, which copied the history into arrays and
+// spread them into Math.min / Math.max. The store is full, so min and max
+// deques have gone through evictions; summaries are checked against the scan.
+// Usage: node bench/stats_latency.js
+const { HistoryStore } = require("../server");
+const { sampleAt, measure, formatNs } = require("./common");
+
+const LENGTHS = [1000, 10000, 100000, 1000000];
+const METRICS = ["temperature", "humidity", "pressure"];
+
+const fill = (length) => {
+  const history = new HistoryStore(length);
+  // twice the capacity, half of the samples were evicted
+  for (let i = 0; i < 2 * length; i++) history.push(sampleAt(i));
+  return history;
+};
+
+const incremental = (history) => {
+  const stats = { count: history.length };
+  for (const metric of METRICS) stats[metric] = history.summary(metric);
+  return JSON.stringify(stats);
+};
+
+// Previous getStats
+const scan = (history) => {
+  const entries = history.toArray();
+  const stats = { count: entries.length };
+  for (const metric of METRICS) {
+    const values = entries.map(h => h[metric]);
+    stats[metric] = {
+      current: values[values.length - 1],
+      average: parseFloat((values.reduce((a, b) => a + b, 0) / values.length).toFixed(1)),
+      min: Math.min(...values),
+      max: Math.max(...values)
+    };
+  }
+  return JSON.stringify(stats);
+};
+
+const check = (history) => {
+  for (const metric of METRICS) {
+    const summary = history.summary(metric);
+    let min = Infinity;
+    let max = -Infinity;
+    let sum = 0;
+    for (const entry of history) {
+      min = Math.min(min, entry[metric]);
+      max = Math.max(max, entry[metric]);
+      sum += entry[metric];
+    }
+    if (summary.min !== min || summary.max !== max || summary.average !== parseFloat((sum / history.length).toFixed(1))) {
+      throw new Error(`${metric} of ${history.length} samples: ${JSON.stringify(summary)}, scan ${min} ${max} ${sum / history.length}`);
+    }
+  }
+};
+
+for (const length of LENGTHS) {
+  const history = fill(length);
+  check(history);
+
+  const fast = measure(() => incremental(history));
+  let slow;
+  try {
+    slow = formatNs(measure(() => scan(history)));
+  } catch (err) {
+    slow = err.constructor.name;
+  }
+
+  console.log(`${String(length).padStart(8)} samples  incremental ${formatNs(fast).padStart(10)}  full scan ${slow.padStart(10)}`);
+}
@@ -1,117 +1,943 @@
 const express = require("express");
+const fs = require("fs");
+const path = require("path");
 const app = express();
 
 app.use(express.json());
 
-const MAX_HISTORY = 10000;
+const MAX_HISTORY = parseInt(process.env.MAX_HISTORY, 10) || 10000;
+const MAX_BULK = 500;
+const MAX_AHEAD_MS = 5 * 60 * 1000; // device samples newer than server time + this are dropped
+const MAX_POINTS = 5000;   // limit of downsampled series, more than any screen is wide
+const DOWNSAMPLE_CACHE = 4; // downsampled responses kept until the store changes
+const PAGE_LIMIT = 1000;   // default and max page size of range queries
+const MAX_PAGE_LIMIT = 10000;
+const EXPORT_PAGE = 5000;  // rows written per event loop turn
 
-let history = [];
+// Samples are persisted in DATA_DIR, memory keeps the last MAX_HISTORY of them
+const DATA_DIR = process.env.DATA_DIR || path.join(__dirname, "data");
+const RETENTION_DAYS = parseFloat(process.env.RETENTION_DAYS) || 365;
+const COMMIT_MS = 1000;          // group commit period, samples of one period share one fsync
+const SEGMENT_RECORDS = 100000;  // ~11 days of 10 s samples per segment file
+const RECORD_SIZE = 24;
 
-// ================= API =================
+// ================= STORE =================
 
-app.post("/api/data", (req, res) => {
-  const { temperature, pressure, humidity } = req.body;
+// Ring of slots of one column, ordered so that the front slot holds the
+// min (or max) value of the window. Slots of the window are unique, so
+// the front is evicted when its slot leaves the window.
+class MonotonicDeque {
+  constructor(capacity, values, isMax) {
+    this.capacity = capacity;
+    this.values = values;
+    this.isMax = isMax;
+    this.slots = new Uint32Array(capacity);
+    this.head = 0;
+    this.length = 0;
+  }
 
-  if (
-    typeof temperature !== "number" ||
-    typeof pressure !== "number" ||
-    typeof humidity !== "number"
-  ) {
-    return res.status(400).json({ error: "Invalid JSON payload" });
+  at(index) {
+    const i = this.head + index;
+    return this.slots[i < this.capacity ? i : i - this.capacity];
+  }
+
+  push(slot) {
+    const value = this.values[slot];
+    while (this.length > 0) {
+      const back = this.values[this.at(this.length - 1)];
+      if (this.isMax ? back > value : back < value) break;
+      this.length--;
+    }
+
+    const i = this.head + this.length;
+    this.slots[i < this.capacity ? i : i - this.capacity] = slot;
+    this.length++;
+  }
+
+  evict(slot) {
+    if (this.length > 0 && this.at(0) === slot) {
+      this.head = this.head + 1 < this.capacity ? this.head + 1 : 0;
+      this.length--;
+    }
+  }
+
+  front() {
+    return this.values[this.at(0)];
+  }
+
+  clear() {
+    this.head = 0;
+    this.length = 0;
+  }
+}
+
+// Aggregates of one column over the stored window, updated on append and
+// eviction. Values have one decimal, so the sum is kept exact in tenths.
+class ColumnStats {
+  constructor(capacity, values) {
+    this.values = values;
+    this.sumTenths = 0;
+    this.min = new MonotonicDeque(capacity, values, false);
+    this.max = new MonotonicDeque(capacity, values, true);
+  }
+
+  add(slot) {
+    this.sumTenths += Math.round(this.values[slot] * 10);
+    this.min.push(slot);
+    this.max.push(slot);
+  }
+
+  remove(slot) {
+    this.sumTenths -= Math.round(this.values[slot] * 10);
+    this.min.evict(slot);
+    this.max.evict(slot);
+  }
+
+  clear() {
+    this.sumTenths = 0;
+    this.min.clear();
+    this.max.clear();
+  }
+}
+
+// Fixed-capacity ring of samples kept in preallocated columns, so append
+// and eviction of the oldest sample don't depend on capacity.
+// Index 0 is the oldest stored sample. Every sample also has a sequence
+// number which doesn't change while it is stored, it is used by cursors.
+class HistoryStore {
+  constructor(capacity) {
+    this.capacity = capacity;
+    this.timestamps = new Float64Array(capacity);
+    this.temperatures = new Float64Array(capacity);
+    this.pressures = new Float64Array(capacity);
+    this.humidities = new Float64Array(capacity);
+    this.head = 0; // slot of the oldest sample
+    this.length = 0;
+    this.firstSeq = 0; // sequence number of the oldest sample
+    this.version = 0;  // changes with every append and clear
+
+    this.stats = {
+      temperature: new ColumnStats(capacity, this.temperatures),
+      pressure: new ColumnStats(capacity, this.pressures),
+      humidity: new ColumnStats(capacity, this.humidities)
+    };
+  }
+
+  slot(index) {
+    const slot = this.head + index;
+    return slot < this.capacity ? slot : slot - this.capacity;
+  }
+
+  push({ temperature, pressure, humidity, timestamp }) {
+    let slot;
+    if (this.length < this.capacity) {
+      slot = this.slot(this.length);
+      this.length++;
+    } else {
+      slot = this.head;
+      this.head = this.slot(1);
+      this.firstSeq++;
+      for (const key in this.stats) this.stats[key].remove(slot);
+    }
+
+    this.timestamps[slot] = timestamp;
+    this.temperatures[slot] = temperature;
+    this.pressures[slot] = pressure;
+    this.humidities[slot] = humidity;
+    for (const key in this.stats) this.stats[key].add(slot);
+    this.version++;
+  }
+
+  get(index) {
+    const slot = this.slot(index);
+    return {
+      temperature: this.temperatures[slot],
+      pressure: this.pressures[slot],
+      humidity: this.humidities[slot],
+      timestamp: this.timestamps[slot],
+      seq: this.firstSeq + index
+    };
+  }
+
+  timestampAt(index) {
+    return this.timestamps[this.slot(index)];
+  }
+
+  // Index of the first sample with timestamp >= time (after = false)
+  // or > time (after = true), samples are ordered by time
+  search(time, after) {
+    let low = 0;
+    let high = this.length;
+    while (low < high) {
+      const mid = (low + high) >>> 1;
+      const t = this.timestampAt(mid);
+      if (t < time || (after && t === time)) low = mid + 1;
+      else high = mid;
+    }
+    return low;
+  }
+
+  // Index range [start, end) of samples with from <= timestamp <= to among
+  // the stored ones, evicted samples are only in the segment files
+  range(from, to) {
+    return {
+      start: from === undefined ? 0 : this.search(from, false),
+      end: to === undefined ? this.length : this.search(to, true)
+    };
+  }
+
+  // Index of a sequence number, evicted ones map to the oldest sample
+  indexOfSeq(seq) {
+    return Math.min(Math.max(seq - this.firstSeq, 0), this.length);
+  }
+
+  last() {
+    return this.length > 0 ? this.get(this.length - 1) : null;
+  }
+
+  toArray(start = 0, end = this.length) {
+    const out = new Array(Math.max(end - start, 0));
+    for (let i = start; i < end; i++) out[i - start] = this.get(i);
+    return out;
+  }
+
+  // Summary of one column in O(1), trend compares the last 5 samples
+  summary(key) {
+    const stats = this.stats[key];
+    const values = stats.values;
+    const current = values[this.slot(this.length - 1)];
+
+    let trend = 'stable';
+    if (this.length >= 5) {
+      const diff = current - values[this.slot(this.length - 5)];
+      if (diff > 1) trend = 'up';
+      if (diff < -1) trend = 'down';
+    }
+
+    return {
+      current,
+      average: parseFloat((stats.sumTenths / 10 / this.length).toFixed(1)),
+      min: stats.min.front(),
+      max: stats.max.front(),
+      trend
+    };
+  }
+
+  // Largest-Triangle-Three-Buckets over samples [start, end) of one column.
+  // First and last samples are kept, from every bucket between them the one
+  // making the largest triangle with the previous pick and the average of
+  // the next bucket, so peaks survive the decimation.
+  downsample(key, start, end, threshold) {
+    const values = this.stats[key].values;
+    const count = end - start;
+    const timestamps = [];
+    const picked = [];
+    const pick = (index) => {
+      const slot = this.slot(index);
+      timestamps.push(this.timestamps[slot]);
+      picked.push(values[slot]);
+    };
+
+    if (threshold >= count || threshold < 3) {
+      for (let i = start; i < end; i++) pick(i);
+      return { timestamps, values: picked };
+    }
+
+    const bucket = (count - 2) / (threshold - 2);
+    let a = start;
+    pick(a);
+
+    for (let b = 0; b < threshold - 2; b++) {
+      const rangeStart = start + Math.floor(b * bucket) + 1;
+      const rangeEnd = start + Math.floor((b + 1) * bucket) + 1;
+      const nextEnd = Math.min(start + Math.floor((b + 2) * bucket) + 1, end);
+
+      let avgX = 0;
+      let avgY = 0;
+      for (let i = rangeEnd; i < nextEnd; i++) {
+        const slot = this.slot(i);
+        avgX += this.timestamps[slot];
+        avgY += values[slot];
+      }
+      avgX /= nextEnd - rangeEnd;
+      avgY /= nextEnd - rangeEnd;
+
+      const slotA = this.slot(a);
+      const ax = this.timestamps[slotA];
+      const ay = values[slotA];
+      let maxArea = -1;
+
+      for (let i = rangeStart; i < rangeEnd; i++) {
+        const slot = this.slot(i);
+        const area = Math.abs((ax - avgX) * (values[slot] - ay) - (ax - this.timestamps[slot]) * (avgY - ay));
+        if (area > maxArea) {
+          maxArea = area;
+          a = i;
+        }
+      }
+
+      pick(a);
+    }
+
+    pick(end - 1);
+    return { timestamps, values: picked };
+  }
+
+  // One sequence number is skipped, so a cursor taken before clear is older
+  // than the oldest sample and the client knows it has to reload
+  clear() {
+    this.firstSeq += this.length + 1;
+    this.head = 0;
+    this.length = 0;
+    for (const key in this.stats) this.stats[key].clear();
+    this.version++;
+  }
+
+  *[Symbol.iterator]() {
+    for (let i = 0; i < this.length; i++) yield this.get(i);
+  }
+}
+
+// Append-only segment files of fixed-width records:
+//   0 timestamp (ms, f64)  8 temperature  12 pressure  16 humidity (tenths, i32)
+//   20 FNV-1a of bytes 0..19, torn tail of the last segment is cut on startup
+// A segment is named after the sequence number of its first record and is
+// deleted when its newest record is older than RETENTION_DAYS.
+const recordCheck = (buf, offset) => {
+  let hash = 0x811c9dc5;
+  for (let i = offset; i < offset + 20; i++) {
+    hash = Math.imul(hash ^ buf[i], 0x01000193);
   }
+  return hash >>> 0;
+};
+
+const encodeRecord = ({ temperature, pressure, humidity, timestamp }) => {
+  const buf = Buffer.allocUnsafe(RECORD_SIZE);
+  buf.writeDoubleLE(timestamp, 0);
+  buf.writeInt32LE(Math.round(temperature * 10), 8);
+  buf.writeInt32LE(Math.round(pressure * 10), 12);
+  buf.writeInt32LE(Math.round(humidity * 10), 16);
+  buf.writeUInt32LE(recordCheck(buf, 0), 20);
+  return buf;
+};
 
-  const entry = {
-    temperature: parseFloat(temperature.toFixed(1)),
-    pressure: parseFloat(pressure.toFixed(1)),
-    humidity: parseFloat(humidity.toFixed(1)),
-    time: new Date().toISOString(),
-    timestamp: Date.now()
+const decodeRecord = (buf, offset) => {
+  if (buf.readUInt32LE(offset + 20) !== recordCheck(buf, offset)) return null;
+  return {
+    temperature: buf.readInt32LE(offset + 8) / 10,
+    pressure: buf.readInt32LE(offset + 12) / 10,
+    humidity: buf.readInt32LE(offset + 16) / 10,
+    timestamp: buf.readDoubleLE(offset)
   };
+};
+
+class SegmentStorage {
+  constructor(dir) {
+    this.dir = dir;
+    this.pending = [];
+    this.timer = null;
+    this.chain = Promise.resolve(); // file operations run one after another
+    this.file = null;
+    this.segmentSeq = 0;            // sequence number of the first record of active segment
+    this.segmentRecords = 0;        // records written to active segment, next one goes after them
+    this.generation = 0;            // changes with clear, failed records of older one aren't retried
+    this.discarded = 0;             // failed records dropped by clear
+  }
+
+  segmentPath(seq) {
+    return path.join(this.dir, `segment-${String(seq).padStart(16, "0")}.bin`);
+  }
+
+  listSegments() {
+    return fs.readdirSync(this.dir)
+      .filter(name => /^segment-\d{16}\.bin$/.test(name))
+      .sort()
+      .map(name => ({ name, seq: parseInt(name.slice(8, 24), 10) }));
+  }
+
+  // Reads the newest `limit` records into onRecord, oldest first. Only the
+  // tail of the data is read, so startup doesn't depend on retained history.
+  open(limit, onRecord) {
+    fs.mkdirSync(this.dir, { recursive: true });
+
+    const segments = this.listSegments();
+    if (segments.length === 0) {
+      segments.push({ name: path.basename(this.segmentPath(0)), seq: 0 });
+      fs.writeFileSync(this.segmentPath(0), Buffer.alloc(0));
+    }
+
+    // Active segment is the last one, keep only its valid prefix
+    const active = segments[segments.length - 1];
+    const activePath = path.join(this.dir, active.name);
+    const data = fs.readFileSync(activePath);
+    let valid = 0;
+    while (valid + RECORD_SIZE <= data.length && decodeRecord(data, valid) !== null) {
+      valid += RECORD_SIZE;
+    }
+    if (valid !== data.length) {
+      console.warn(`Storage: cut ${data.length - valid} bytes of torn tail in ${active.name}`);
+      fs.truncateSync(activePath, valid);
+    }
+
+    this.segmentSeq = active.seq;
+    this.segmentRecords = valid / RECORD_SIZE;
+    this.file = fs.openSync(activePath, "r+");
+
+    // Tail ranges of the newest segments, collected backwards
+    const ranges = [];
+    let need = limit;
+    for (let i = segments.length - 1; i >= 0 && need > 0; i--) {
+      const file = path.join(this.dir, segments[i].name);
+      const count = i === segments.length - 1 ? this.segmentRecords : Math.floor(fs.statSync(file).size / RECORD_SIZE);
+      const take = Math.min(count, need);
+      ranges.unshift({ file, start: count - take, count: take });
+      need -= take;
+    }
+
+    let loaded = 0;
+    for (const { file, start, count } of ranges) {
+      const buf = Buffer.allocUnsafe(count * RECORD_SIZE);
+      const fd = fs.openSync(file, "r");
+      fs.readSync(fd, buf, 0, buf.length, start * RECORD_SIZE);
+      fs.closeSync(fd);
+
+      for (let offset = 0; offset < buf.length; offset += RECORD_SIZE) {
+        const entry = decodeRecord(buf, offset);
+        if (entry === null) continue;
+        onRecord(entry);
+        loaded++;
+      }
+    }
+
+    this.run(() => this.removeExpired());
+    return loaded;
+  }
+
+  // Sequence number of the next appended record
+  nextSeq() {
+    return this.segmentSeq + this.segmentRecords + this.pending.length;
+  }
+
+  // Sequence number of the oldest retained record
+  firstSeq() {
+    const segments = this.listSegments();
+    return segments.length > 0 ? segments[0].seq : this.segmentSeq;
+  }
+
+  run(operation) {
+    this.chain = this.chain.then(operation).catch(err => console.error("Storage error:", err));
+    return this.chain;
+  }
+
+  // Reads wait in the chain too, so no segment is rotated or removed under
+  // them, but their errors go to the caller
+  query(operation) {
+    const result = this.chain.then(operation);
+    this.chain = result.catch(() => {});
+    return result;
+  }
+
+  // Segments with their written records, the torn tail of the active one
+  // and pending records are not readable
+  readable() {
+    return this.listSegments().map(({ name, seq }) => {
+      const file = path.join(this.dir, name);
+      const count = seq === this.segmentSeq ? this.segmentRecords : Math.floor(fs.statSync(file).size / RECORD_SIZE);
+      return { file, seq, count };
+    });
+  }
+
+  // Sequence number of the first written record with timestamp >= time
+  // (after = false) or > time (after = true), records are ordered by time.
+  // The segment is found by its last record, then searched by halves.
+  async seek(time, after) {
+    const buf = Buffer.allocUnsafe(8);
+    for (const { file, seq, count } of this.readable()) {
+      if (count === 0) continue;
+
+      const fd = await fs.promises.open(file, "r");
+      try {
+        const before = async (index) => {
+          await fd.read(buf, 0, 8, index * RECORD_SIZE);
+          const t = buf.readDoubleLE(0);
+          return t < time || (after && t === time);
+        };
+        if (await before(count - 1)) continue;
+
+        let low = 0;
+        let high = count - 1;
+        while (low < high) {
+          const mid = (low + high) >>> 1;
+          if (await before(mid)) low = mid + 1;
+          else high = mid;
+        }
+        return seq + low;
+      } finally {
+        await fd.close();
+      }
+    }
+    return this.segmentSeq + this.segmentRecords;
+  }
+
+  // Up to limit written records with sequence numbers in [start, end),
+  // records of removed segments are skipped. Resolves with the records and
+  // the sequence number to continue from.
+  async read(start, end, limit) {
+    const items = [];
+    let next = start;
+    for (const segment of this.readable()) {
+      const from = Math.max(next, segment.seq);
+      const to = Math.min(end, segment.seq + segment.count, from + limit - items.length);
+      if (to <= from) continue;
+
+      const buf = Buffer.allocUnsafe((to - from) * RECORD_SIZE);
+      const fd = await fs.promises.open(segment.file, "r");
+      try {
+        await fd.read(buf, 0, buf.length, (from - segment.seq) * RECORD_SIZE);
+      } finally {
+        await fd.close();
+      }
+
+      for (let offset = 0; offset < buf.length; offset += RECORD_SIZE) {
+        const entry = decodeRecord(buf, offset);
+        if (entry !== null) items.push({ ...entry, seq: from + offset / RECORD_SIZE });
+      }
+      next = to;
+      if (items.length >= limit) return { items, next };
+    }
+    return { items, next: Math.max(next, end) };
+  }
+
+  // Doesn't touch the disk, records are written by the next group commit
+  append(entry) {
+    this.pending.push(encodeRecord(entry));
+    this.schedule();
+  }
+
+  schedule() {
+    if (this.timer === null) {
+      this.timer = setTimeout(() => {
+        this.timer = null;
+        this.flush();
+      }, COMMIT_MS);
+    }
+  }
+
+  flush() {
+    return this.run(() => this.writePending());
+  }
+
+  // Records are written at the end of the valid data, so a short or failed
+  // write leaves at most a torn record, which the retry writes over. Only
+  // whole written records are counted, the rest goes back to pending.
+  async writePending() {
+    const records = this.pending;
+    const generation = this.generation;
+    this.pending = [];
+
+    let i = 0;
+    try {
+      while (i < records.length) {
+        if (this.segmentRecords >= SEGMENT_RECORDS) await this.rotate();
+
+        const buf = Buffer.concat(records.slice(i, i + SEGMENT_RECORDS - this.segmentRecords));
+        const position = this.segmentRecords * RECORD_SIZE;
+        let written = 0;
+        try {
+          while (written < buf.length) {
+            written += await writeFile(this.file, buf, written, position + written);
+          }
+        } finally {
+          const whole = Math.floor(written / RECORD_SIZE);
+          this.segmentRecords += whole;
+          i += whole;
+        }
+      }
+
+      if (records.length > 0) await fsyncFile(this.file);
+    } catch (err) {
+      if (generation === this.generation) {
+        this.pending = records.slice(i).concat(this.pending);
+        this.schedule();
+      } else {
+        this.discarded += records.length - i;
+      }
+      throw err;
+    }
+  }
+
+  async rotate() {
+    await fsyncFile(this.file);
+    fs.closeSync(this.file);
+
+    this.segmentSeq += this.segmentRecords;
+    this.segmentRecords = 0;
+    this.file = fs.openSync(this.segmentPath(this.segmentSeq), "w");
+
+    await this.removeExpired();
+  }
+
+  // Segment is expired when the next one starts before the cutoff
+  async removeExpired() {
+    const cutoff = Date.now() - RETENTION_DAYS * 24 * 3600 * 1000;
+    const segments = this.listSegments();
+    const first = Buffer.allocUnsafe(RECORD_SIZE);
+
+    for (let i = 0; i < segments.length - 1; i++) {
+      const next = await fs.promises.open(path.join(this.dir, segments[i + 1].name), "r");
+      const { bytesRead } = await next.read(first, 0, RECORD_SIZE, 0);
+      await next.close();
+
+      if (bytesRead < RECORD_SIZE || first.readDoubleLE(0) >= cutoff) break;
+
+      await fs.promises.unlink(path.join(this.dir, segments[i].name));
+      console.log(`Storage: removed expired ${segments[i].name}`);
+    }
+  }
+
+  clear() {
+    const dropped = this.pending.length;
+    this.pending = [];
+    this.generation++;
+    return this.run(async () => {
+      fs.closeSync(this.file);
+      for (const { name } of this.listSegments()) {
+        await fs.promises.unlink(path.join(this.dir, name));
+      }
+
+      // Sequence numbers keep growing, so segment names stay ordered
+      this.segmentSeq += this.segmentRecords + dropped + this.discarded + 1;
+      this.segmentRecords = 0;
+      this.discarded = 0;
+      this.file = fs.openSync(this.segmentPath(this.segmentSeq), "w");
+    });
+  }
+}
+
+// Resolves with the number of bytes written, it may be less than asked for
+const writeFile = (fd, buf, offset, position) => new Promise((resolve, reject) =>
+  fs.write(fd, buf, offset, buf.length - offset, position, (err, bytesWritten) => err ? reject(err) : resolve(bytesWritten)));
+
+const fsyncFile = (fd) => new Promise((resolve, reject) =>
+  fs.fsync(fd, (err) => err ? reject(err) : resolve()));
+
+const history = new HistoryStore(MAX_HISTORY);
+const storage = new SegmentStorage(DATA_DIR);
+
+// ================= API =================
 
+const isValidSample = (s) =>
+  s !== null &&
+  typeof s === "object" &&
+  typeof s.temperature === "number" &&
+  typeof s.pressure === "number" &&
+  typeof s.humidity === "number";
+
+const makeEntry = ({ temperature, pressure, humidity }, timestamp) => ({
+  temperature: parseFloat(temperature.toFixed(1)),
+  pressure: parseFloat(pressure.toFixed(1)),
+  humidity: parseFloat(humidity.toFixed(1)),
+  timestamp
+});
+
+const lastTimestamp = () => history.length > 0 ? history.timestampAt(history.length - 1) : -Infinity;
+
+// History must stay ordered by time for range queries, so every ingest
+// path stores only samples newer than the last stored one
+const addEntry = (entry) => {
+  if (entry.timestamp <= lastTimestamp()) return false;
   history.push(entry);
+  storage.append(entry);
+  return true;
+};
 
-  if (history.length > MAX_HISTORY) {
-    history.shift();
+// Time of arrival, a sample in the same ms as the last one or behind a
+// device sample up to MAX_AHEAD_MS ahead is moved just after it
+app.post("/api/data", (req, res) => {
+  if (!isValidSample(req.body)) {
+    return res.status(400).json({ error: "Invalid JSON payload" });
   }
 
+  const entry = makeEntry(req.body, Math.max(Date.now(), lastTimestamp() + 1));
+
+  addEntry(entry);
+
   console.log("Received:", entry);
   res.sendStatus(200);
 });
 
-app.get("/api/history", (req, res) => {
-  res.json(history);
+// Batch from device: [{ ts, temperature, pressure, humidity }, ...]
+// ts is UTC time of the sample in seconds. The whole batch is validated
+// before anything is stored, history stays ordered by time, so entries
+// not newer than the last stored one are dropped, like the ones more than
+// MAX_AHEAD_MS ahead of server time, which would hold back later samples.
+app.post("/api/data/bulk", (req, res) => {
+  const batch = req.body;
+
+  if (!Array.isArray(batch) || batch.length === 0 || batch.length > MAX_BULK) {
+    return res.status(400).json({ error: `Expected array of 1..${MAX_BULK} samples` });
+  }
+
+  const entries = [];
+  for (let i = 0; i < batch.length; i++) {
+    const sample = batch[i];
+    if (!isValidSample(sample) || typeof sample.ts !== "number" || !Number.isFinite(sample.ts) || sample.ts <= 0) {
+      return res.status(400).json({ error: `Invalid sample at index ${i}` });
+    }
+    entries.push(makeEntry(sample, Math.round(sample.ts * 1000)));
+  }
+
+  entries.sort((a, b) => a.timestamp - b.timestamp);
+
+  const ahead = Date.now() + MAX_AHEAD_MS;
+  let accepted = 0;
+
+  for (const entry of entries) {
+    if (entry.timestamp <= ahead && addEntry(entry)) accepted++;
+  }
+
+  console.log(`Received batch: ${accepted} accepted, ${entries.length - accepted} dropped`);
+  res.json({ accepted, dropped: entries.length - accepted });
 });
 
-app.get("/api/stats", (req, res) => {
+// Optional time window of a query, from and to are epoch ms, both inclusive
+const parseTimes = (query) => {
+  const from = query.from === undefined ? undefined : Number(query.from);
+  const to = query.to === undefined ? undefined : Number(query.to);
+  if (Number.isNaN(from) || Number.isNaN(to)) return null;
+  return { from, to };
+};
+
+// Sequence number of the first sample with timestamp >= time (after = false)
+// or > time (after = true). Times before the oldest sample in memory are
+// searched in the segment files.
+const seekSeq = async (time, after) => {
+  if (history.length > 0 && time >= history.timestampAt(0)) {
+    return history.firstSeq + history.search(time, after);
+  }
+  const seq = await storage.query(() => storage.seek(time, after));
+  return Math.min(seq, history.firstSeq);
+};
+
+// Window as sequence range [start, end) of all retained samples, open start
+// is the oldest retained one. Oldest is read after pending clear and
+// retention of the storage.
+const seqWindow = async ({ from, to }) => {
+  const oldest = Math.min(await storage.query(() => storage.firstSeq()), history.firstSeq);
+  return {
+    oldest,
+    start: from === undefined ? oldest : await seekSeq(from, false),
+    end: to === undefined ? history.firstSeq + history.length : await seekSeq(to, true)
+  };
+};
+
+// Up to limit samples of [start, end) and the sequence number to continue
+// from. Evicted samples are read from the segment files, the page goes on
+// in memory if nothing was evicted while they were read.
+const readPage = async (start, end, limit) => {
+  let items = [];
+  let next = start;
+  if (start < history.firstSeq) {
+    ({ items, next } = await storage.query(() => storage.read(start, Math.min(end, history.firstSeq), limit)));
+  }
+
+  if (next >= history.firstSeq && items.length < limit) {
+    const first = history.indexOfSeq(next);
+    const last = Math.min(first + limit - items.length, history.indexOfSeq(end));
+    items = items.concat(history.toArray(first, last));
+    next = Math.max(next, history.firstSeq + last);
+  }
+  return { items, next };
+};
+
+// Downsampled responses are reused until the store changes. Windows come
+// from clients, so only the last DOWNSAMPLE_CACHE used ones are kept,
+// Map order is the order of use.
+const downsampleCache = { version: -1, responses: new Map() };
+
+const downsampled = (points, start, end) => {
+  if (downsampleCache.version !== history.version) {
+    downsampleCache.version = history.version;
+    downsampleCache.responses.clear();
+  }
+
+  const { responses } = downsampleCache;
+  const key = `${points}:${start}:${end}`;
+  let body = responses.get(key);
+  if (body === undefined) {
+    const series = {};
+    for (const metric of ["temperature", "humidity", "pressure"]) {
+      series[metric] = history.downsample(metric, start, end, points);
+    }
+    body = JSON.stringify({ count: end - start, next: history.firstSeq + end, ...series });
+    if (responses.size >= DOWNSAMPLE_CACHE) responses.delete(responses.keys().next().value);
+  } else {
+    responses.delete(key);
+  }
+  responses.set(key, body);
+
+  return body;
+};
+
+// ?points=N - every metric decimated to N points: { count, next, temperature: { timestamps, values }, ... },
+//             next is the sequence number to ask /api/updates for
+// ?tail=N   - newest N samples
+// from and to limit the window of points and tail, both cover the samples in memory.
+// ?from=&to=&limit=&cursor= - one page of the window: { items, nextCursor },
+//             cursor is the sequence number to continue from, null on the last page.
+//             Pages reach back to RETENTION_DAYS, evicted samples are read from the
+//             segment files. Cursor of a removed sample gets 410 and the oldest cursor.
+app.get("/api/history", async (req, res) => {
+  const { query } = req;
+  const times = parseTimes(query);
+  if (times === null) {
+    return res.status(400).json({ error: "from and to must be epoch ms" });
+  }
+
+  const points = parseInt(query.points, 10);
+  if (points > 0) {
+    const window = history.range(times.from, times.to);
+    return res.type("json").send(downsampled(Math.min(points, MAX_POINTS), window.start, window.end));
+  }
+
+  const tail = parseInt(query.tail, 10);
+  if (tail > 0) {
+    const window = history.range(times.from, times.to);
+    return res.json(history.toArray(Math.max(window.end - tail, window.start), window.end));
+  }
+
+  if (query.from === undefined && query.to === undefined && query.limit === undefined && query.cursor === undefined) {
+    return res.json(history.toArray());
+  }
+
+  const limit = Math.min(Math.max(parseInt(query.limit, 10) || PAGE_LIMIT, 1), MAX_PAGE_LIMIT);
+  let cursor;
+  if (query.cursor !== undefined) {
+    cursor = parseInt(query.cursor, 10);
+    if (!(cursor >= 0)) {
+      return res.status(400).json({ error: "Invalid cursor" });
+    }
+  }
+
+  try {
+    const window = await seqWindow(times);
+
+    // Sample of the cursor was removed by retention or clear, the page would skip data
+    if (cursor < window.oldest) {
+      return res.status(410).json({ error: "Cursor is older than retained history", oldest: String(window.oldest) });
+    }
+
+    const start = cursor === undefined ? window.start : Math.max(window.start, cursor);
+    const { items, next } = await readPage(start, window.end, limit);
+    res.json({ items, nextCursor: next < window.end ? String(next) : null });
+  } catch (err) {
+    console.error("History read error:", err);
+    res.status(500).json({ error: "History read failed" });
+  }
+});
+
+const getStats = () => {
   if (history.length === 0) {
-    return res.json({
+    return {
       temperature: { current: 0, average: 0, min: 0, max: 0, trend: 'stable' },
       humidity: { current: 0, average: 0, min: 0, max: 0, trend: 'stable' },
       pressure: { current: 0, average: 0, min: 0, max: 0, trend: 'stable' },
       count: 0,
       lastUpdate: new Date().toISOString()
-    });
+    };
   }
 
-  const temps = history.map(h => h.temperature);
-  const hums = history.map(h => h.humidity);
-  const press = history.map(h => h.pressure);
-
-  // Calculate trends based on last 10 points
-  const getTrend = (data) => {
-    if (data.length < 5) return 'stable';
-    const recent = data.slice(-5);
-    const first = recent[0];
-    const last = recent[recent.length - 1];
-    const diff = last - first;
-    
-    if (diff > 1) return 'up';
-    if (diff < -1) return 'down';
-    return 'stable';
+  return {
+    temperature: history.summary("temperature"),
+    humidity: history.summary("humidity"),
+    pressure: history.summary("pressure"),
+    count: history.length,
+    lastUpdate: new Date(history.last().timestamp).toISOString()
   };
+};
+
+app.get("/api/stats", (req, res) => {
+  res.json(getStats());
+});
+
+// ?since=<seq> - samples from the sequence number on and current stats:
+// { reset, next, items, stats }. reset asks the client to reload instead,
+// when history was cleared, samples were evicted or there are too many.
+app.get("/api/updates", (req, res) => {
+  const since = parseInt(req.query.since, 10);
+  if (!(since >= 0)) {
+    return res.status(400).json({ error: "since must be a sequence number" });
+  }
+
+  const next = history.firstSeq + history.length;
+  const reset = since < history.firstSeq || since > next || next - since > MAX_PAGE_LIMIT;
 
   res.json({
-    temperature: {
-      current: temps[temps.length - 1],
-      average: parseFloat((temps.reduce((a, b) => a + b, 0) / temps.length).toFixed(1)),
-      min: Math.min(...temps),
-      max: Math.max(...temps),
-      trend: getTrend(temps)
-    },
-    humidity: {
-      current: hums[hums.length - 1],
-      average: parseFloat((hums.reduce((a, b) => a + b, 0) / hums.length).toFixed(1)),
-      min: Math.min(...hums),
-      max: Math.max(...hums),
-      trend: getTrend(hums)
-    },
-    pressure: {
-      current: press[press.length - 1],
-      average: parseFloat((press.reduce((a, b) => a + b, 0) / press.length).toFixed(1)),
-      min: Math.min(...press),
-      max: Math.max(...press),
-      trend: getTrend(press)
-    },
-    count: history.length,
-    lastUpdate: history[history.length - 1].time
+    reset,
+    next,
+    items: reset ? [] : history.toArray(history.indexOfSeq(since)),
+    stats: getStats()
   });
 });
 
-app.get("/api/export", (req, res) => {
-  const csv = [
-    "Time,Temperature (°C),Humidity (%),Pressure (hPa)",
-    ...history.map(h => 
-      `${new Date(h.time).toLocaleString()},${h.temperature},${h.humidity},${h.pressure}`
-    )
-  ].join("\n");
+// Resolves when a full response buffer is drained or the client is gone
+const writable = (res) => new Promise((resolve) => {
+  const done = () => {
+    res.off("drain", done);
+    res.off("close", done);
+    resolve();
+  };
+  res.on("drain", done);
+  res.on("close", done);
+});
+
+// Streamed page by page, position is kept as sequence number, so samples
+// appended or evicted between pages don't shift the export. Samples older
+// than the ones in memory come from the segment files. Next page is made
+// only when the client took the previous one, export of a closed
+// connection stops.
+app.get("/api/export", async (req, res) => {
+  const times = parseTimes(req.query);
+  if (times === null) {
+    return res.status(400).json({ error: "from and to must be epoch ms" });
+  }
+
+  // close of the response comes after end too, then the loop is over
+  let closed = false;
+  res.on("close", () => { closed = true; });
 
   res.header('Content-Type', 'text/csv');
   res.attachment('sensor_data.csv');
-  res.send(csv);
+  res.write("Time,Temperature (°C),Humidity (%),Pressure (hPa)");
+
+  try {
+    const window = await seqWindow(times);
+    let seq = window.start;
+
+    while (seq < window.end && !closed) {
+      const { items, next } = await readPage(seq, window.end, EXPORT_PAGE);
+      if (next <= seq) break;
+
+      const flushed = res.write(items.map(h =>
+        `\n${new Date(h.timestamp).toLocaleString()},${h.temperature},${h.humidity},${h.pressure}`
+      ).join(""));
+
+      seq = next;
+      if (flushed) await new Promise(resolve => setImmediate(resolve));
+      else await writable(res);
+    }
+  } catch (err) {
+    // Headers are sent, the cut response is all the client can get
+    console.error("Export read error:", err);
+    return res.destroy();
+  }
+
+  if (!closed) res.end();
 });
 
 app.post("/api/clear", (req, res) => {
-  history = [];
+  history.clear();
+  storage.clear();
   res.json({ status: "success", message: "Data cleared" });
 });
 
@@ -973,6 +1799,11 @@ app.get("/", (req, res) => {
         let autoUpdateEnabled = true;
         let startTime = Date.now();
         let tableExpanded = false;
+        const TABLE_ROWS = 50;
+        let tableRows = [];
+        let syncSeq = null;     // sequence number of the next sample, null until charts are loaded
+        let chartPoints = 0;    // points of downsampled chart
+        let appendedPoints = 0; // points appended since charts were loaded, charts are reloaded after a tenth
         let chartsVisible = true;
         
         // Initialize charts
@@ -1338,70 +2169,12 @@ app.get("/", (req, res) => {
         // Update data from server
         async function updateData() {
             try {
-                const [historyRes, statsRes] = await Promise.all([
-                    fetch('/api/history'),
-                    fetch('/api/stats')
-                ]);
-                
-                if (!historyRes.ok || !statsRes.ok) {
-                    throw new Error('Failed to fetch data');
+                if (syncSeq === null || appendedPoints > chartPoints / 10) {
+                    await loadAll();
+                } else {
+                    await loadUpdates();
                 }
                 
-                const historyData = await historyRes.json();
-                const statsData = await statsRes.json();
-                
-                // Update statistics
-                document.getElementById('tempCurrent').textContent = \`\${statsData.temperature.current.toFixed(1)}°C\`;
-                document.getElementById('tempAvg').textContent = \`\${statsData.temperature.average.toFixed(1)}°C\`;
-                document.getElementById('tempMin').textContent = \`\${statsData.temperature.min.toFixed(1)}°C\`;
-                document.getElementById('tempMax').textContent = \`\${statsData.temperature.max.toFixed(1)}°C\`;
-                
-                document.getElementById('humCurrent').textContent = \`\${statsData.humidity.current.toFixed(1)}%\`;
-                document.getElementById('humAvg').textContent = \`\${statsData.humidity.average.toFixed(1)}%\`;
-                document.getElementById('humMin').textContent = \`\${statsData.humidity.min.toFixed(1)}%\`;
-                document.getElementById('humMax').textContent = \`\${statsData.humidity.max.toFixed(1)}%\`;
-                
-                document.getElementById('pressCurrent').textContent = \`\${statsData.pressure.current.toFixed(1)} hPa\`;
-                document.getElementById('pressAvg').textContent = \`\${statsData.pressure.average.toFixed(1)} hPa\`;
-                document.getElementById('pressMin').textContent = \`\${statsData.pressure.min.toFixed(1)} hPa\`;
-                document.getElementById('pressMax').textContent = \`\${statsData.pressure.max.toFixed(1)} hPa\`;
-                
-                // Update trends
-                const updateTrend = (elementId, trend) => {
-                    const element = document.getElementById(elementId);
-                    element.className = \`trend \${trend}\`;
-                    element.innerHTML = \`<i class="fas fa-arrow-\${trend === 'up' ? 'up' : trend === 'down' ? 'down' : 'right'}"></i> \${trend.charAt(0).toUpperCase() + trend.slice(1)}\`;
-                };
-                
-                updateTrend('tempTrend', statsData.temperature.trend);
-                updateTrend('humTrend', statsData.humidity.trend);
-                updateTrend('pressTrend', statsData.pressure.trend);
-                
-                // Update charts
-                const times = historyData.map(entry => {
-                    const date = new Date(entry.time);
-                    return date.toLocaleTimeString([], { hour: '2-digit', minute: '2-digit' });
-                });
-                
-                temperatureChart.data.labels = times;
-                temperatureChart.data.datasets[0].data = historyData.map(d => d.temperature);
-                
-                humidityChart.data.labels = times;
-                humidityChart.data.datasets[0].data = historyData.map(d => d.humidity);
-                
-                pressureChart.data.labels = times;
-                pressureChart.data.datasets[0].data = historyData.map(d => d.pressure);
-                
-                temperatureChart.update('none');
-                humidityChart.update('none');
-                pressureChart.update('none');
-                
-                // Update table
-                updateTable(historyData);
-                
-                // Update header stats
-                document.getElementById('lastUpdate').textContent = new Date(statsData.lastUpdate).toLocaleTimeString();
-                document.getElementById('dataPoints').textContent = \`\${statsData.count} records\`;
                 document.getElementById('status').innerHTML = '<span style="color: #10b981">Live Streaming</span>';
                 document.getElementById('connectionStatus').textContent = 'Connected';
                 
@@ -1412,10 +2185,128 @@ app.get("/", (req, res) => {
             }
         }
         
+        function formatChartTime(timestamp) {
+            const date = new Date(timestamp);
+            return date.toLocaleTimeString([], { hour: '2-digit', minute: '2-digit' });
+        }
+        
+        // Downsampled charts, table and stats from scratch
+        async function loadAll() {
+            // One point per pixel of chart width is all the chart can show
+            const points = Math.max(50, Math.round(document.getElementById('temperatureChart').clientWidth));
+            const [seriesRes, tableRes, statsRes] = await Promise.all([
+                fetch(\`/api/history?points=\${points}\`),
+                fetch(\`/api/history?tail=\${TABLE_ROWS}\`),
+                fetch('/api/stats')
+            ]);
+            
+            if (!seriesRes.ok || !tableRes.ok || !statsRes.ok) {
+                throw new Error('Failed to fetch data');
+            }
+            
+            const seriesData = await seriesRes.json();
+            const tableData = await tableRes.json();
+            const statsData = await statsRes.json();
+            
+            // Update charts, every metric is decimated on its own points
+            const setSeries = (chart, series) => {
+                chart.data.labels = series.timestamps.map(formatChartTime);
+                chart.data.datasets[0].data = series.values;
+                chart.update('none');
+            };
+            
+            setSeries(temperatureChart, seriesData.temperature);
+            setSeries(humidityChart, seriesData.humidity);
+            setSeries(pressureChart, seriesData.pressure);
+            
+            syncSeq = seriesData.next;
+            chartPoints = points;
+            appendedPoints = 0;
+            
+            tableRows = tableData;
+            updateTable(tableRows);
+            updateStats(statsData);
+        }
+        
+        // Only samples since the last poll, appended to charts and table
+        async function loadUpdates() {
+            const response = await fetch(\`/api/updates?since=\${syncSeq}\`);
+            if (!response.ok) {
+                throw new Error('Failed to fetch data');
+            }
+            
+            const update = await response.json();
+            if (update.reset) {
+                syncSeq = null;
+                return loadAll();
+            }
+            
+            syncSeq = update.next;
+            
+            if (update.items.length > 0) {
+                // Charts keep their length, oldest points are trimmed
+                const appendSeries = (chart, key) => {
+                    for (const item of update.items) {
+                        chart.data.labels.push(formatChartTime(item.timestamp));
+                        chart.data.datasets[0].data.push(item[key]);
+                    }
+                    
+                    const extra = chart.data.labels.length - chartPoints;
+                    if (extra > 0) {
+                        chart.data.labels.splice(0, extra);
+                        chart.data.datasets[0].data.splice(0, extra);
+                    }
+                    chart.update('none');
+                };
+                
+                appendSeries(temperatureChart, 'temperature');
+                appendSeries(humidityChart, 'humidity');
+                appendSeries(pressureChart, 'pressure');
+                appendedPoints += update.items.length;
+                
+                tableRows = tableRows.concat(update.items).slice(-TABLE_ROWS);
+                updateTable(tableRows);
+            }
+            
+            updateStats(update.stats);
+        }
+        
+        function updateStats(statsData) {
+            document.getElementById('tempCurrent').textContent = \`\${statsData.temperature.current.toFixed(1)}°C\`;
+            document.getElementById('tempAvg').textContent = \`\${statsData.temperature.average.toFixed(1)}°C\`;
+            document.getElementById('tempMin').textContent = \`\${statsData.temperature.min.toFixed(1)}°C\`;
+            document.getElementById('tempMax').textContent = \`\${statsData.temperature.max.toFixed(1)}°C\`;
+            
+            document.getElementById('humCurrent').textContent = \`\${statsData.humidity.current.toFixed(1)}%\`;
+            document.getElementById('humAvg').textContent = \`\${statsData.humidity.average.toFixed(1)}%\`;
+            document.getElementById('humMin').textContent = \`\${statsData.humidity.min.toFixed(1)}%\`;
+            document.getElementById('humMax').textContent = \`\${statsData.humidity.max.toFixed(1)}%\`;
+            
+            document.getElementById('pressCurrent').textContent = \`\${statsData.pressure.current.toFixed(1)} hPa\`;
+            document.getElementById('pressAvg').textContent = \`\${statsData.pressure.average.toFixed(1)} hPa\`;
+            document.getElementById('pressMin').textContent = \`\${statsData.pressure.min.toFixed(1)} hPa\`;
+            document.getElementById('pressMax').textContent = \`\${statsData.pressure.max.toFixed(1)} hPa\`;
+            
+            // Update trends
+            const updateTrend = (elementId, trend) => {
+                const element = document.getElementById(elementId);
+                element.className = \`trend \${trend}\`;
+                element.innerHTML = \`<i class="fas fa-arrow-\${trend === 'up' ? 'up' : trend === 'down' ? 'down' : 'right'}"></i> \${trend.charAt(0).toUpperCase() + trend.slice(1)}\`;
+            };
+            
+            updateTrend('tempTrend', statsData.temperature.trend);
+            updateTrend('humTrend', statsData.humidity.trend);
+            updateTrend('pressTrend', statsData.pressure.trend);
+            
+            // Update header stats
+            document.getElementById('lastUpdate').textContent = new Date(statsData.lastUpdate).toLocaleTimeString();
+            document.getElementById('dataPoints').textContent = \`\${statsData.count} records\`;
+        }
+        
         // Update data table
         function updateTable(data) {
             const tableBody = document.getElementById('tableBody');
-            const displayData = tableExpanded ? data.slice(-50).reverse() : data.slice(-10).reverse();
+            const displayData = tableExpanded ? data.slice(-TABLE_ROWS).reverse() : data.slice(-10).reverse();
             
             tableBody.innerHTML = '';
             
@@ -1432,7 +2323,7 @@ app.get("/", (req, res) => {
             }
             
             displayData.forEach((entry, index) => {
-                const date = new Date(entry.time);
+                const date = new Date(entry.timestamp);
                 const timeStr = date.toLocaleTimeString([], { 
                     hour12: false,
                     hour: '2-digit', 
@@ -1499,9 +2390,12 @@ app.get("/", (req, res) => {
                 '<i class="fas fa-eye-slash"></i> Show Less' : 
                 '<i class="fas fa-eye"></i> Show All';
             
-            fetch('/api/history')
+            fetch(\`/api/history?tail=\${TABLE_ROWS}\`)
                 .then(res => res.json())
-                .then(data => updateTable(data))
+                .then(data => {
+                    tableRows = data;
+                    updateTable(tableRows);
+                })
                 .catch(console.error);
         }
         
@@ -1544,15 +2438,17 @@ app.get("/", (req, res) => {
         
         // Utility functions
         function refreshAllData() {
+            syncSeq = null;
             updateData();
             showNotification('Data refreshed successfully', 'success');
         }
         
         function refreshTable() {
-            fetch('/api/history')
+            fetch(\`/api/history?tail=\${TABLE_ROWS}\`)
                 .then(res => res.json())
                 .then(data => {
-                    updateTable(data);
+                    tableRows = data;
+                    updateTable(tableRows);
                     showNotification('Table refreshed', 'success');
                 })
                 .catch(console.error);
@@ -1673,9 +2569,29 @@ app.get("/", (req, res) => {
 
 // ================= START =================
 
-const PORT = process.env.PORT || 3000;
-app.listen(PORT, () => {
-  console.log(`🚀 Server running on port ${PORT}`);
-  console.log(`📊 Dashboard available at http://localhost:${PORT}`);
-  console.log(`📤 POST data to http://localhost:${PORT}/api/data`);
-});
\ No newline at end of file
+const start = () => {
+  const restored = storage.open(MAX_HISTORY, (entry) => history.push(entry));
+  // Ring and segments get the same appends, so cursors stay valid after restart
+  history.firstSeq = storage.nextSeq() - history.length;
+  console.log(`💾 Restored ${restored} samples from ${DATA_DIR}`);
+
+  // Commit pending samples before redeploy or stop
+  for (const signal of ["SIGTERM", "SIGINT"]) {
+    process.on(signal, () => {
+      storage.flush().then(() => process.exit(0));
+    });
+  }
+
+  const PORT = process.env.PORT || 3000;
+  app.listen(PORT, () => {
+    console.log(`🚀 Server running on port ${PORT}`);
+    console.log(`📊 Dashboard available at http://localhost:${PORT}`);
+    console.log(`📤 POST data to http://localhost:${PORT}/api/data`);
+    console.log(`📦 POST batches to http://localhost:${PORT}/api/data/bulk`);
+  });
+};
+
+// Benchmarks and tests load the store without starting the server
+if (require.main === module) start();
+
+module.exports = { HistoryStore, SegmentStorage, RECORD_SIZE };
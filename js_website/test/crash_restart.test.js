@@ -0,0 +1,105 @@
+// Server process is killed while it commits samples, a torn record is
+// appended like from a cut write, then the server restarts on the same data
+const { test } = require("node:test");
+const assert = require("node:assert/strict");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const { RECORD_SIZE } = require("../server");
+const { startServer, request } = require("./server_process");
+
+// Recent samples, older ones would be removed by retention
+const BASE = Math.floor(Date.now() / 1000) * 1000 - 30 * 24 * 3600 * 1000;
+
+const sample = (i) => ({
+  ts: (BASE + i * 10000) / 1000,
+  temperature: Math.round((10 + 10 * Math.sin(i / 100)) * 10) / 10,
+  pressure: 1000 + (i % 50),
+  humidity: Math.round((50 + 30 * Math.cos(i / 70)) * 10) / 10
+});
+
+const readAll = async (port) => {
+  const items = [];
+  let cursor = "0";
+  while (cursor !== null) {
+    const { body } = await request(port, "GET", `/api/history?limit=10000&cursor=${cursor}`);
+    items.push(...body.items);
+    cursor = body.nextCursor;
+  }
+  return items;
+};
+
+test("restart after SIGKILL in a commit keeps committed samples, cuts the torn tail and keeps sequence numbers", async () => {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), "meteo-crash-"));
+  const segment = path.join(dir, `segment-${"0".padStart(16, "0")}.bin`);
+
+  try {
+    // Small batches are posted all the time, the server is killed as soon as
+    // the second group commit grows the segment
+    let server = await startServer(dir, { MAX_HISTORY: "1000000" });
+    let sent = 0;
+    let posting = true;
+    const poster = (async () => {
+      while (posting && sent < 50000) {
+        const batch = Array.from({ length: 20 }, (_, k) => sample(sent + k));
+        const { status } = await request(server.port, "POST", "/api/data/bulk", batch).catch(() => ({ status: 0 }));
+        if (status === 200) sent += batch.length;
+        await new Promise((resolve) => setTimeout(resolve, 2));
+      }
+    })();
+
+    let commits = 0;
+    let size = 0;
+    const deadline = Date.now() + 10000;
+    while (commits < 2 && Date.now() < deadline) {
+      await new Promise((resolve) => setImmediate(resolve));
+      const now = fs.statSync(segment).size;
+      if (now !== size) commits++;
+      size = now;
+    }
+    await server.kill("SIGKILL");
+    posting = false;
+    await poster;
+
+    // Whole records of the killed process and a torn one after them
+    const committed = Math.floor(fs.statSync(segment).size / RECORD_SIZE);
+    assert.ok(committed > 0 && committed <= sent, `${committed} of ${sent} samples committed`);
+    fs.appendFileSync(segment, Buffer.alloc(RECORD_SIZE / 2, 0xA5));
+
+    server = await startServer(dir, { MAX_HISTORY: "1000000" });
+    assert.equal(fs.statSync(segment).size, committed * RECORD_SIZE, "torn tail is cut");
+
+    const items = await readAll(server.port);
+    assert.equal(items.length, committed);
+    items.forEach((item, i) => {
+      const { ts, ...values } = sample(i);
+      assert.deepEqual(item, { ...values, timestamp: ts * 1000, seq: i });
+    });
+
+    const { body: stats } = await request(server.port, "GET", "/api/stats");
+    const temperatures = items.map(item => item.temperature);
+    assert.equal(stats.count, committed);
+    assert.equal(stats.temperature.min, Math.min(...temperatures));
+    assert.equal(stats.temperature.max, Math.max(...temperatures));
+    assert.equal(stats.temperature.current, temperatures[committed - 1]);
+    assert.equal(stats.temperature.average, parseFloat((temperatures.reduce((a, b) => a + b, 0) / committed).toFixed(1)));
+
+    // Next sample continues the sequence and is committed on SIGTERM
+    const next = sample(sent + 1000);
+    const { body: bulk } = await request(server.port, "POST", "/api/data/bulk", [next]);
+    assert.equal(bulk.accepted, 1);
+    const { body: updates } = await request(server.port, "GET", `/api/updates?since=${committed}`);
+    assert.equal(updates.reset, false);
+    assert.deepEqual(updates.items.map(item => [item.seq, item.timestamp]), [[committed, next.ts * 1000]]);
+
+    await server.kill("SIGTERM");
+    assert.equal(fs.statSync(segment).size, (committed + 1) * RECORD_SIZE);
+
+    server = await startServer(dir, { MAX_HISTORY: "1000000" });
+    const { body: restarted } = await request(server.port, "GET", "/api/stats");
+    assert.equal(restarted.count, committed + 1);
+    await server.kill("SIGKILL");
+  } finally {
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+});
@@ -0,0 +1,182 @@
+// Boundaries of time-range queries and ordering of ingested samples
+const { test } = require("node:test");
+const assert = require("node:assert/strict");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const { HistoryStore } = require("../server");
+const { startServer, request } = require("./server_process");
+
+const entry = (timestamp) => ({ temperature: 20, pressure: 1000, humidity: 50, timestamp });
+
+// Capacity 5 after 8 appends: ring is wrapped, timestamps 40 .. 80, seqs 3 .. 7
+const wrappedStore = () => {
+  const history = new HistoryStore(5);
+  for (let t = 10; t <= 80; t += 10) history.push(entry(t));
+  return history;
+};
+
+const timestamps = (history, { start, end }) => history.toArray(start, end).map(h => h.timestamp);
+
+test("range of an empty store is empty", () => {
+  const history = new HistoryStore(5);
+  assert.deepEqual(history.range(0, 100), { start: 0, end: 0 });
+  assert.deepEqual(history.range(undefined, undefined), { start: 0, end: 0 });
+});
+
+test("from and to are inclusive at stored timestamps", () => {
+  const history = wrappedStore();
+  assert.deepEqual(timestamps(history, history.range(40, 80)), [40, 50, 60, 70, 80]);
+  assert.deepEqual(timestamps(history, history.range(50, 50)), [50]);
+  assert.deepEqual(timestamps(history, history.range(80, 80)), [80]);
+  assert.deepEqual(timestamps(history, history.range(40, 40)), [40]);
+});
+
+test("from and to between stored timestamps", () => {
+  const history = wrappedStore();
+  assert.deepEqual(timestamps(history, history.range(41, 79)), [50, 60, 70]);
+  assert.deepEqual(timestamps(history, history.range(45, 49)), []);
+  assert.deepEqual(timestamps(history, history.range(0, 45)), [40]);
+  assert.deepEqual(timestamps(history, history.range(75, 1000)), [80]);
+});
+
+test("window outside the stored samples, evicted ones included, is empty", () => {
+  const history = wrappedStore();
+  assert.deepEqual(history.range(10, 39), { start: 0, end: 0 });
+  assert.deepEqual(history.range(81, undefined), { start: 5, end: 5 });
+  assert.deepEqual(history.range(undefined, 39), { start: 0, end: 0 });
+  assert.equal(timestamps(history, history.range(70, 60)).length, 0, "to before from");
+});
+
+test("open ends of the window", () => {
+  const history = wrappedStore();
+  assert.deepEqual(history.range(undefined, undefined), { start: 0, end: 5 });
+  assert.deepEqual(timestamps(history, history.range(60, undefined)), [60, 70, 80]);
+  assert.deepEqual(timestamps(history, history.range(undefined, 60)), [40, 50, 60]);
+});
+
+test("sequence numbers of a wrapped ring", () => {
+  const history = wrappedStore();
+  assert.equal(history.firstSeq, 3);
+  assert.deepEqual(history.toArray().map(h => h.seq), [3, 4, 5, 6, 7]);
+  assert.equal(history.indexOfSeq(0), 0, "evicted seq maps to the oldest sample");
+  assert.equal(history.indexOfSeq(6), 3);
+  assert.equal(history.indexOfSeq(100), 5, "future seq maps to the end");
+});
+
+test("HTTP: ingest keeps history ordered, pages and export follow the window", async () => {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), "meteo-range-"));
+  const server = await startServer(dir);
+  const post = (url, body) => request(server.port, "POST", url, body);
+  const get = (url) => request(server.port, "GET", url);
+
+  try {
+    const now = Math.floor(Date.now() / 1000);
+    const sample = (ts) => ({ ts, temperature: 20, pressure: 1000, humidity: 50 });
+
+    // batch is sorted, entries not newer than the last stored one are dropped
+    let { body } = await post("/api/data/bulk", [sample(now - 30), sample(now - 50), sample(now - 40), sample(now - 40)]);
+    assert.deepEqual(body, { accepted: 3, dropped: 1 });
+    ({ body } = await post("/api/data/bulk", [sample(now - 45), sample(now - 30)]));
+    assert.deepEqual(body, { accepted: 0, dropped: 2 });
+
+    // sample an hour ahead would hold back everything after it
+    ({ body } = await post("/api/data/bulk", [sample(now + 3600)]));
+    assert.deepEqual(body, { accepted: 0, dropped: 1 });
+
+    // device clock a minute ahead, sample of arrival time goes after it
+    ({ body } = await post("/api/data/bulk", [sample(now + 60)]));
+    assert.deepEqual(body, { accepted: 1, dropped: 0 });
+    assert.equal((await post("/api/data", { temperature: 21, pressure: 1001, humidity: 51 })).status, 200);
+    assert.equal((await post("/api/data", { temperature: 22, pressure: 1002, humidity: 52 })).status, 200);
+
+    const all = (await get("/api/history")).body;
+    const times = all.map(h => h.timestamp);
+    assert.equal(all.length, 6);
+    assert.deepEqual(times.slice(0, 4), [now - 50, now - 40, now - 30, now + 60].map(t => t * 1000));
+    assert.deepEqual(times.slice(4), [(now + 60) * 1000 + 1, (now + 60) * 1000 + 2]);
+
+    // every sample is found by its own window
+    for (const h of all) {
+      const { items } = (await get(`/api/history?from=${h.timestamp}&to=${h.timestamp}`)).body;
+      assert.deepEqual(items, [h]);
+    }
+
+    // pages of 2 over the window without its first and last sample
+    const pages = [];
+    let cursor;
+    do {
+      const url = `/api/history?from=${times[0] + 1}&to=${times[5] - 1}&limit=2` + (cursor ? `&cursor=${cursor}` : "");
+      ({ body } = await get(url));
+      pages.push(body.items.map(h => h.seq));
+      cursor = body.nextCursor;
+    } while (cursor !== null);
+    assert.deepEqual(pages, [[1, 2], [3, 4]]);
+
+    ({ body } = await get(`/api/history?from=${times[3]}&to=${times[2]}`));
+    assert.deepEqual(body, { items: [], nextCursor: null });
+    assert.equal((await get("/api/history?from=yesterday")).status, 400);
+    assert.equal((await get("/api/history?limit=2&cursor=-1")).status, 400);
+
+    const csv = (await get(`/api/export?from=${times[1]}&to=${times[4]}`)).body;
+    assert.equal(csv.split("\n").length, 1 + 4);
+  } finally {
+    await server.kill("SIGKILL");
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+});
+
+test("HTTP: pages, cursors and export reach samples evicted from memory", async () => {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), "meteo-range-"));
+  const server = await startServer(dir, { MAX_HISTORY: "5" });
+  const post = (url, body) => request(server.port, "POST", url, body);
+  const get = (url) => request(server.port, "GET", url);
+
+  try {
+    // seqs 0 .. 11, memory keeps 7 .. 11
+    const now = Math.floor(Date.now() / 1000);
+    const samples = Array.from({ length: 12 }, (_, i) =>
+      ({ ts: now - 120 + i * 10, temperature: 20 + i / 10, pressure: 1000 + i, humidity: 50 }));
+    const expected = samples.map((s, seq) =>
+      ({ temperature: s.temperature, pressure: s.pressure, humidity: s.humidity, timestamp: s.ts * 1000, seq }));
+    assert.deepEqual((await post("/api/data/bulk", samples)).body, { accepted: 12, dropped: 0 });
+    assert.equal((await get("/api/history")).body.length, 5);
+
+    // evicted samples are read after the group commit
+    await new Promise(resolve => setTimeout(resolve, 1500));
+
+    // window older than memory
+    let { body } = await get(`/api/history?from=${expected[2].timestamp}&to=${expected[5].timestamp}`);
+    assert.deepEqual(body, { items: expected.slice(2, 6), nextCursor: null });
+
+    // pages of 4 from the oldest sample, the second one goes on in memory
+    const pages = [];
+    let cursor;
+    do {
+      ({ body } = await get(`/api/history?from=0&limit=4` + (cursor ? `&cursor=${cursor}` : "")));
+      pages.push(body.items);
+      cursor = body.nextCursor;
+    } while (cursor !== null);
+    assert.deepEqual(pages, [expected.slice(0, 4), expected.slice(4, 8), expected.slice(8, 12)]);
+
+    // cursor of an evicted sample and open start
+    ({ body } = await get("/api/history?limit=2&cursor=1"));
+    assert.deepEqual(body, { items: expected.slice(1, 3), nextCursor: "3" });
+    ({ body } = await get(`/api/history?to=${expected[0].timestamp}`));
+    assert.deepEqual(body.items, expected.slice(0, 1));
+
+    const csv = (await get(`/api/export?from=${expected[1].timestamp}&to=${expected[8].timestamp}`)).body;
+    assert.equal(csv.split("\n").length, 1 + 8);
+
+    // samples of the cursor are gone after clear, 12 + 1 skipped seq
+    assert.equal((await post("/api/clear")).status, 200);
+    const gone = await get("/api/history?limit=2&cursor=3");
+    assert.equal(gone.status, 410);
+    assert.equal(gone.body.oldest, "13");
+    ({ body } = await get(`/api/history?from=0&limit=2`));
+    assert.deepEqual(body, { items: [], nextCursor: null });
+  } finally {
+    await server.kill("SIGKILL");
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+});
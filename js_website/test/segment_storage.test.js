@@ -0,0 +1,153 @@
+// Group commit of SegmentStorage with short and failed writes
+const { test } = require("node:test");
+const assert = require("node:assert/strict");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const { SegmentStorage, RECORD_SIZE } = require("../server");
+
+const sample = (i) => ({ temperature: 20 + i / 10, pressure: 1000 + i, humidity: 50, timestamp: 1700000000000 + i * 10000 });
+
+const withStorage = async (fn) => {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), "meteo-storage-"));
+  const storage = new SegmentStorage(dir);
+  storage.open(0, () => {});
+  try {
+    await fn(storage, dir);
+  } finally {
+    clearTimeout(storage.timer);
+    fs.closeSync(storage.file);
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+};
+
+// Replaces fs.write while fn runs, write(call, args) returns bytes to write or throws
+const withWrite = async (write, fn) => {
+  const original = fs.write;
+  let call = 0;
+  fs.write = (fd, buf, offset, length, position, callback) => {
+    let bytes;
+    try {
+      bytes = write(call++, length);
+    } catch (err) {
+      return process.nextTick(callback, err);
+    }
+    original(fd, buf, offset, Math.min(bytes, length), position, callback);
+  };
+  try {
+    await fn();
+  } finally {
+    fs.write = original;
+  }
+};
+
+const reopen = (dir) => {
+  const entries = [];
+  const storage = new SegmentStorage(dir);
+  storage.open(Infinity, (entry) => entries.push(entry));
+  fs.closeSync(storage.file);
+  return { entries, storage };
+};
+
+test("short writes are continued until the whole commit is written", async () => {
+  await withStorage(async (storage, dir) => {
+    for (let i = 0; i < 50; i++) storage.append(sample(i));
+
+    // 10 bytes per call, records are split between calls
+    await withWrite(() => 10, () => storage.flush());
+
+    assert.equal(storage.segmentRecords, 50);
+    assert.equal(storage.pending.length, 0);
+
+    const { entries } = reopen(dir);
+    assert.deepEqual(entries, Array.from({ length: 50 }, (_, i) => sample(i)));
+  });
+});
+
+test("failed write keeps unwritten records pending and the retry writes over the torn one", async () => {
+  await withStorage(async (storage, dir) => {
+    for (let i = 0; i < 10; i++) storage.append(sample(i));
+
+    // 3.5 records are written, then the disk fails
+    await withWrite((call) => {
+      if (call === 0) return 3.5 * RECORD_SIZE;
+      throw Object.assign(new Error("no space left"), { code: "ENOSPC" });
+    }, () => storage.flush());
+
+    assert.equal(storage.segmentRecords, 3);
+    assert.equal(storage.pending.length, 7);
+    assert.equal(storage.nextSeq(), 10);
+    assert.notEqual(storage.timer, null, "retry is scheduled");
+
+    for (let i = 10; i < 12; i++) storage.append(sample(i));
+    await storage.flush();
+
+    assert.equal(storage.segmentRecords, 12);
+    assert.equal(fs.statSync(storage.segmentPath(0)).size, 12 * RECORD_SIZE);
+
+    const { entries } = reopen(dir);
+    assert.deepEqual(entries, Array.from({ length: 12 }, (_, i) => sample(i)));
+  });
+});
+
+test("records of a failed write are dropped by clear and keep sequence numbers", async () => {
+  await withStorage(async (storage) => {
+    for (let i = 0; i < 5; i++) storage.append(sample(i));
+
+    await withWrite((call) => {
+      if (call === 0) return RECORD_SIZE;
+      throw new Error("io error");
+    }, async () => {
+      const failed = storage.flush();
+      storage.clear();
+      await failed;
+    });
+    await storage.chain;
+
+    // 1 written + 4 discarded + 1 skipped by clear, like HistoryStore.clear
+    assert.equal(storage.pending.length, 0);
+    assert.equal(storage.segmentSeq, 6);
+    assert.equal(storage.nextSeq(), 6);
+  });
+});
+
+test("seek and read go across segments and skip removed ones", async () => {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), "meteo-storage-"));
+  // recent, so open doesn't remove the segments as expired
+  const base = Date.now() - 100000;
+  const recent = (i) => ({ ...sample(i), timestamp: base + i * 10000 });
+  const time = (i) => recent(i).timestamp;
+
+  try {
+    const storage = new SegmentStorage(dir);
+    storage.open(0, () => {});
+    for (let i = 0; i < 10; i++) storage.append(recent(i));
+    clearTimeout(storage.timer);
+    await storage.flush();
+    fs.closeSync(storage.file);
+
+    // records 0 .. 9 are split into segments at 4 and 7, the first one is removed
+    const data = fs.readFileSync(storage.segmentPath(0));
+    fs.unlinkSync(storage.segmentPath(0));
+    fs.writeFileSync(storage.segmentPath(4), data.subarray(4 * RECORD_SIZE, 7 * RECORD_SIZE));
+    fs.writeFileSync(storage.segmentPath(7), data.subarray(7 * RECORD_SIZE));
+    const { storage: reopened } = reopen(dir);
+    await reopened.chain;
+
+    assert.equal(reopened.firstSeq(), 4);
+    assert.equal(await reopened.seek(time(0), false), 4, "removed records");
+    assert.equal(await reopened.seek(time(5), false), 5);
+    assert.equal(await reopened.seek(time(6), true), 7, "next segment");
+    assert.equal(await reopened.seek(time(8) + 1, false), 9);
+    assert.equal(await reopened.seek(time(9), true), 10, "after the last record");
+
+    const seqs = ({ items, next }) => ({ seqs: items.map(h => h.seq), next });
+    assert.deepEqual(seqs(await reopened.read(0, 10, 4)), { seqs: [4, 5, 6, 7], next: 8 });
+    assert.deepEqual(seqs(await reopened.read(8, 10, 4)), { seqs: [8, 9], next: 10 });
+    assert.deepEqual(seqs(await reopened.read(5, 8, 10)), { seqs: [5, 6, 7], next: 8 });
+    const { items } = await reopened.read(6, 7, 1);
+    assert.deepEqual(items, [{ ...recent(6), seq: 6 }]);
+  } finally {
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+});
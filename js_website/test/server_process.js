@@ -0,0 +1,51 @@
+// Server process on a free port for tests which go through HTTP
+const { spawn } = require("child_process");
+const http = require("http");
+const net = require("net");
+const path = require("path");
+
+const freePort = () => new Promise((resolve) => {
+  const srv = net.createServer().listen(0, () => {
+    const { port } = srv.address();
+    srv.close(() => resolve(port));
+  });
+});
+
+// Resolves when the server listens, kill(signal) resolves when it exited
+const startServer = async (dataDir, env = {}) => {
+  const port = await freePort();
+  const child = spawn(process.execPath, [path.join(__dirname, "..", "server.js")], {
+    env: { ...process.env, PORT: String(port), DATA_DIR: dataDir, ...env },
+    stdio: ["ignore", "pipe", "inherit"]
+  });
+  await new Promise((resolve, reject) => {
+    child.once("exit", (code, signal) => reject(new Error(`server exited with ${code || signal}`)));
+    child.stdout.on("data", (chunk) => {
+      if (chunk.toString().includes("Server running")) resolve();
+    });
+  });
+  child.removeAllListeners("exit");
+  const exited = new Promise((resolve) => child.once("exit", resolve));
+  return { port, kill: (signal) => { child.kill(signal); return exited; } };
+};
+
+// JSON body is parsed when the response is JSON, text is kept otherwise
+const request = (port, method, url, body) => new Promise((resolve, reject) => {
+  const data = body === undefined ? "" : JSON.stringify(body);
+  const req = http.request({
+    port, method, path: url,
+    headers: { "Content-Type": "application/json", "Content-Length": Buffer.byteLength(data) }
+  }, (res) => {
+    const chunks = [];
+    res.on("data", (chunk) => chunks.push(chunk));
+    res.on("end", () => {
+      const text = Buffer.concat(chunks).toString();
+      const json = (res.headers["content-type"] || "").includes("json");
+      resolve({ status: res.statusCode, body: json ? JSON.parse(text) : text });
+    });
+  });
+  req.on("error", reject);
+  req.end(data);
+});
+
+module.exports = { startServer, request };
@@ -0,0 +1,246 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_timer.h"
+
+/* esp_http_client of ESP-IDF on a TCP socket of the host, plain HTTP/1.1
+ * Only what set_data_on_site.c uses: POST with one header and a body,
+ * status code, events to the handler
+ */
+
+#define HOST_HTTP_HEAD_SIZE		1024
+#define HOST_HTTP_HEADERS		4
+
+struct esp_http_client
+{
+	esp_http_client_config_t config;
+	struct sockaddr_in addr;
+	char path[64];
+	char headers[HOST_HTTP_HEADERS][2][64];
+	int header_count;
+	const char *post_data;
+	int post_len;
+	int sock;
+	int status;
+};
+
+int64_t esp_timer_get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+esp_err_t esp_crt_bundle_attach(void *conf)
+{
+	(void)conf;
+	return ESP_OK;
+}
+
+static void client_event(esp_http_client_handle_t client, esp_http_client_event_id_t id, void *data, int len)
+{
+	esp_http_client_event_t event = { .event_id = id, .client = client, .data = data, .data_len = len };
+
+	if(client->config.event_handler) client->config.event_handler(&event);
+}
+
+static void client_disconnect(esp_http_client_handle_t client)
+{
+	if(client->sock < 0) return;
+
+	close(client->sock);
+	client->sock = -1;
+	client_event(client, HTTP_EVENT_DISCONNECTED, NULL, 0);
+}
+
+static esp_err_t client_connect(esp_http_client_handle_t client)
+{
+	int timeout_ms = client->config.timeout_ms ? client->config.timeout_ms : 5000;
+	struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+	int nodelay = 1;
+
+	client->sock = socket(AF_INET, SOCK_STREAM, 0);
+	if(client->sock < 0) return ESP_ERR_HTTP_CONNECT;
+
+	setsockopt(client->sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(client->sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	// head and body are sent apart, don't let them wait for delayed ack of the server
+	setsockopt(client->sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+	if(connect(client->sock, (struct sockaddr*)&client->addr, sizeof(client->addr)) != 0)
+	{
+		close(client->sock);
+		client->sock = -1;
+		return ESP_ERR_HTTP_CONNECT;
+	}
+
+	client_event(client, HTTP_EVENT_ON_CONNECTED, NULL, 0);
+	return ESP_OK;
+}
+
+static int client_send(int sock, const char *data, int len)
+{
+	while(len > 0)
+	{
+		ssize_t n = send(sock, data, len, MSG_NOSIGNAL);
+		if(n <= 0) return -1;
+		data += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/***************************************************************
+ * Client of one server, url is http://a.b.c.d:port/path
+ ***************************************************************/
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+	unsigned a, b, c, d, port;
+	int path_ofs = 0;
+
+	if(config->url == NULL ||
+		sscanf(config->url, "http://%u.%u.%u.%u:%u%n", &a, &b, &c, &d, &port, &path_ofs) != 5) return NULL;
+
+	esp_http_client_handle_t client = calloc(1, sizeof(*client));
+	if(client == NULL) return NULL;
+
+	client->config = *config;
+	client->addr.sin_family = AF_INET;
+	client->addr.sin_port = htons((uint16_t)port);
+	client->addr.sin_addr.s_addr = htonl((a << 24) | (b << 16) | (c << 8) | d);
+	snprintf(client->path, sizeof(client->path), "%s", config->url[path_ofs] ? &config->url[path_ofs] : "/");
+	client->sock = -1;
+
+	return client;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+	if(client == NULL) return ESP_FAIL;
+
+	client_disconnect(client);
+	free(client);
+	return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+	if(client->header_count == HOST_HTTP_HEADERS) return ESP_FAIL;
+
+	snprintf(client->headers[client->header_count][0], sizeof(client->headers[0][0]), "%s", key);
+	snprintf(client->headers[client->header_count][1], sizeof(client->headers[0][1]), "%s", value);
+	client->header_count++;
+	return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len)
+{
+	// data is not copied, like in IDF it must live until perform
+	client->post_data = data;
+	client->post_len = len;
+	return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+	return client->status;
+}
+
+/***************************************************************
+ * Send request and read the response
+ * Closed or broken connection fails the request, it is opened
+ * again by the next one
+ ***************************************************************/
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+	char head[HOST_HTTP_HEAD_SIZE];
+	int len, used = 0;
+	char *end = NULL;
+
+	client->status = 0;
+	if(client->sock < 0 && client_connect(client) != ESP_OK)
+	{
+		client_event(client, HTTP_EVENT_ERROR, NULL, 0);
+		return ESP_ERR_HTTP_CONNECT;
+	}
+
+	len = snprintf(head, sizeof(head), "%s %s HTTP/1.1\r\nHost: %s\r\nContent-Length: %d\r\nConnection: %s\r\n",
+			client->config.method == HTTP_METHOD_POST ? "POST" : "GET", client->path,
+			inet_ntoa(client->addr.sin_addr), client->post_len,
+			client->config.keep_alive_enable ? "keep-alive" : "close");
+	for(int i = 0; i < client->header_count; i++)
+	{
+		len += snprintf(head + len, sizeof(head) - len, "%s: %s\r\n", client->headers[i][0], client->headers[i][1]);
+	}
+	len += snprintf(head + len, sizeof(head) - len, "\r\n");
+
+	if(client_send(client->sock, head, len) != 0 ||
+		(client->post_len && client_send(client->sock, client->post_data, client->post_len) != 0))
+	{
+		client_event(client, HTTP_EVENT_ERROR, NULL, 0);
+		client_disconnect(client);
+		return ESP_ERR_HTTP_WRITE_DATA;
+	}
+	client_event(client, HTTP_EVENT_HEADERS_SENT, NULL, 0);
+
+	// Status line and headers
+	while(end == NULL)
+	{
+		ssize_t n = (used < (int)sizeof(head) - 1) ? recv(client->sock, head + used, sizeof(head) - 1 - used, 0) : -1;
+		if(n <= 0)
+		{
+			client_event(client, HTTP_EVENT_ERROR, NULL, 0);
+			client_disconnect(client);
+			return ESP_ERR_HTTP_FETCH_HEADER;
+		}
+		used += n;
+		head[used] = '\0';
+		end = strstr(head, "\r\n\r\n");
+	}
+
+	int content_length = 0, keep = client->config.keep_alive_enable;
+	sscanf(head, "HTTP/1.%*d %d", &client->status);
+	for(char *line = strstr(head, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n"))
+	{
+		if(strncasecmp(line + 2, "Content-Length:", 15) == 0) content_length = atoi(line + 17);
+		if(strncasecmp(line + 2, "Connection: close", 17) == 0) keep = 0;
+	}
+
+	// Body, part of it may be read with the headers
+	char body[HOST_HTTP_HEAD_SIZE];
+	int body_len = used - (int)(end + 4 - head);
+
+	if(content_length > (int)sizeof(body)) content_length = sizeof(body);
+	memcpy(body, end + 4, body_len);
+	while(body_len < content_length)
+	{
+		ssize_t n = recv(client->sock, body + body_len, content_length - body_len, 0);
+		if(n <= 0)
+		{
+			client_event(client, HTTP_EVENT_ERROR, NULL, 0);
+			client_disconnect(client);
+			return ESP_ERR_HTTP_FETCH_HEADER;
+		}
+		body_len += n;
+	}
+
+	if(body_len) client_event(client, HTTP_EVENT_ON_DATA, body, body_len);
+	client_event(client, HTTP_EVENT_ON_FINISH, NULL, 0);
+
+	// Server ends the connection, the next request connects again
+	if(!keep) client_disconnect(client);
+	return ESP_OK;
+}
@@ -0,0 +1,456 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "set_data_on_site.h"
+#include "flash_queue.h"
+#include "partition_sim.h"
+
+/* Upload task of ESP32 ( src/set_data_on_site.c ) with its persistent
+ * client against a stand-in HTTP server on 127.0.0.1
+ * The task runs on the test thread, its queue and tick are simulated:
+ * samples arrive every SAMPLE_PERIOD_MS of simulated time, so batch age
+ * and retry waits don't take real time. The server answers requests by
+ * a script and records the samples it accepted
+ */
+
+static int errors;
+
+#define CHECK(cond, ...)	do { if(!(cond)) { printf(__VA_ARGS__); printf("\n"); errors++; } } while(0)
+
+#define SAMPLE_PERIOD_MS	10000
+#define SERVER_SAMPLES		4096
+#define SERVER_SCRIPT		16
+
+/* globals of main.c */
+QueueHandle_t meteo_data_queue;
+SemaphoreHandle_t spi_mutex;
+spi_host_device_t SPI_HOST_STM;
+int32_t stm32_utc_offset;
+char host_server_url[64];
+
+typedef enum
+{
+	REPLY_KEEP = 0,		/* keep-alive response */
+	REPLY_CLOSE,		/* "Connection: close", connection is closed after response */
+	REPLY_THEN_DROP,	/* connection is closed after response without notice, like idle timeout */
+	REPLY_NONE,			/* connection is closed instead of response */
+}reply_t;
+
+typedef struct
+{
+	int status;
+	reply_t reply;
+}response_t;
+
+/* state of the server, protected by lock */
+static struct
+{
+	pthread_mutex_t lock;
+	int listen_sock;
+	uint32_t connections;
+	uint32_t requests;
+	uint32_t max_batch;				/* samples of the biggest request */
+	response_t script[SERVER_SCRIPT];	/* responses of the next requests, then 200 */
+	int script_len, script_pos;
+	uint32_t accepted[SERVER_SAMPLES];	/* ts of samples in 2xx requests */
+	uint32_t accepted_count;
+}server = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static measurement_t make_sample(uint32_t i)
+{
+	return (measurement_t){ .epoch = 1700000000 + i * 10, .temperature = (int16_t)(i * 7), .humidity = (uint16_t)(i * 3),
+		.pressure = 100000 + i, .flags = 0 };
+}
+
+/***************************************************************
+ * Stand-in server: HTTP/1.1 with keep-alive, one connection
+ * at a time like the one client of the ESP32
+ ***************************************************************/
+
+static int server_read_request(int sock, char *body, int size)
+{
+	char head[1024];
+	int used = 0, content_length = 0;
+	char *end = NULL;
+
+	while(end == NULL)
+	{
+		ssize_t n = (used < (int)sizeof(head) - 1) ? recv(sock, head + used, sizeof(head) - 1 - used, 0) : -1;
+		if(n <= 0) return -1;
+		used += n;
+		head[used] = '\0';
+		end = strstr(head, "\r\n\r\n");
+	}
+
+	for(char *line = strstr(head, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n"))
+	{
+		if(strncasecmp(line + 2, "Content-Length:", 15) == 0) content_length = atoi(line + 17);
+	}
+	if(content_length >= size) return -1;
+
+	int body_len = used - (int)(end + 4 - head);
+	memcpy(body, end + 4, body_len);
+	while(body_len < content_length)
+	{
+		ssize_t n = recv(sock, body + body_len, content_length - body_len, 0);
+		if(n <= 0) return -1;
+		body_len += n;
+	}
+	body[body_len] = '\0';
+	return body_len;
+}
+
+static void server_record(const char *body, int status)
+{
+	uint32_t samples = 0;
+
+	for(const char *ts = strstr(body, "\"ts\": "); ts; ts = strstr(ts + 1, "\"ts\": "))
+	{
+		if(status / 100 == 2 && server.accepted_count < SERVER_SAMPLES)
+		{
+			server.accepted[server.accepted_count++] = (uint32_t)strtoul(ts + 6, NULL, 10);
+		}
+		samples++;
+	}
+
+	if(samples > server.max_batch) server.max_batch = samples;
+}
+
+static void* server_task(void *arg)
+{
+	static char body[65536];
+	int sock;
+
+	(void)arg;
+	while((sock = accept(server.listen_sock, NULL, NULL)) >= 0)
+	{
+		pthread_mutex_lock(&server.lock);
+		server.connections++;
+		pthread_mutex_unlock(&server.lock);
+
+		while(server_read_request(sock, body, sizeof(body)) >= 0)
+		{
+			response_t r = { 200, REPLY_KEEP };
+			char reply[256];
+
+			pthread_mutex_lock(&server.lock);
+			if(server.script_pos < server.script_len) r = server.script[server.script_pos++];
+			server.requests++;
+			if(r.reply != REPLY_NONE) server_record(body, r.status);
+			pthread_mutex_unlock(&server.lock);
+
+			if(r.reply == REPLY_NONE) break;
+
+			int len = snprintf(reply, sizeof(reply), "HTTP/1.1 %d X\r\nContent-Type: application/json\r\n"
+					"Content-Length: 11\r\nConnection: %s\r\n\r\n{\"ok\":true}",
+					r.status, r.reply == REPLY_CLOSE ? "close" : "keep-alive");
+			send(sock, reply, len, MSG_NOSIGNAL);
+
+			if(r.reply != REPLY_KEEP) break;
+		}
+		close(sock);
+	}
+
+	return NULL;
+}
+
+static int server_start(void)
+{
+	struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+	socklen_t addr_len = sizeof(addr);
+	pthread_t thread;
+
+	server.listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+	if(server.listen_sock < 0 || bind(server.listen_sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+		listen(server.listen_sock, 4) != 0 || getsockname(server.listen_sock, (struct sockaddr*)&addr, &addr_len) != 0)
+	{
+		return -1;
+	}
+
+	snprintf(host_server_url, sizeof(host_server_url), "http://127.0.0.1:%u/api/data/bulk", ntohs(addr.sin_port));
+	pthread_create(&thread, NULL, server_task, NULL);
+	pthread_detach(thread);
+	return 0;
+}
+
+static void server_script(const response_t *script, int len)
+{
+	pthread_mutex_lock(&server.lock);
+	memcpy(server.script, script, len * sizeof(*script));
+	server.script_len = len;
+	server.script_pos = 0;
+	pthread_mutex_unlock(&server.lock);
+}
+
+/***************************************************************
+ * Simulated FreeRTOS of the task: sample i is in the queue at
+ * tick i * SAMPLE_PERIOD_MS, waiting advances the tick
+ * Wait without end after the last sample returns to the test
+ ***************************************************************/
+
+static TickType_t sim_tick;
+static uint32_t feed_next, feed_end;
+static jmp_buf feed_done;
+
+TickType_t xTaskGetTickCount(void)
+{
+	return sim_tick;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+	(void)xQueue;
+
+	if(feed_next < feed_end)
+	{
+		TickType_t due = feed_next * SAMPLE_PERIOD_MS;
+
+		if(due <= sim_tick || xTicksToWait == portMAX_DELAY || due - sim_tick <= xTicksToWait)
+		{
+			if(due > sim_tick) sim_tick = due;
+			*(measurement_t*)pvBuffer = make_sample(feed_next++);
+			return pdTRUE;
+		}
+	}
+	else if(xTicksToWait == portMAX_DELAY)
+	{
+		longjmp(feed_done, 1);
+	}
+
+	sim_tick += xTicksToWait;
+	return pdFALSE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+	return pdFALSE;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+	return pdTRUE;
+}
+
+esp_err_t spi_slave_transmit(spi_host_device_t host, spi_slave_transaction_t *trans_desc, TickType_t ticks_to_wait)
+{
+	return ESP_FAIL;
+}
+
+/***************************************************************
+ * Run the task until it has sent or dropped the next samples
+ ***************************************************************/
+
+typedef struct
+{
+	uint32_t connections;
+	uint32_t requests;
+	uint32_t accepted;
+	https_stats_t https;
+}snapshot_t;
+
+static void snapshot(snapshot_t *s)
+{
+	pthread_mutex_lock(&server.lock);
+	s->connections = server.connections;
+	s->requests = server.requests;
+	s->accepted = server.accepted_count;
+	pthread_mutex_unlock(&server.lock);
+	https_get_stats(&s->https);
+}
+
+static void run_samples(uint32_t samples)
+{
+	feed_end = feed_next + samples;
+	if(setjmp(feed_done) == 0) set_data_on_site_task(NULL);
+}
+
+/* samples first .. first + count were accepted once and in order, except skip_count from skip */
+static void check_accepted(const char *name, uint32_t from, uint32_t first, uint32_t count, uint32_t skip, uint32_t skip_count)
+{
+	uint32_t pos = from;
+
+	pthread_mutex_lock(&server.lock);
+	for(uint32_t i = first; i < first + count; i++)
+	{
+		if(i >= skip && i < skip + skip_count) continue;
+
+		if(pos >= server.accepted_count || server.accepted[pos] != make_sample(i).epoch)
+		{
+			printf("%s: sample %lu is %s\n", name, (unsigned long)i, pos >= server.accepted_count ? "missing" : "out of order");
+			errors++;
+			break;
+		}
+		pos++;
+	}
+	CHECK(pos == server.accepted_count, "%s: %lu samples accepted, expected %lu", name,
+			(unsigned long)(server.accepted_count - from), (unsigned long)(pos - from));
+	pthread_mutex_unlock(&server.lock);
+}
+
+/***************************************************************
+ * Batches of UPLOAD_BATCH_MAX samples share one connection
+ ***************************************************************/
+
+static void test_keep_alive(void)
+{
+	snapshot_t s0, s1;
+	uint32_t first = feed_next;
+
+	snapshot(&s0);
+	run_samples(10 * UPLOAD_BATCH_MAX);
+	snapshot(&s1);
+
+	CHECK(s1.connections - s0.connections == 1, "keep alive: %lu connections", (unsigned long)(s1.connections - s0.connections));
+	CHECK(s1.https.connects - s0.https.connects == 1, "keep alive: client created %lu times",
+			(unsigned long)(s1.https.connects - s0.https.connects));
+	CHECK(s1.requests - s0.requests == 10 && s1.https.requests - s0.https.requests == 10,
+			"keep alive: %lu requests, %lu counted", (unsigned long)(s1.requests - s0.requests),
+			(unsigned long)(s1.https.requests - s0.https.requests));
+	CHECK(s1.https.failures == s0.https.failures, "keep alive: failures");
+	CHECK(s1.https.max_ms < 1000 && s1.https.min_ms <= s1.https.last_ms, "keep alive: latency min %lu last %lu max %lu ms",
+			(unsigned long)s1.https.min_ms, (unsigned long)s1.https.last_ms, (unsigned long)s1.https.max_ms);
+	check_accepted("keep alive", s0.accepted, first, 10 * UPLOAD_BATCH_MAX, 0, 0);
+}
+
+/***************************************************************
+ * Kept connection closed by the server fails one request,
+ * the batch goes through flash and the client is created again
+ ***************************************************************/
+
+static void test_idle_close(void)
+{
+	static const response_t script[] = { { 200, REPLY_THEN_DROP } };
+	snapshot_t s0, s1;
+	uint32_t first = feed_next;
+
+	server_script(script, 1);
+	snapshot(&s0);
+	run_samples(5 * UPLOAD_BATCH_MAX);
+	snapshot(&s1);
+
+	CHECK(s1.https.failures - s0.https.failures == 1, "idle close: %lu failures", (unsigned long)(s1.https.failures - s0.https.failures));
+	CHECK(s1.https.connects - s0.https.connects == 1, "idle close: client created %lu times",
+			(unsigned long)(s1.https.connects - s0.https.connects));
+	CHECK(s1.connections - s0.connections == 1, "idle close: %lu new connections", (unsigned long)(s1.connections - s0.connections));
+	CHECK(flash_queue_count() == 0, "idle close: %lu samples left in flash", (unsigned long)flash_queue_count());
+	check_accepted("idle close", s0.accepted, first, 5 * UPLOAD_BATCH_MAX, 0, 0);
+}
+
+/***************************************************************
+ * "Connection: close" of the server is followed by the client
+ * itself, the request doesn't fail
+ ***************************************************************/
+
+static void test_connection_close(void)
+{
+	static const response_t script[] = { { 200, REPLY_CLOSE }, { 200, REPLY_CLOSE } };
+	snapshot_t s0, s1;
+	uint32_t first = feed_next;
+
+	server_script(script, 2);
+	snapshot(&s0);
+	run_samples(4 * UPLOAD_BATCH_MAX);
+	snapshot(&s1);
+
+	CHECK(s1.https.failures == s0.https.failures, "connection close: %lu failures",
+			(unsigned long)(s1.https.failures - s0.https.failures));
+	CHECK(s1.https.connects == s0.https.connects, "connection close: client created again");
+	CHECK(s1.connections - s0.connections == 2, "connection close: %lu new connections",
+			(unsigned long)(s1.connections - s0.connections));
+	check_accepted("connection close", s0.accepted, first, 4 * UPLOAD_BATCH_MAX, 0, 0);
+}
+
+/***************************************************************
+ * 5xx and 429 are retried from flash, 4xx drops the batch,
+ * status errors keep the connection
+ ***************************************************************/
+
+static void test_status(void)
+{
+	static const response_t script[] = { { 503, REPLY_KEEP }, { 429, REPLY_KEEP }, { 200, REPLY_KEEP }, { 400, REPLY_KEEP } };
+	snapshot_t s0, s1;
+	uint32_t first = feed_next;
+
+	server_script(script, 4);
+	snapshot(&s0);
+	run_samples(8 * UPLOAD_BATCH_MAX);
+	snapshot(&s1);
+
+	// 503 and 429 fail the first batch twice, flash batch is accepted, the next live batch is rejected
+	uint32_t rejected = first + UPLOAD_BATCH_MAX + 2 * UPLOAD_RETRY_MS / SAMPLE_PERIOD_MS;
+
+	CHECK(s1.https.failures - s0.https.failures == 3, "status: %lu failures", (unsigned long)(s1.https.failures - s0.https.failures));
+	CHECK(s1.https.rejected - s0.https.rejected == 1 && s1.https.dropped - s0.https.dropped == UPLOAD_BATCH_MAX,
+			"status: %lu rejected, %lu dropped", (unsigned long)(s1.https.rejected - s0.https.rejected),
+			(unsigned long)(s1.https.dropped - s0.https.dropped));
+	CHECK(s1.connections == s0.connections && s1.https.connects == s0.https.connects, "status: connection was not kept");
+	check_accepted("status", s0.accepted, first, 8 * UPLOAD_BATCH_MAX, rejected, UPLOAD_BATCH_MAX);
+}
+
+/***************************************************************
+ * Server without response for 10 minutes, samples wait in flash
+ * and go in batches of UPLOAD_FLASH_BATCH
+ ***************************************************************/
+
+static void test_outage(void)
+{
+	static const response_t script[] =
+	{
+		{ 200, REPLY_NONE }, { 200, REPLY_NONE }, { 200, REPLY_NONE }, { 200, REPLY_NONE }, { 200, REPLY_NONE },
+		{ 200, REPLY_NONE }, { 200, REPLY_NONE }, { 200, REPLY_NONE }, { 200, REPLY_NONE }, { 200, REPLY_NONE },
+		{ 200, REPLY_NONE }, { 200, REPLY_NONE }, { 200, REPLY_NONE }, { 200, REPLY_NONE }, { 200, REPLY_NONE },
+	};
+	snapshot_t s0, s1;
+	uint32_t first = feed_next;
+
+	server_script(script, sizeof(script) / sizeof(script[0]));
+	snapshot(&s0);
+	pthread_mutex_lock(&server.lock);
+	server.max_batch = 0;
+	pthread_mutex_unlock(&server.lock);
+
+	run_samples(30 * UPLOAD_BATCH_MAX);
+	snapshot(&s1);
+
+	CHECK(s1.https.failures - s0.https.failures == 15, "outage: %lu failures", (unsigned long)(s1.https.failures - s0.https.failures));
+	CHECK(s1.https.connects - s0.https.connects == 15, "outage: client created %lu times",
+			(unsigned long)(s1.https.connects - s0.https.connects));
+	CHECK(server.max_batch == UPLOAD_FLASH_BATCH, "outage: biggest batch %lu samples", (unsigned long)server.max_batch);
+	CHECK(flash_queue_count() == 0, "outage: %lu samples left in flash", (unsigned long)flash_queue_count());
+	check_accepted("outage", s0.accepted, first, 30 * UPLOAD_BATCH_MAX, 0, 0);
+}
+
+int main(void)
+{
+	if(server_start() != 0)
+	{
+		printf("stand-in server can't listen\n");
+		return 1;
+	}
+	if(partition_sim_create(FLASH_QUEUE_PARTITION, 4) != 0 || flash_queue_init() != ESP_OK)
+	{
+		printf("flash queue can't be created\n");
+		return 1;
+	}
+
+	test_keep_alive();
+	test_idle_close();
+	test_connection_close();
+	test_status();
+	test_outage();
+
+	printf("set_data_on_site_test: %d errors\n", errors);
+	return errors ? 1 : 0;
+}
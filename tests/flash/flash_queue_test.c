@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <string.h>
+#include "flash_queue.h"
+#include "partition_sim.h"
+
+/* Store-and-forward queue of ESP32 ( src/flash_queue.c ) on a simulated
+ * NOR partition: FIFO order across sectors and restarts, dropping of the
+ * oldest sector when full, even wear, write errors and power cuts in
+ * every write and erase of the queue
+ */
+
+static int errors;
+
+#define CHECK(cond, ...)	do { if(!(cond)) { printf(__VA_ARGS__); printf("\n"); errors++; } } while(0)
+
+#define TEST_SECTORS		4
+#define TEST_BATCH			30		/* UPLOAD_FLASH_BATCH */
+
+static measurement_t make_sample(uint32_t i)
+{
+	return (measurement_t){ .epoch = 1700000000 + i * 10, .temperature = (int16_t)(i * 7), .humidity = (uint16_t)(i * 3),
+		.pressure = 100000 + i, .flags = 0 };
+}
+
+static uint32_t sample_index(const measurement_t *m)
+{
+	return (m->epoch - 1700000000) / 10;
+}
+
+static int same_sample(const measurement_t *m, uint32_t i)
+{
+	measurement_t expected = make_sample(i);
+	return memcmp(m, &expected, sizeof(expected)) == 0;
+}
+
+static void start(uint32_t sectors)
+{
+	partition_sim_create(FLASH_QUEUE_PARTITION, sectors);
+	CHECK(flash_queue_init() == ESP_OK, "init of empty partition");
+}
+
+static void restart(void)
+{
+	partition_sim_power_on();
+	CHECK(flash_queue_init() == ESP_OK, "init after restart");
+}
+
+static void push_range(uint32_t first, uint32_t end)
+{
+	for(uint32_t i = first; i < end; i++)
+	{
+		measurement_t m = make_sample(i);
+		CHECK(flash_queue_push(&m) == ESP_OK, "push %lu", (unsigned long)i);
+	}
+}
+
+/***************************************************************
+ * Upload the queue like set_data_on_site_task, samples are
+ * compared with the expected indexes, -1 ends the list
+ ***************************************************************/
+
+static void drain_expect(const char *test, const int32_t *expected)
+{
+	measurement_t batch[TEST_BATCH];
+	size_t pos = 0;
+	int n;
+
+	while((n = flash_queue_peek(batch, TEST_BATCH)) > 0)
+	{
+		for(int i = 0; i < n; i++, pos++)
+		{
+			if(expected[pos] < 0)
+			{
+				CHECK(0, "%s: extra sample %lu", test, (unsigned long)sample_index(&batch[i]));
+				return;
+			}
+			if(!same_sample(&batch[i], (uint32_t)expected[pos]))
+			{
+				CHECK(0, "%s: sample %lu instead of %ld", test, (unsigned long)sample_index(&batch[i]), (long)expected[pos]);
+				return;
+			}
+		}
+		CHECK(flash_queue_pop(n) == ESP_OK, "%s: pop", test);
+	}
+
+	CHECK(expected[pos] < 0, "%s: sample %ld is missing", test, (long)expected[pos]);
+	CHECK(flash_queue_count() == 0, "%s: %lu pending after drain", test, (unsigned long)flash_queue_count());
+}
+
+/* expected list of first <= i < end without one index ( -1 for none ) */
+static const int32_t *range_list(uint32_t first, uint32_t end, int32_t skip)
+{
+	static int32_t list[70000];
+	size_t n = 0;
+
+	for(uint32_t i = first; i < end && n < sizeof(list) / sizeof(list[0]) - 1; i++)
+	{
+		if((int32_t)i != skip) list[n++] = (int32_t)i;
+	}
+	list[n] = -1;
+	return list;
+}
+
+static void check_no_misuse(const char *test)
+{
+	partition_sim_stats_t stats;
+	partition_sim_get_stats(&stats);
+	CHECK(stats.misuses == 0, "%s: %lu writes over not erased data", test, (unsigned long)stats.misuses);
+}
+
+/***************************************************************
+ * FIFO order across sectors
+ ***************************************************************/
+
+static void test_fifo(void)
+{
+	start(TEST_SECTORS);
+
+	push_range(0, 700);
+	CHECK(flash_queue_count() == 700, "fifo: %lu pending", (unsigned long)flash_queue_count());
+	drain_expect("fifo", range_list(0, 700, -1));
+
+	push_range(700, 710);
+	drain_expect("fifo after drain", range_list(700, 710, -1));
+	check_no_misuse("fifo");
+}
+
+/***************************************************************
+ * Pending and sent samples survive restart
+ ***************************************************************/
+
+static void test_restart(void)
+{
+	measurement_t batch[TEST_BATCH];
+
+	start(TEST_SECTORS);
+	push_range(0, 300);
+	for(int i = 0; i < 4; i++)
+	{
+		CHECK(flash_queue_peek(batch, TEST_BATCH) == TEST_BATCH, "restart: peek");
+		flash_queue_pop(TEST_BATCH);
+	}
+
+	restart();
+	CHECK(flash_queue_count() == 180, "restart: %lu pending", (unsigned long)flash_queue_count());
+	push_range(300, 320);
+	restart();
+	drain_expect("restart", range_list(120, 320, -1));
+
+	// empty queue after restart continues in the same sector
+	restart();
+	CHECK(flash_queue_count() == 0, "restart of empty queue: %lu pending", (unsigned long)flash_queue_count());
+	push_range(320, 330);
+	drain_expect("restart of empty queue", range_list(320, 330, -1));
+	check_no_misuse("restart");
+}
+
+/***************************************************************
+ * Full queue drops the oldest sector, the rest keeps order
+ ***************************************************************/
+
+static void test_full(void)
+{
+	flash_queue_stats_t before, after;
+
+	start(TEST_SECTORS);
+	flash_queue_get_stats(&before);
+	push_range(0, 5000);
+	flash_queue_get_stats(&after);
+
+	uint32_t pending = flash_queue_count();
+	uint32_t dropped = after.dropped - before.dropped;
+
+	CHECK(dropped > 0, "full: nothing dropped");
+	CHECK(pending + dropped == 5000, "full: %lu pending + %lu dropped", (unsigned long)pending, (unsigned long)dropped);
+	CHECK(pending >= (TEST_SECTORS - 1) * (FLASH_QUEUE_SLOTS - 1), "full: only %lu pending", (unsigned long)pending);
+
+	restart();
+	CHECK(flash_queue_count() == pending, "full: %lu pending after restart", (unsigned long)flash_queue_count());
+	drain_expect("full", range_list(5000 - pending, 5000, -1));
+	check_no_misuse("full");
+}
+
+/***************************************************************
+ * Sectors are erased in turn while samples are uploaded
+ ***************************************************************/
+
+static void test_wear(void)
+{
+	measurement_t batch[TEST_BATCH];
+	uint32_t next = 0;
+	const uint32_t sectors = 8;
+
+	start(sectors);
+	for(uint32_t i = 0; i < 60000; i++)
+	{
+		measurement_t m = make_sample(i);
+		flash_queue_push(&m);
+
+		if(flash_queue_count() >= TEST_BATCH)
+		{
+			int n = flash_queue_peek(batch, TEST_BATCH);
+			for(int k = 0; k < n; k++, next++)
+			{
+				if(!same_sample(&batch[k], next))
+				{
+					CHECK(0, "wear: sample %lu instead of %lu", (unsigned long)sample_index(&batch[k]), (unsigned long)next);
+					return;
+				}
+			}
+			flash_queue_pop(n);
+		}
+	}
+
+	uint32_t min = UINT32_MAX, max = 0;
+	for(uint32_t s = 0; s < sectors; s++)
+	{
+		uint32_t count = partition_sim_erase_count(s);
+		if(count < min) min = count;
+		if(count > max) max = count;
+	}
+	CHECK(max - min <= 1, "wear: erase count of sectors %lu - %lu", (unsigned long)min, (unsigned long)max);
+	check_no_misuse("wear");
+}
+
+/***************************************************************
+ * Failed writes don't break the queue
+ ***************************************************************/
+
+static void test_write_errors(void)
+{
+	flash_queue_stats_t before, after;
+	measurement_t m = make_sample(10);
+	measurement_t batch[TEST_BATCH];
+
+	start(TEST_SECTORS);
+	flash_queue_get_stats(&before);
+	push_range(0, 10);
+
+	partition_sim_fail(1);
+	CHECK(flash_queue_push(&m) != ESP_OK, "write errors: failed write is reported");
+	flash_queue_get_stats(&after);
+	CHECK(after.errors == before.errors + 1, "write errors: error is not counted");
+	CHECK(flash_queue_count() == 10, "write errors: %lu pending", (unsigned long)flash_queue_count());
+	push_range(11, 40);
+
+	// sent mark of the 5th sample fails, the rest of the batch stays pending
+	CHECK(flash_queue_peek(batch, TEST_BATCH) == TEST_BATCH, "write errors: peek");
+	partition_sim_fail(5);
+	CHECK(flash_queue_pop(TEST_BATCH) != ESP_OK, "write errors: failed pop is reported");
+	CHECK(flash_queue_count() == 35, "write errors: %lu pending after failed pop", (unsigned long)flash_queue_count());
+
+	drain_expect("write errors", range_list(4, 40, 10));
+	check_no_misuse("write errors");
+}
+
+/***************************************************************
+ * Sample with bad crc is skipped, the rest is kept
+ ***************************************************************/
+
+static void test_bad_crc(void)
+{
+	start(TEST_SECTORS);
+	push_range(0, 20);
+
+	// bit of temperature of the 6th sample goes to zero
+	uint8_t *slot = partition_sim_data() + 6 * FLASH_QUEUE_SLOT_SIZE;
+	slot[offsetof(measurement_t, temperature)] &= 0xFE;
+
+	restart();
+	CHECK(flash_queue_count() == 19, "bad crc: %lu pending", (unsigned long)flash_queue_count());
+	drain_expect("bad crc", range_list(0, 20, 5));
+}
+
+/***************************************************************
+ * Power cut in the write of a sample, every torn length
+ ***************************************************************/
+
+static void test_cut_sample(void)
+{
+	for(uint32_t bytes = 0; bytes < FLASH_QUEUE_SLOT_SIZE; bytes++)
+	{
+		char test[32];
+		measurement_t m = make_sample(10);
+
+		snprintf(test, sizeof(test), "cut sample at %lu", (unsigned long)bytes);
+		start(TEST_SECTORS);
+		push_range(0, 10);
+
+		partition_sim_cut(1, bytes);
+		CHECK(flash_queue_push(&m) != ESP_OK, "%s: push is not failed", test);
+		restart();
+		push_range(11, 20);
+
+		// sample is complete when its written mark is programmed, sent mark follows it
+		int complete = bytes > offsetof(flash_queue_slot_t, written);
+		drain_expect(test, range_list(0, 20, complete ? -1 : 10));
+		check_no_misuse(test);
+	}
+}
+
+/***************************************************************
+ * Power cut in erase or header write of a new sector
+ ***************************************************************/
+
+static void test_cut_sector(void)
+{
+	for(uint32_t bytes = 0; bytes <= FLASH_QUEUE_SLOT_SIZE; bytes++)
+	{
+		char test[32];
+		uint32_t full = FLASH_QUEUE_SLOTS - 1;
+		measurement_t m = make_sample(full);
+
+		snprintf(test, sizeof(test), "cut sector at %lu", (unsigned long)bytes);
+		start(TEST_SECTORS);
+		push_range(0, full);
+
+		// bytes == 0 cuts the erase, others the header write after it
+		if(bytes == 0) partition_sim_cut(1, 0);
+		else partition_sim_cut(2, bytes - 1);
+
+		CHECK(flash_queue_push(&m) != ESP_OK, "%s: push is not failed", test);
+		restart();
+		CHECK(flash_queue_count() == full, "%s: %lu pending", test, (unsigned long)flash_queue_count());
+		push_range(full + 1, full + 300);
+		restart();
+		drain_expect(test, range_list(0, full + 300, (int32_t)full));
+		check_no_misuse(test);
+	}
+}
+
+/***************************************************************
+ * Power cut while samples are marked as sent, unmarked ones
+ * are sent again after restart
+ ***************************************************************/
+
+static void test_cut_pop(void)
+{
+	measurement_t batch[TEST_BATCH];
+
+	start(TEST_SECTORS);
+	push_range(0, 60);
+
+	CHECK(flash_queue_peek(batch, TEST_BATCH) == TEST_BATCH, "cut pop: peek");
+	partition_sim_cut(10, 0);
+	CHECK(flash_queue_pop(TEST_BATCH) != ESP_OK, "cut pop: pop is not failed");
+
+	restart();
+	CHECK(flash_queue_count() == 51, "cut pop: %lu pending", (unsigned long)flash_queue_count());
+	drain_expect("cut pop", range_list(9, 60, -1));
+	check_no_misuse("cut pop");
+}
+
+int main(void)
+{
+	test_fifo();
+	test_restart();
+	test_full();
+	test_wear();
+	test_write_errors();
+	test_bad_crc();
+	test_cut_sample();
+	test_cut_sector();
+	test_cut_pop();
+
+	partition_sim_free();
+	printf("flash_queue_test: %d errors\n", errors);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <string.h>
+#include "partition_sim.h"
+
+int host_log_verbose;
+
+static esp_partition_t partition;
+static uint8_t *data;
+static uint32_t *erase_counts;
+static partition_sim_stats_t stats;
+
+static uint32_t fail_op, cut_op, cut_bytes;
+static int power_off;
+
+/***************************************************************
+ * Create the partition, it is erased like a new chip
+ ***************************************************************/
+
+int partition_sim_create(const char *label, uint32_t sectors)
+{
+	partition_sim_free();
+
+	data = malloc((size_t)sectors * PARTITION_SIM_SECTOR_SIZE);
+	erase_counts = calloc(sectors, sizeof(*erase_counts));
+	if(data == NULL || erase_counts == NULL) return -1;
+	memset(data, 0xFF, (size_t)sectors * PARTITION_SIM_SECTOR_SIZE);
+
+	memset(&partition, 0, sizeof(partition));
+	partition.type = ESP_PARTITION_TYPE_DATA;
+	partition.size = sectors * PARTITION_SIM_SECTOR_SIZE;
+	strncpy(partition.label, label, sizeof(partition.label) - 1);
+
+	memset(&stats, 0, sizeof(stats));
+	fail_op = cut_op = 0;
+	power_off = 0;
+	return 0;
+}
+
+void partition_sim_free(void)
+{
+	free(data);
+	free(erase_counts);
+	data = NULL;
+	erase_counts = NULL;
+}
+
+void partition_sim_fail(uint32_t op)
+{
+	fail_op = op;
+}
+
+void partition_sim_cut(uint32_t op, uint32_t bytes)
+{
+	cut_op = op;
+	cut_bytes = bytes;
+}
+
+void partition_sim_power_on(void)
+{
+	power_off = 0;
+}
+
+uint8_t *partition_sim_data(void)
+{
+	return data;
+}
+
+uint32_t partition_sim_erase_count(uint32_t sector)
+{
+	return erase_counts[sector];
+}
+
+void partition_sim_get_stats(partition_sim_stats_t *s)
+{
+	*s = stats;
+}
+
+/***************************************************************
+ * Armed faults of the next write or erase
+ * Returns 0 to do the operation, 1 to fail it, 2 for power cut
+ ***************************************************************/
+
+static int sim_fault(void)
+{
+	int fault = 0;
+
+	if(power_off) fault = 1;
+	if(fail_op && --fail_op == 0) fault = 1;
+	if(cut_op && --cut_op == 0)
+	{
+		power_off = 1;
+		fault = 2;
+	}
+
+	if(fault) stats.failures++;
+	return fault;
+}
+
+static int sim_in_range(const esp_partition_t *p, size_t offset, size_t size)
+{
+	return p == &partition && data != NULL && offset + size <= partition.size && offset + size >= offset;
+}
+
+/***************************************************************
+ * esp_partition API
+ ***************************************************************/
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+	(void)subtype;
+	if(data == NULL || type != partition.type || (label && strcmp(label, partition.label) != 0)) return NULL;
+	return &partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t src_offset, void *dst, size_t size)
+{
+	if(!sim_in_range(p, src_offset, size)) return ESP_ERR_INVALID_ARG;
+	if(power_off) return ESP_FAIL;
+
+	stats.reads++;
+	memcpy(dst, data + src_offset, size);
+	return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t dst_offset, const void *src, size_t size)
+{
+	const uint8_t *bytes = src;
+
+	if(!sim_in_range(p, dst_offset, size)) return ESP_ERR_INVALID_ARG;
+
+	int fault = sim_fault();
+	if(fault == 1) return ESP_FAIL;
+	if(fault == 2 && cut_bytes < size) size = cut_bytes;
+
+	stats.writes++;
+	for(size_t i = 0; i < size; i++)
+	{
+		if(bytes[i] & ~data[dst_offset + i]) stats.misuses++;
+		data[dst_offset + i] &= bytes[i];
+	}
+	return fault ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t offset, size_t size)
+{
+	if(!sim_in_range(p, offset, size) || offset % PARTITION_SIM_SECTOR_SIZE || size % PARTITION_SIM_SECTOR_SIZE)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if(sim_fault()) return ESP_FAIL;
+
+	stats.erases++;
+	memset(data + offset, 0xFF, size);
+	for(size_t s = offset / PARTITION_SIM_SECTOR_SIZE; s < (offset + size) / PARTITION_SIM_SECTOR_SIZE; s++)
+	{
+		erase_counts[s]++;
+	}
+	return ESP_OK;
+}
@@ -0,0 +1,40 @@
+#ifndef TESTS_PARTITION_SIM_H_
+#define TESTS_PARTITION_SIM_H_
+
+#include <stdint.h>
+#include "esp_partition.h"
+
+/* NOR flash model of one data partition for host tests of ESP32 modules
+ * Erase sets a 4 KB sector to 0xFF, write can only clear bits like on
+ * the chip. A write which would set a bit is counted as misuse, it means
+ * the module writes over data it didn't erase.
+ * Faults are armed for the n-th following write or erase ( 1 is the next ):
+ *   fail   the operation returns ESP_FAIL and changes nothing
+ *   cut    power is lost, a write programs only its first bytes, an
+ *          erase is lost; every operation fails until power is back
+ */
+
+#define PARTITION_SIM_SECTOR_SIZE	4096
+
+typedef struct
+{
+	uint32_t reads;
+	uint32_t writes;
+	uint32_t erases;
+	uint32_t misuses;			/* writes which would set a cleared bit */
+	uint32_t failures;			/* operations failed by armed faults or power loss */
+}partition_sim_stats_t;
+
+int partition_sim_create(const char *label, uint32_t sectors);
+void partition_sim_free(void);
+
+void partition_sim_fail(uint32_t op);
+void partition_sim_cut(uint32_t op, uint32_t bytes);
+void partition_sim_power_on(void);
+
+/* Raw access for corruption by the test */
+uint8_t *partition_sim_data(void);
+uint32_t partition_sim_erase_count(uint32_t sector);
+void partition_sim_get_stats(partition_sim_stats_t *stats);
+
+#endif /* TESTS_PARTITION_SIM_H_ */
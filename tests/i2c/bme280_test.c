@@ -0,0 +1,199 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "bme280.h"
+#include "i2c_bus.h"
+
+/* BME280 driver ( Drivers/bsp/bme280.c ) on a register file of the sensor
+ * Calibration and raw values are packed as the chip holds them, results are
+ * compared with the example of the datasheet and with its floating point
+ * compensation formulas
+ */
+
+static int errors;
+
+#define CHECK(cond, ...)	do { if(!(cond)) { printf(__VA_ARGS__); printf("\n"); errors++; } } while(0)
+
+static i2c_regfile_t sensor = { .dev_addr = BME280_I2C_ADDR };
+
+/* trimming parameters, T and P of the datasheet example, H of a real part */
+static const BME280_calib_t trim =
+{
+	.dig_T1 = 27504, .dig_T2 = 26435, .dig_T3 = -1000,
+	.dig_P1 = 36477, .dig_P2 = -10685, .dig_P3 = 3024, .dig_P4 = 2855, .dig_P5 = 140,
+	.dig_P6 = -7, .dig_P7 = 15500, .dig_P8 = -14600, .dig_P9 = 6000,
+	.dig_H1 = 75, .dig_H2 = 362, .dig_H3 = 0, .dig_H4 = 313, .dig_H5 = 50, .dig_H6 = 30,
+};
+
+/***************************************************************
+ * Register images of the chip
+ ***************************************************************/
+
+static void put16(uint8_t addr, uint16_t val)
+{
+	sensor.regs[addr] = (uint8_t)val;
+	sensor.regs[addr + 1] = (uint8_t)(val >> 8);
+}
+
+static void sensor_store_calib(const BME280_calib_t *c)
+{
+	put16(0x88, c->dig_T1);
+	put16(0x8A, (uint16_t)c->dig_T2);
+	put16(0x8C, (uint16_t)c->dig_T3);
+	put16(0x8E, c->dig_P1);
+	put16(0x90, (uint16_t)c->dig_P2);
+	put16(0x92, (uint16_t)c->dig_P3);
+	put16(0x94, (uint16_t)c->dig_P4);
+	put16(0x96, (uint16_t)c->dig_P5);
+	put16(0x98, (uint16_t)c->dig_P6);
+	put16(0x9A, (uint16_t)c->dig_P7);
+	put16(0x9C, (uint16_t)c->dig_P8);
+	put16(0x9E, (uint16_t)c->dig_P9);
+	sensor.regs[0xA0] = 0x5A;	// not used
+	sensor.regs[0xA1] = c->dig_H1;
+
+	// 0xE4 - 0xE6 share a nibble between dig_H4 and dig_H5
+	put16(0xE1, (uint16_t)c->dig_H2);
+	sensor.regs[0xE3] = c->dig_H3;
+	sensor.regs[0xE4] = (uint8_t)(c->dig_H4 >> 4);
+	sensor.regs[0xE5] = (uint8_t)((c->dig_H4 & 0x0F) | ((c->dig_H5 & 0x0F) << 4));
+	sensor.regs[0xE6] = (uint8_t)(c->dig_H5 >> 4);
+	sensor.regs[0xE7] = (uint8_t)c->dig_H6;
+
+	sensor.regs[BME280_ID_ADDR] = BME280_ID;
+}
+
+/* press 0xF7 - 0xF9 and temp 0xFA - 0xFC are 20 bit, xlsb in bits 7:4, hum 0xFD - 0xFE */
+static void sensor_store_raw(int32_t adc_P, int32_t adc_T, int32_t adc_H)
+{
+	sensor.regs[0xF7] = (uint8_t)(adc_P >> 12);
+	sensor.regs[0xF8] = (uint8_t)(adc_P >> 4);
+	sensor.regs[0xF9] = (uint8_t)((adc_P & 0x0F) << 4);
+	sensor.regs[0xFA] = (uint8_t)(adc_T >> 12);
+	sensor.regs[0xFB] = (uint8_t)(adc_T >> 4);
+	sensor.regs[0xFC] = (uint8_t)((adc_T & 0x0F) << 4);
+	sensor.regs[0xFD] = (uint8_t)(adc_H >> 8);
+	sensor.regs[0xFE] = (uint8_t)adc_H;
+}
+
+/***************************************************************
+ * Floating point compensation of the datasheet ( 8.1 )
+ ***************************************************************/
+
+static void reference(const BME280_calib_t *c, int32_t adc_P, int32_t adc_T, int32_t adc_H,
+		double *t, double *p, double *h)
+{
+	double var1, var2, t_fine, var_H;
+
+	var1 = (adc_T / 16384.0 - c->dig_T1 / 1024.0) * c->dig_T2;
+	var2 = (adc_T / 131072.0 - c->dig_T1 / 8192.0) * (adc_T / 131072.0 - c->dig_T1 / 8192.0) * c->dig_T3;
+	t_fine = var1 + var2;
+	*t = t_fine / 5120.0;
+
+	var1 = t_fine / 2.0 - 64000.0;
+	var2 = var1 * var1 * c->dig_P6 / 32768.0;
+	var2 = var2 + var1 * c->dig_P5 * 2.0;
+	var2 = var2 / 4.0 + c->dig_P4 * 65536.0;
+	var1 = (c->dig_P3 * var1 * var1 / 524288.0 + c->dig_P2 * var1) / 524288.0;
+	var1 = (1.0 + var1 / 32768.0) * c->dig_P1;
+	*p = 1048576.0 - adc_P;
+	*p = (*p - var2 / 4096.0) * 6250.0 / var1;
+	var1 = c->dig_P9 * *p * *p / 2147483648.0;
+	var2 = *p * c->dig_P8 / 32768.0;
+	*p = *p + (var1 + var2 + c->dig_P7) / 16.0;
+
+	var_H = t_fine - 76800.0;
+	var_H = (adc_H - (c->dig_H4 * 64.0 + c->dig_H5 / 16384.0 * var_H)) *
+			(c->dig_H2 / 65536.0 * (1.0 + c->dig_H6 / 67108864.0 * var_H * (1.0 + c->dig_H3 / 67108864.0 * var_H)));
+	var_H = var_H * (1.0 - c->dig_H1 * var_H / 524288.0);
+	*h = var_H > 100.0 ? 100.0 : (var_H < 0.0 ? 0.0 : var_H);
+}
+
+/***************************************************************
+ * Calibration read and configuration written by init
+ ***************************************************************/
+
+static void test_init(void)
+{
+	sensor_store_calib(&trim);
+
+	CHECK(bme280_init() == HAL_OK, "init failed");
+	CHECK(sensor.regs[BME280_CTRL_HUM_ADDR] == 0x01, "ctrl_hum 0x%02X", sensor.regs[BME280_CTRL_HUM_ADDR]);
+	CHECK(sensor.regs[BME280_CTRL_MEAS_ADDR] == 0x27, "ctrl_meas 0x%02X", sensor.regs[BME280_CTRL_MEAS_ADDR]);
+	CHECK(sensor.regs[BME280_CONFIG_ADDR] == 0xA8, "config 0x%02X", sensor.regs[BME280_CONFIG_ADDR]);
+}
+
+/***************************************************************
+ * Example of the datasheet ( 3.12 of BMP280, same T and P formulas )
+ ***************************************************************/
+
+static void test_datasheet(void)
+{
+	BME280_data_t data;
+	uint32_t reads = sensor.reads;
+
+	sensor_store_raw(415148, 519888, 0x8000);
+	sensor.pointer = 0;
+
+	CHECK(bme280_get_data(&data) == HAL_OK, "read failed");
+	CHECK(sensor.reads == reads + 1 && sensor.pointer == BME280_DATA_ADDR + BME280_DATA_SIZE,
+			"data not read in one burst from 0x%02X", BME280_DATA_ADDR);
+
+	// 25.08 DegC, 100653.27 Pa
+	CHECK(fabs(data.temperature - 25.08) < 0.005, "temperature %.3f DegC, expected 25.08", data.temperature);
+	CHECK(fabs(data.pressure - 1006.5327) < 0.005, "pressure %.4f hPa, expected 1006.5327", data.pressure);
+}
+
+/***************************************************************
+ * Raw values over the range against the floating point formulas
+ * Fields of the burst have values which don't fit each other,
+ * so unpacking in wrong order is far off
+ ***************************************************************/
+
+static void test_vectors(void)
+{
+	static const struct { int32_t adc_P, adc_T, adc_H; } vectors[] =
+	{
+		{ 415148, 519888, 30000 },
+		{ 415148, 519888, 0x8000 },
+		{ 300000, 450000, 20000 },	// cold
+		{ 350000, 600000, 40000 },	// hot
+		{ 500000, 520000, 25000 },	// low pressure
+		{ 260000, 500000, 36000 },	// high pressure
+		{ 415148, 519888, 60000 },	// saturated humidity is limited to 100 %
+		{ 415148, 519888, 0 },		// dry is limited to 0 %
+	};
+	BME280_data_t data;
+	double t, p, h;
+
+	for(size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+	{
+		sensor_store_raw(vectors[i].adc_P, vectors[i].adc_T, vectors[i].adc_H);
+		reference(&trim, vectors[i].adc_P, vectors[i].adc_T, vectors[i].adc_H, &t, &p, &h);
+
+		CHECK(bme280_get_data(&data) == HAL_OK, "vector %u: read failed", (unsigned)i);
+		CHECK(fabs(data.temperature - t) < 0.011, "vector %u: temperature %.3f DegC, reference %.3f",
+				(unsigned)i, data.temperature, t);
+		CHECK(fabs(data.pressure * 100.0 - p) < 1.0, "vector %u: pressure %.2f Pa, reference %.2f",
+				(unsigned)i, data.pressure * 100.0, p);
+		CHECK(fabs(data.humidity - h) < 0.05, "vector %u: humidity %.3f %%rH, reference %.3f",
+				(unsigned)i, data.humidity, h);
+	}
+
+	// error of the bus is returned
+	sensor.fail = HAL_TIMEOUT;
+	CHECK(bme280_get_data(&data) == HAL_TIMEOUT, "bus timeout not returned");
+	sensor.fail = HAL_OK;
+}
+
+int main(void)
+{
+	i2c_regfile_attach(&sensor);
+
+	test_init();
+	test_datasheet();
+	test_vectors();
+
+	printf("bme280_test: %d errors\n", errors);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <string.h>
+#include "ds1307.h"
+#include "i2c_bus.h"
+#include "meteo_msg.h"
+
+/* DS1307 driver ( Drivers/bsp/ds1307.c ) on a register file of the chip
+ * The model counts the calendar in binary and writes the registers in BCD
+ * with the chosen hours format and noise in bits the driver must mask
+ */
+
+static int errors;
+
+#define CHECK(cond, ...)	do { if(!(cond)) { printf(__VA_ARGS__); printf("\n"); errors++; } } while(0)
+
+#define DS1307_REGS_SIZE	64		/* time keeper and RAM, pointer wraps at 0x3F */
+
+static i2c_regfile_t rtc = { .dev_addr = DS1307_I2C_ADDR, .size = DS1307_REGS_SIZE };
+
+/* calendar of the model, year 0 - 99 is 2000 - 2099 */
+typedef struct
+{
+	uint8_t year, month, date, day, hours, minutes, seconds;
+}model_t;
+
+static uint8_t to_bcd(uint8_t bin)
+{
+	return (uint8_t)(((bin / 10) << 4) | (bin % 10));
+}
+
+static uint8_t month_days(uint8_t month, uint8_t year)
+{
+	static const uint8_t days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+	return (month == 2 && year % 4 == 0) ? 29 : days[month - 1];
+}
+
+/***************************************************************
+ * Write model time into registers 0x00 - 0x06
+ * noise sets bits which read as 0 on the chip or are not time
+ ***************************************************************/
+
+static void model_store(const model_t *m, int hour12, int noise)
+{
+	uint8_t hours;
+
+	if(hour12)
+	{
+		uint8_t h = m->hours % 12;
+
+		hours = (uint8_t)((1 << 6) | (m->hours >= 12 ? (1 << 5) : 0) | to_bcd(h == 0 ? 12 : h));
+	}
+	else
+	{
+		hours = to_bcd(m->hours);
+	}
+
+	rtc.regs[DS1307_ADDR_SEC] = to_bcd(m->seconds) | (noise ? 0x80 : 0);	// clock halt
+	rtc.regs[DS1307_ADDR_MIN] = to_bcd(m->minutes) | (noise ? 0x80 : 0);
+	rtc.regs[DS1307_ADDR_HOUR] = hours | (noise ? 0x80 : 0);
+	rtc.regs[DS1307_ADDR_DAY] = m->day | (noise ? 0xF8 : 0);
+	rtc.regs[DS1307_ADDR_DATA] = to_bcd(m->date) | (noise ? 0xC0 : 0);
+	rtc.regs[DS1307_ADDR_MONTH] = to_bcd(m->month) | (noise ? 0xE0 : 0);
+	rtc.regs[DS1307_ADDR_YEAR] = to_bcd(m->year);
+
+	// control register follows the year in the burst window of the chip
+	rtc.regs[0x07] = 0x93;
+}
+
+/***************************************************************
+ * Advance model by one second with carries into the calendar
+ ***************************************************************/
+
+static void model_tick(model_t *m)
+{
+	if(++m->seconds < 60) return;
+	m->seconds = 0;
+	if(++m->minutes < 60) return;
+	m->minutes = 0;
+	if(++m->hours < 24) return;
+	m->hours = 0;
+
+	m->day = (m->day % 7) + 1;
+	if(++m->date <= month_days(m->month, m->year)) return;
+	m->date = 1;
+	if(++m->month <= 12) return;
+	m->month = 1;
+	m->year = (m->year + 1) % 100;
+}
+
+/***************************************************************
+ * Read burst and compare with the model
+ ***************************************************************/
+
+static int check_read(const model_t *m, int hour12, RTC_date_t *date, RTC_time_t *time)
+{
+	uint32_t reads = rtc.reads;
+	uint8_t hours;
+	int before = errors;
+
+	memset(date, 0xAA, sizeof(*date));
+	memset(time, 0xAA, sizeof(*time));
+
+	CHECK(ds1307_get_datetime(date, time) == HAL_OK, "burst read failed");
+	CHECK(rtc.reads == reads + 1, "date and time took %lu transfers", (unsigned long)(rtc.reads - reads));
+
+	if(hour12)
+	{
+		CHECK(time->time_format == (m->hours >= 12 ? DS1307_TIME_FORMAT_12HOUR_PM : DS1307_TIME_FORMAT_12HOUR_AM),
+				"%02u h: format %u", m->hours, time->time_format);
+		hours = (uint8_t)(time->hours % 12 + (time->time_format == DS1307_TIME_FORMAT_12HOUR_PM ? 12 : 0));
+		CHECK(time->hours >= 1 && time->hours <= 12, "%02u h: 12 hours format %u", m->hours, time->hours);
+	}
+	else
+	{
+		CHECK(time->time_format == DS1307_TIME_FORMAT_24HOUR, "%02u h: format %u", m->hours, time->time_format);
+		hours = time->hours;
+	}
+
+	CHECK(time->seconds == m->seconds && time->minutes == m->minutes && hours == m->hours,
+			"time %02u:%02u:%02u read as %02u:%02u:%02u ( %u )", m->hours, m->minutes, m->seconds,
+			time->hours, time->minutes, time->seconds, time->time_format);
+	CHECK(date->date == m->date && date->month == m->month && date->year == m->year && date->day == m->day,
+			"date %02u.%02u.%02u day %u read as %02u.%02u.%02u day %u", m->date, m->month, m->year, m->day,
+			date->date, date->month, date->year, date->day);
+
+	return errors == before;
+}
+
+/***************************************************************
+ * Fixed register images, clock halt and 12 hours bits
+ ***************************************************************/
+
+static void test_decode(void)
+{
+	static const struct
+	{
+		uint8_t regs[DS1307_DATETIME_SIZE];
+		uint8_t seconds, minutes, hours, format;
+		uint8_t day, date, month, year;
+	}cases[] =
+	{
+		// 24 hours, clock running
+		{ { 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x00 }, 0, 0, 0, DS1307_TIME_FORMAT_24HOUR, 1, 1, 1, 0 },
+		{ { 0x59, 0x59, 0x23, 0x07, 0x31, 0x12, 0x99 }, 59, 59, 23, DS1307_TIME_FORMAT_24HOUR, 7, 31, 12, 99 },
+		// clock halt bit set after power loss
+		{ { 0xB7, 0x42, 0x19, 0x03, 0x28, 0x02, 0x24 }, 37, 42, 19, DS1307_TIME_FORMAT_24HOUR, 3, 28, 2, 24 },
+		// 12 hours format: bit 6 set, bit 5 PM, hours 1 - 12
+		{ { 0x05, 0x30, 0x52, 0x02, 0x15, 0x06, 0x25 }, 5, 30, 12, DS1307_TIME_FORMAT_12HOUR_AM, 2, 15, 6, 25 },
+		{ { 0x05, 0x30, 0x72, 0x02, 0x15, 0x06, 0x25 }, 5, 30, 12, DS1307_TIME_FORMAT_12HOUR_PM, 2, 15, 6, 25 },
+		{ { 0x05, 0x30, 0x41, 0x02, 0x15, 0x06, 0x25 }, 5, 30, 1, DS1307_TIME_FORMAT_12HOUR_AM, 2, 15, 6, 25 },
+		{ { 0x05, 0x30, 0x71, 0x02, 0x15, 0x06, 0x25 }, 5, 30, 11, DS1307_TIME_FORMAT_12HOUR_PM, 2, 15, 6, 25 },
+		// 12 hours format with clock halt
+		{ { 0x80, 0x00, 0x69, 0x05, 0x09, 0x10, 0x30 }, 0, 0, 9, DS1307_TIME_FORMAT_12HOUR_PM, 5, 9, 10, 30 },
+	};
+	RTC_date_t date;
+	RTC_time_t time;
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		memcpy(rtc.regs, cases[i].regs, DS1307_DATETIME_SIZE);
+		rtc.regs[0x07] = 0x10;
+
+		CHECK(ds1307_get_datetime(&date, &time) == HAL_OK, "case %u: read failed", (unsigned)i);
+		CHECK(time.seconds == cases[i].seconds && time.minutes == cases[i].minutes &&
+				time.hours == cases[i].hours && time.time_format == cases[i].format,
+				"case %u: time %02u:%02u:%02u ( %u ), expected %02u:%02u:%02u ( %u )", (unsigned)i,
+				time.hours, time.minutes, time.seconds, time.time_format,
+				cases[i].hours, cases[i].minutes, cases[i].seconds, cases[i].format);
+		CHECK(date.day == cases[i].day && date.date == cases[i].date &&
+				date.month == cases[i].month && date.year == cases[i].year,
+				"case %u: date %02u.%02u.%02u day %u", (unsigned)i, date.date, date.month, date.year, date.day);
+	}
+
+	// registers are read from 0x00 even if the pointer was left elsewhere
+	rtc.pointer = 0x3E;
+	CHECK(ds1307_get_datetime(&date, &time) == HAL_OK && rtc.pointer == DS1307_DATETIME_SIZE,
+			"burst left pointer at 0x%02X", rtc.pointer);
+
+	// error of the bus is returned and output is not used
+	rtc.fail = HAL_TIMEOUT;
+	CHECK(ds1307_get_datetime(&date, &time) == HAL_TIMEOUT, "bus timeout not returned");
+	rtc.fail = HAL_OK;
+}
+
+/***************************************************************
+ * Run the model across minute, hour, day, month and year ends
+ * Every read must be one second after the previous one
+ ***************************************************************/
+
+static void test_rollover(int hour12, int noise)
+{
+	static const model_t starts[] =
+	{
+		{ 26, 3, 14, 7, 9, 59, 30 },	// minute and hour
+		{ 26, 3, 14, 7, 11, 59, 30 },	// noon
+		{ 26, 4, 30, 5, 23, 59, 30 },	// 30 days month
+		{ 26, 1, 31, 7, 23, 59, 30 },	// 31 days month
+		{ 24, 2, 28, 4, 23, 59, 30 },	// leap year
+		{ 24, 2, 29, 5, 23, 59, 30 },
+		{ 25, 2, 28, 6, 23, 59, 30 },	// common year
+		{ 25, 12, 31, 4, 23, 59, 30 },	// year
+		{ 99, 12, 31, 5, 23, 59, 30 },	// end of DS1307 century
+	};
+	RTC_date_t date;
+	RTC_time_t time;
+
+	for(size_t i = 0; i < sizeof(starts) / sizeof(starts[0]); i++)
+	{
+		model_t m = starts[i];
+		uint32_t prev = 0;
+
+		for(int s = 0; s < 60 && errors < 20; s++)
+		{
+			model_store(&m, hour12, noise);
+			if(!check_read(&m, hour12, &date, &time)) break;
+
+			uint32_t epoch = meteo_epoch_from_rtc(&date, &time);
+			if(s > 0 && !(m.year == 0 && m.month == 1 && m.date == 1 && m.hours == 0 && m.minutes == 0 && m.seconds == 0))
+			{
+				CHECK(epoch == prev + 1, "%s%s: %02u.%02u.%02u %02u:%02u:%02u is %lu s after previous read",
+						hour12 ? "12h" : "24h", noise ? " noise" : "", m.date, m.month, m.year,
+						m.hours, m.minutes, m.seconds, (unsigned long)(epoch - prev));
+			}
+			prev = epoch;
+
+			model_tick(&m);
+		}
+	}
+}
+
+int main(void)
+{
+	i2c_regfile_attach(&rtc);
+
+	test_decode();
+	test_rollover(0, 0);
+	test_rollover(1, 0);
+	test_rollover(0, 1);
+	test_rollover(1, 1);
+
+	printf("ds1307_test: %d errors\n", errors);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,356 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "i2c_bus.h"
+
+/* Transfer, timeout and recovery of Drivers/bsp/i2c_bus.c on a model of
+ * the I2C1 HAL. _IT transfers complete in the start call, complete later
+ * from an interrupt thread, never complete, or end with an error callback.
+ * SDA can be held low by the slave for a number of SCL clocks
+ */
+
+static int errors;
+
+#define CHECK(cond, ...)	do { if(!(cond)) { printf(__VA_ARGS__); printf("\n"); errors++; } } while(0)
+
+I2C_HandleTypeDef hi2c1 = { .Instance = I2C1 };
+
+typedef enum
+{
+	XFER_COMPLETE,		/* callback before the task sleeps */
+	XFER_LATE,			/* callback from interrupt after late_ms */
+	XFER_HANG,			/* no callback */
+	XFER_NACK,			/* error callback, acknowledge failure */
+	XFER_BUS_ERROR,		/* error callback, bus error */
+	XFER_BUSY			/* start fails, peripheral is busy */
+}xfer_mode_t;
+
+static xfer_mode_t mode;
+static TickType_t late_ms;
+
+/* counters of the model */
+static uint32_t it_starts, blocking_calls, inits, deinits;
+static uint32_t delays, delay_us;
+static uint32_t scl_pulses, stops;
+static uint32_t gpio_mode, gpio_pins;
+static void (*last_callback)(I2C_HandleTypeDef *hi2c);
+
+/* bus lines */
+static int scl = 1, sda = 1;
+static int sda_stuck_clocks;	/* SCL rising edges until slave releases SDA */
+
+/***************************************************************
+ * Model of the HAL
+ ***************************************************************/
+
+typedef struct
+{
+	TickType_t delay;
+	uint8_t *buf;
+	uint16_t len;
+	void (*callback)(I2C_HandleTypeDef *hi2c);
+}isr_t;
+
+static isr_t isr;
+
+static void sim_fill(uint8_t *buf, uint16_t len)
+{
+	for(uint16_t i = 0; i < len; i++) buf[i] = (uint8_t)(0xA5 + i);
+}
+
+static void* sim_isr_task(void *arg)
+{
+	isr_t *irq = arg;
+
+	vTaskDelay(irq->delay);
+	if(irq->buf != NULL) sim_fill(irq->buf, irq->len);
+	irq->callback(&hi2c1);
+	return NULL;
+}
+
+static void sim_isr_after(TickType_t delay, uint8_t *buf, uint16_t len, void (*callback)(I2C_HandleTypeDef *hi2c))
+{
+	pthread_t thread;
+
+	isr = (isr_t){ .delay = delay, .buf = buf, .len = len, .callback = callback };
+	pthread_create(&thread, NULL, sim_isr_task, &isr);
+	pthread_detach(thread);
+}
+
+static HAL_StatusTypeDef sim_start_it(uint8_t *rx, uint16_t len, void (*callback)(I2C_HandleTypeDef *hi2c))
+{
+	if(mode == XFER_BUSY) return HAL_BUSY;
+
+	it_starts++;
+	last_callback = callback;
+	hi2c1.ErrorCode = HAL_I2C_ERROR_NONE;
+
+	switch(mode)
+	{
+	case XFER_COMPLETE:
+		if(rx != NULL) sim_fill(rx, len);
+		callback(&hi2c1);
+		break;
+	case XFER_LATE:
+		sim_isr_after(late_ms, rx, len, callback);
+		break;
+	case XFER_NACK:
+		hi2c1.ErrorCode = HAL_I2C_ERROR_AF;
+		sim_isr_after(1, NULL, 0, HAL_I2C_ErrorCallback);
+		break;
+	case XFER_BUS_ERROR:
+		hi2c1.ErrorCode = HAL_I2C_ERROR_BERR;
+		sim_isr_after(1, NULL, 0, HAL_I2C_ErrorCallback);
+		break;
+	default:
+		break;
+	}
+
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+	return sim_start_it(pData, Size, HAL_I2C_MemRxCpltCallback);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+	return sim_start_it(NULL, Size, HAL_I2C_MemTxCpltCallback);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+	return sim_start_it(NULL, Size, HAL_I2C_MasterTxCpltCallback);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+	return sim_start_it(pData, Size, HAL_I2C_MasterRxCpltCallback);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	blocking_calls++;
+	sim_fill(pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	blocking_calls++;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	blocking_calls++;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	blocking_calls++;
+	sim_fill(pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+	inits++;
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+	deinits++;
+	return HAL_OK;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c)
+{
+	return hi2c->ErrorCode;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+	gpio_mode = GPIO_Init->Mode;
+	gpio_pins = GPIO_Init->Pin;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	int level = (PinState == GPIO_PIN_SET);
+
+	if(GPIOx != I2C_BUS_GPIO_PORT) return;
+
+	if(GPIO_Pin & I2C_BUS_SDA_PIN)
+	{
+		// STOP: SDA rises while SCL is high
+		if(!sda && level && scl && sda_stuck_clocks == 0) stops++;
+		sda = level;
+	}
+
+	if(GPIO_Pin & I2C_BUS_SCL_PIN)
+	{
+		if(!scl && level)
+		{
+			scl_pulses++;
+			if(sda_stuck_clocks > 0) sda_stuck_clocks--;
+		}
+		scl = level;
+	}
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	if(GPIOx == I2C_BUS_GPIO_PORT && GPIO_Pin == I2C_BUS_SDA_PIN)
+	{
+		return (sda && sda_stuck_clocks == 0) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+	}
+
+	return GPIO_PIN_SET;
+}
+
+void dwt_delay_us(uint32_t us)
+{
+	delays++;
+	delay_us += us;
+}
+
+/***************************************************************
+ * Blocking API before the scheduler and before i2c_bus_init
+ ***************************************************************/
+
+static void test_blocking(void)
+{
+	uint8_t buf[4];
+
+	rtos_stub_scheduler_state = taskSCHEDULER_RUNNING;
+	CHECK(i2c_bus_mem_read(0xD0, 0x00, buf, 4) == HAL_OK && blocking_calls == 1 && it_starts == 0,
+			"transfer before i2c_bus_init is not blocking");
+
+	CHECK(i2c_bus_init() == HAL_OK, "init failed");
+
+	rtos_stub_scheduler_state = taskSCHEDULER_NOT_STARTED;
+	CHECK(i2c_bus_mem_write(0xD0, 0x00, buf, 1) == HAL_OK && i2c_bus_transmit(0xD0, buf, 1) == HAL_OK &&
+			i2c_bus_receive(0xD0, buf, 1) == HAL_OK, "blocking transfer failed");
+	CHECK(blocking_calls == 4 && it_starts == 0, "transfer before scheduler is not blocking");
+
+	rtos_stub_scheduler_state = taskSCHEDULER_RUNNING;
+}
+
+/***************************************************************
+ * Completed transfers of every API in interrupt mode
+ ***************************************************************/
+
+static void test_complete(void)
+{
+	uint8_t buf[8];
+	TickType_t start;
+
+	mode = XFER_COMPLETE;
+	memset(buf, 0, sizeof(buf));
+	CHECK(i2c_bus_mem_read(0xD0, 0xF7, buf, 8) == HAL_OK && buf[0] == 0xA5 && buf[7] == 0xAC, "mem read failed");
+	CHECK(last_callback == HAL_I2C_MemRxCpltCallback, "mem read not in interrupt mode");
+	CHECK(i2c_bus_mem_write(0xD0, 0xF4, buf, 1) == HAL_OK && last_callback == HAL_I2C_MemTxCpltCallback, "mem write failed");
+	CHECK(i2c_bus_transmit(0xD0, buf, 1) == HAL_OK && last_callback == HAL_I2C_MasterTxCpltCallback, "transmit failed");
+	CHECK(i2c_bus_receive(0xD0, buf, 1) == HAL_OK && last_callback == HAL_I2C_MasterRxCpltCallback, "receive failed");
+	CHECK(it_starts == 4 && blocking_calls == 4, "%lu transfers in interrupt mode", (unsigned long)it_starts);
+
+	// task sleeps until the interrupt
+	mode = XFER_LATE;
+	late_ms = 5;
+	memset(buf, 0, sizeof(buf));
+	start = xTaskGetTickCount();
+	CHECK(i2c_bus_mem_read(0xD0, 0xF7, buf, 8) == HAL_OK && buf[7] == 0xAC, "late completion failed");
+	CHECK(xTaskGetTickCount() - start >= late_ms - 1, "returned before the interrupt");
+
+	CHECK(inits == 0 && deinits == 0, "completed transfers recovered the bus");
+}
+
+/***************************************************************
+ * Timeout, errors and busy start
+ ***************************************************************/
+
+static void test_failures(void)
+{
+	uint8_t buf[8];
+	TickType_t start, elapsed;
+
+	// no interrupt: timeout and recovery
+	mode = XFER_HANG;
+	start = xTaskGetTickCount();
+	CHECK(i2c_bus_mem_read(0xD0, 0xF7, buf, 8) == HAL_TIMEOUT, "hang didn't time out");
+	elapsed = xTaskGetTickCount() - start;
+	CHECK(elapsed >= I2C_BUS_TIMEOUT - 1 && elapsed < I2C_BUS_TIMEOUT + 20, "timeout took %lu ms", (unsigned long)elapsed);
+	CHECK(deinits == 1 && inits == 1, "timeout didn't recover the bus");
+
+	// NACK is the answer of the device, bus is fine
+	mode = XFER_NACK;
+	CHECK(i2c_bus_transmit(0xD0, buf, 1) == HAL_ERROR, "NACK not returned");
+	CHECK(deinits == 1, "NACK recovered the bus");
+
+	// bus error needs recovery
+	mode = XFER_BUS_ERROR;
+	CHECK(i2c_bus_receive(0xD0, buf, 1) == HAL_ERROR, "bus error not returned");
+	CHECK(deinits == 2 && inits == 2, "bus error didn't recover the bus");
+
+	// peripheral stuck in busy state
+	mode = XFER_BUSY;
+	CHECK(i2c_bus_mem_write(0xD0, 0xF4, buf, 1) == HAL_BUSY, "busy not returned");
+	CHECK(deinits == 3 && inits == 3, "busy didn't recover the bus");
+
+	// completion after timeout doesn't complete the next transfer
+	mode = XFER_LATE;
+	late_ms = I2C_BUS_TIMEOUT + 10;
+	CHECK(i2c_bus_mem_read(0xD0, 0xF7, buf, 8) == HAL_TIMEOUT, "late completion didn't time out");
+	vTaskDelay(20);
+
+	mode = XFER_HANG;
+	CHECK(i2c_bus_mem_read(0xD0, 0xF7, buf, 8) == HAL_TIMEOUT, "stale completion finished the next transfer");
+	CHECK(deinits == 5 && inits == 5, "%lu recoveries", (unsigned long)deinits);
+}
+
+/***************************************************************
+ * Recovery clocks SCL until the slave releases SDA, then STOP
+ ***************************************************************/
+
+static void test_recover(void)
+{
+	uint32_t stuck[] = { 0, 1, 3, I2C_BUS_RECOVERY_CLOCKS, 100 };
+
+	for(size_t i = 0; i < sizeof(stuck) / sizeof(stuck[0]); i++)
+	{
+		uint32_t clocks = stuck[i] < I2C_BUS_RECOVERY_CLOCKS ? stuck[i] : I2C_BUS_RECOVERY_CLOCKS;
+
+		scl_pulses = stops = delays = delay_us = 0;
+		gpio_mode = gpio_pins = 0;
+		sda_stuck_clocks = (int)stuck[i];
+
+		i2c_bus_recover();
+
+		CHECK(scl_pulses == clocks, "SDA stuck for %lu clocks: %lu SCL pulses", (unsigned long)stuck[i], (unsigned long)scl_pulses);
+		CHECK(stops == (sda_stuck_clocks == 0 ? 1u : 0u), "SDA stuck for %lu clocks: %lu STOP", (unsigned long)stuck[i], (unsigned long)stops);
+		CHECK(gpio_mode == GPIO_MODE_OUTPUT_OD && gpio_pins == (I2C_BUS_SCL_PIN | I2C_BUS_SDA_PIN),
+				"pins not open drain outputs");
+
+		// every half period is a DWT delay
+		CHECK(delays == 2 * clocks + 2 && delay_us == delays * I2C_BUS_RECOVERY_HALF_US,
+				"SDA stuck for %lu clocks: %lu delays, %lu us", (unsigned long)stuck[i],
+				(unsigned long)delays, (unsigned long)delay_us);
+		CHECK(scl && sda, "lines not released after recovery");
+	}
+}
+
+int main(void)
+{
+	test_blocking();
+	test_complete();
+	test_failures();
+	test_recover();
+
+	printf("i2c_bus_test: %d errors\n", errors);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+#include <string.h>
+#include "i2c_bus.h"
+
+/*
+ * Transfers of i2c_bus.h on register files, as the DS1307 and BME280 see them:
+ * register pointer is set by the first written byte or by the memory address
+ * and advances with every byte. Address without device is NACK ( HAL_ERROR ).
+ */
+
+static i2c_regfile_t *devices[I2C_REGFILE_MAX_DEVICES];
+
+void i2c_regfile_attach(i2c_regfile_t *dev)
+{
+	for(uint8_t i = 0; i < I2C_REGFILE_MAX_DEVICES; i++)
+	{
+		if(devices[i] == NULL)
+		{
+			devices[i] = dev;
+			return;
+		}
+	}
+}
+
+void i2c_regfile_detach_all(void)
+{
+	memset(devices, 0, sizeof(devices));
+}
+
+static i2c_regfile_t* i2c_regfile_find(uint16_t dev_addr)
+{
+	for(uint8_t i = 0; i < I2C_REGFILE_MAX_DEVICES; i++)
+	{
+		if(devices[i] != NULL && devices[i]->dev_addr == dev_addr) return devices[i];
+	}
+
+	return NULL;
+}
+
+static void i2c_regfile_next(i2c_regfile_t *dev)
+{
+	dev->pointer++;
+	if(dev->size != 0 && dev->pointer >= dev->size) dev->pointer = 0;
+}
+
+static void i2c_regfile_get(i2c_regfile_t *dev, uint8_t *buf, uint16_t len)
+{
+	for(uint16_t i = 0; i < len; i++)
+	{
+		buf[i] = dev->regs[dev->pointer];
+		i2c_regfile_next(dev);
+	}
+	dev->reads++;
+}
+
+static void i2c_regfile_put(i2c_regfile_t *dev, const uint8_t *buf, uint16_t len)
+{
+	for(uint16_t i = 0; i < len; i++)
+	{
+		dev->regs[dev->pointer] = buf[i];
+		i2c_regfile_next(dev);
+	}
+	dev->writes++;
+}
+
+HAL_StatusTypeDef i2c_bus_mem_read(uint16_t dev_addr, uint8_t reg_addr, uint8_t *buf, uint16_t len)
+{
+	i2c_regfile_t *dev = i2c_regfile_find(dev_addr);
+
+	if(dev == NULL) return HAL_ERROR;
+	if(dev->fail != HAL_OK) return dev->fail;
+
+	dev->pointer = reg_addr;
+	i2c_regfile_get(dev, buf, len);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef i2c_bus_mem_write(uint16_t dev_addr, uint8_t reg_addr, uint8_t *buf, uint16_t len)
+{
+	i2c_regfile_t *dev = i2c_regfile_find(dev_addr);
+
+	if(dev == NULL) return HAL_ERROR;
+	if(dev->fail != HAL_OK) return dev->fail;
+
+	dev->pointer = reg_addr;
+	i2c_regfile_put(dev, buf, len);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef i2c_bus_transmit(uint16_t dev_addr, uint8_t *buf, uint16_t len)
+{
+	i2c_regfile_t *dev = i2c_regfile_find(dev_addr);
+
+	if(dev == NULL) return HAL_ERROR;
+	if(dev->fail != HAL_OK) return dev->fail;
+	if(len == 0) return HAL_OK;
+
+	dev->pointer = buf[0];
+	i2c_regfile_put(dev, buf + 1, len - 1);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef i2c_bus_receive(uint16_t dev_addr, uint8_t *buf, uint16_t len)
+{
+	i2c_regfile_t *dev = i2c_regfile_find(dev_addr);
+
+	if(dev == NULL) return HAL_ERROR;
+	if(dev->fail != HAL_OK) return dev->fail;
+
+	i2c_regfile_get(dev, buf, len);
+	return HAL_OK;
+}
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <string.h>
+#include "lcd.h"
+
+/* Framebuffer of the LCD driver ( Drivers/bsp/lcd.c ) on a mocked GPIO
+ * Every EN pulse of a write is one nibble on the bus, the mock counts them
+ * per flush and decodes them as HD44780 in 4 bit mode does, so the content
+ * of the display is checked together with the cost
+ */
+
+static int errors;
+
+#define CHECK(cond, ...)	do { if(!(cond)) { printf(__VA_ARGS__); printf("\n"); errors++; } } while(0)
+
+/* HD44780 model: DDRAM row 1 at 0x00, row 2 at 0x40 */
+static uint8_t pins;				/* levels of LCD_GPIO_PORT pins */
+static uint8_t nibble_high;		/* first nibble of the byte */
+static int nibble_phase;
+static uint8_t ddram[0x80];
+static uint8_t address;
+
+static uint32_t cmd_nibbles, data_nibbles;
+static uint32_t cycles;
+
+static void model_reset(void)
+{
+	memset(ddram, ' ', sizeof(ddram));
+	address = 0;
+	nibble_phase = 0;
+	cmd_nibbles = data_nibbles = 0;
+}
+
+static void model_byte(uint8_t byte, int data)
+{
+	if(data)
+	{
+		ddram[address & 0x7F] = byte;
+		address++;
+	}
+	else if(byte & 0x80)
+	{
+		address = byte & 0x7F;
+	}
+	else if(byte == LCD_CMD_DIS_CLEAR)
+	{
+		memset(ddram, ' ', sizeof(ddram));
+		address = 0;
+	}
+}
+
+/***************************************************************
+ * Mocked GPIO and DWT
+ ***************************************************************/
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	int falling = (GPIO_Pin & LCD_GPIO_EN) && (pins & LCD_GPIO_EN) && PinState == GPIO_PIN_RESET;
+
+	if(GPIOx != LCD_GPIO_PORT) return;
+
+	if(PinState == GPIO_PIN_SET) pins |= (uint8_t)GPIO_Pin;
+	else pins &= (uint8_t)~GPIO_Pin;
+
+	// write cycle latches D4 - D7 at falling EN
+	if(!falling || (pins & LCD_GPIO_RW)) return;
+
+	uint8_t nibble = (uint8_t)(((pins & LCD_GPIO_D4) ? 1 : 0) | ((pins & LCD_GPIO_D5) ? 2 : 0) |
+			((pins & LCD_GPIO_D6) ? 4 : 0) | ((pins & LCD_GPIO_D7) ? 8 : 0));
+	int data = (pins & LCD_GPIO_RS) != 0;
+
+	if(data) data_nibbles++;
+	else cmd_nibbles++;
+
+	if(nibble_phase == 0)
+	{
+		nibble_high = nibble;
+		nibble_phase = 1;
+	}
+	else
+	{
+		model_byte((uint8_t)(nibble_high << 4 | nibble), data);
+		nibble_phase = 0;
+	}
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	// busy flag is never set
+	return GPIO_PIN_RESET;
+}
+
+uint32_t dwt_cycles(void)
+{
+	return cycles;
+}
+
+void dwt_delay_ns(uint32_t ns)
+{
+	cycles += ns;
+}
+
+void dwt_delay_us(uint32_t us)
+{
+	cycles += us * 1000;
+}
+
+/***************************************************************
+ * Flush and check nibbles and content of the display
+ ***************************************************************/
+
+static void flush_check(const char *name, const char *row1, const char *row2, uint32_t cmds, uint32_t chars)
+{
+	cmd_nibbles = data_nibbles = 0;
+
+	lcd_fb_write(1, 1, row1);
+	lcd_fb_write(2, 1, row2);
+	lcd_fb_flush();
+
+	CHECK(cmd_nibbles == 2 * cmds && data_nibbles == 2 * chars,
+			"%s: %lu command and %lu data nibbles, expected %lu and %lu", name,
+			(unsigned long)cmd_nibbles, (unsigned long)data_nibbles, (unsigned long)(2 * cmds), (unsigned long)(2 * chars));
+	CHECK(memcmp(&ddram[0x00], row1, LCD_COLUMNS) == 0 && memcmp(&ddram[0x40], row2, LCD_COLUMNS) == 0,
+			"%s: display shows \"%.16s\" \"%.16s\"", name, &ddram[0x00], &ddram[0x40]);
+	CHECK(nibble_phase == 0, "%s: byte not finished", name);
+}
+
+static void test_flush(void)
+{
+	lcd_init();
+	model_reset();
+
+	// first frame: every cell differs from cleared display, cursor is at home after init
+	flush_check("first frame", "12:34:5618.10.26", "21.5;1013.2;45.6", 1, 32);
+
+	// nothing changed
+	flush_check("same frame", "12:34:5618.10.26", "21.5;1013.2;45.6", 0, 0);
+
+	// seconds only: cursor to the last digit and one character
+	flush_check("seconds", "12:34:5718.10.26", "21.5;1013.2;45.6", 1, 1);
+	flush_check("seconds again", "12:34:5818.10.26", "21.5;1013.2;45.6", 1, 1);
+
+	// gap of two cells between minute and second costs more than the cursor command
+	flush_check("wide gap", "12:35:5918.10.26", "21.5;1013.2;45.6", 2, 2);
+
+	// gap of one cell ( ':' ) between minute and seconds is written through
+	flush_check("gap", "12:36:0018.10.26", "21.5;1013.2;45.6", 1, 4);
+
+	// end of row 1 and start of row 2, address counter doesn't continue into next row
+	flush_check("rows", "12:36:0018.10.27", "31.5;1013.2;45.6", 2, 2);
+
+	// invalidate sends every cell again
+	lcd_fb_invalidate();
+	flush_check("invalidate", "12:36:0018.10.27", "31.5;1013.2;45.6", 2, 32);
+	flush_check("after invalidate", "12:36:0118.10.27", "31.5;1013.2;45.6", 1, 1);
+
+	// data pins are outputs after busy polls of init
+	for(uint32_t pin = 0; pin < 16; pin++)
+	{
+		if(LCD_GPIO_DATA & (1U << pin))
+		{
+			CHECK(((LCD_GPIO_PORT->MODER >> (pin * 2)) & GPIO_MODER_MODER0) == 1, "D pin %lu is not output", (unsigned long)pin);
+		}
+	}
+}
+
+int main(void)
+{
+	test_flush();
+
+	printf("lcd_test: %d errors\n", errors);
+	return errors ? 1 : 0;
+}
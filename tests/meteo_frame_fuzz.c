@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "meteo_frame.h"
+
+/* Randomized test of the SPI frame encoder and stream parser ( common/meteo_frame.c )
+ * Every round builds a byte stream from good frames, zero padding of SPI
+ * transactions, random bytes and frames with flipped bits, feeds it into
+ * the parser in random pieces and checks that exactly the good frames
+ * come out, in order and unchanged
+ * Usage: meteo_frame_fuzz [rounds] [seed]
+ */
+
+#define FUZZ_STREAM_SIZE		4096
+#define FUZZ_MAX_FRAMES			64
+
+typedef struct
+{
+	uint16_t seq;
+	uint8_t count;
+	uint8_t payload[METEO_FRAME_MAX_PAYLOAD];
+}fuzz_frame_t;
+
+static uint32_t rng_state;
+
+static uint32_t fuzz_rand(void)
+{
+	// xorshift32
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+static int fuzz_fail(uint32_t round, const char *what)
+{
+	printf("round %lu: %s\n", (unsigned long)round, what);
+	return 1;
+}
+
+/***************************************************************
+ * CRC16-CCITT of the standard check string
+ ***************************************************************/
+
+static int fuzz_check_crc(void)
+{
+	if(meteo_frame_crc16(0xFFFF, "123456789", 9) != 0x29B1) return fuzz_fail(0, "crc16 check value");
+
+	// crc of two parts is the crc of the whole data
+	if(meteo_frame_crc16(meteo_frame_crc16(0xFFFF, "1234", 4), "56789", 5) != 0x29B1) return fuzz_fail(0, "crc16 continuation");
+	return 0;
+}
+
+/***************************************************************
+ * Encoder rejects frames which don't fit
+ ***************************************************************/
+
+static int fuzz_check_encode_limits(void)
+{
+	uint8_t buf[METEO_FRAME_SPI_SIZE];
+	uint8_t records[METEO_FRAME_MAX_PAYLOAD + METEO_FRAME_RECORD_SIZE] = {0};
+
+	if(meteo_frame_encode(buf, sizeof(buf), METEO_FRAME_TYPE_SAMPLES, 0, records, METEO_FRAME_MAX_RECORDS + 1) != 0)
+	{
+		return fuzz_fail(0, "encoded more than METEO_FRAME_MAX_RECORDS");
+	}
+	if(meteo_frame_encode(buf, METEO_FRAME_MAX_SIZE - 1, METEO_FRAME_TYPE_SAMPLES, 0, records, METEO_FRAME_MAX_RECORDS) != 0)
+	{
+		return fuzz_fail(0, "encoded into too small buffer");
+	}
+	if(meteo_frame_encode(buf, sizeof(buf), METEO_FRAME_TYPE_SAMPLES, 0, records, METEO_FRAME_MAX_RECORDS) != METEO_FRAME_MAX_SIZE)
+	{
+		return fuzz_fail(0, "length of full frame");
+	}
+	return 0;
+}
+
+/***************************************************************
+ * One round of stream fuzzing
+ ***************************************************************/
+
+static int fuzz_round(uint32_t round)
+{
+	static uint8_t stream[FUZZ_STREAM_SIZE];
+	fuzz_frame_t sent[FUZZ_MAX_FRAMES];
+	size_t len = 0;
+	int frames = 0;
+	uint16_t seq = (uint16_t)fuzz_rand();
+	uint32_t gaps = 0;
+
+	// Build the stream
+	while(frames < FUZZ_MAX_FRAMES)
+	{
+		uint8_t buf[METEO_FRAME_SPI_SIZE];
+		uint32_t kind = fuzz_rand() % 8;
+		size_t n;
+		uint16_t gap_next = 0;
+
+		if(kind < 4)
+		{
+			// good frame in SPI transaction with zero padding, sometimes after lost frames
+			fuzz_frame_t *f = &sent[frames];
+
+			f->seq = seq;
+			if(fuzz_rand() % 8 == 0)
+			{
+				uint16_t gap = 1 + fuzz_rand() % 3;
+				f->seq += gap;
+				if(frames) gap_next = gap;
+			}
+			f->count = fuzz_rand() % (METEO_FRAME_MAX_RECORDS + 1);
+			for(size_t i = 0; i < sizeof(f->payload); i++) f->payload[i] = (uint8_t)fuzz_rand();
+
+			memset(buf, 0, sizeof(buf));
+			n = meteo_frame_encode(buf, sizeof(buf), METEO_FRAME_TYPE_SAMPLES, f->seq, f->payload, f->count);
+			if(kind != 0) n = sizeof(buf);
+		}
+		else if(kind < 6)
+		{
+			// random bytes, sync bytes are more frequent than in random data
+			n = 1 + fuzz_rand() % 40;
+			for(size_t i = 0; i < n; i++)
+			{
+				uint32_t r = fuzz_rand() % 16;
+				buf[i] = (r == 0) ? METEO_FRAME_SYNC0 : (r == 1) ? METEO_FRAME_SYNC1 : (uint8_t)fuzz_rand();
+			}
+		}
+		else
+		{
+			// frame with 1 - 3 flipped bits after sync, CRC16-CCITT detects all of them
+			// count is not flipped, frame of other length is accepted with 1 / 65536 chance
+			uint8_t records[METEO_FRAME_MAX_PAYLOAD];
+
+			for(size_t i = 0; i < sizeof(records); i++) records[i] = (uint8_t)fuzz_rand();
+			n = meteo_frame_encode(buf, sizeof(buf), METEO_FRAME_TYPE_SAMPLES, (uint16_t)fuzz_rand(),
+					records, fuzz_rand() % (METEO_FRAME_MAX_RECORDS + 1));
+
+			uint32_t flips = 1 + fuzz_rand() % 3;
+			uint32_t bits[3];
+			for(uint32_t i = 0; i < flips; i++)
+			{
+				// distinct bits, flipping one bit twice would give the good frame
+				uint32_t bit;
+				int again;
+				do
+				{
+					bit = 16 + fuzz_rand() % ((n - 2) * 8);
+					again = (bit / 8 == offsetof(meteo_frame_header_t, count));
+					for(uint32_t j = 0; j < i; j++) again |= (bits[j] == bit);
+				}while(again);
+				bits[i] = bit;
+				buf[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+			}
+		}
+
+		if(len + n > sizeof(stream) - METEO_FRAME_SPI_SIZE) break;
+		if(kind < 4)
+		{
+			seq = sent[frames].seq + 1;
+			gaps += gap_next;
+		}
+		memcpy(stream + len, buf, n);
+		len += n;
+		if(kind < 4) frames++;
+	}
+
+	// Idle SPI transaction, false frame start before the last frame waits for more bytes
+	memset(stream + len, 0, METEO_FRAME_SPI_SIZE);
+	len += METEO_FRAME_SPI_SIZE;
+
+	// Feed the stream in random pieces
+	meteo_frame_parser_t parser;
+	meteo_frame_t frame;
+	meteo_frame_status_t status;
+	size_t pos = 0;
+	int received = 0;
+
+	meteo_frame_parser_init(&parser);
+	while(pos < len)
+	{
+		size_t piece = 1 + fuzz_rand() % 64;
+		if(piece > len - pos) piece = len - pos;
+
+		size_t used = meteo_frame_parse(&parser, stream + pos, piece, &frame, &status);
+		if((used == 0 && status != METEO_FRAME_OK) || used > piece) return fuzz_fail(round, "parser used wrong number of bytes");
+		if(parser.len > sizeof(parser.buf)) return fuzz_fail(round, "parser buffer overflow");
+		pos += used;
+
+		if(status != METEO_FRAME_OK) continue;
+
+		// Only good frames come out, in order and unchanged
+		if(received >= frames) return fuzz_fail(round, "more frames than sent");
+		fuzz_frame_t *f = &sent[received];
+		if(frame.type != METEO_FRAME_TYPE_SAMPLES || frame.seq != f->seq || frame.count != f->count ||
+		   memcmp(frame.payload, f->payload, (size_t)f->count * METEO_FRAME_RECORD_SIZE) != 0)
+		{
+			return fuzz_fail(round, "decoded frame differs from sent one");
+		}
+
+		uint8_t record[METEO_FRAME_RECORD_SIZE];
+		if(f->count)
+		{
+			meteo_frame_get_record(&frame, f->count - 1, record);
+			if(memcmp(record, f->payload + (f->count - 1) * METEO_FRAME_RECORD_SIZE, sizeof(record)) != 0)
+			{
+				return fuzz_fail(round, "last record differs");
+			}
+		}
+		received++;
+	}
+
+	if(received != frames) return fuzz_fail(round, "good frame was not decoded");
+	if(parser.frames != (uint32_t)frames) return fuzz_fail(round, "frames counter");
+	if(parser.lost != gaps) return fuzz_fail(round, "lost counter");
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t rounds = (argc > 1) ? strtoul(argv[1], NULL, 0) : 20000;
+	uint32_t seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : 0x4D455445;
+	int errors = 0;
+
+	rng_state = seed ? seed : 1;
+	errors += fuzz_check_crc();
+	errors += fuzz_check_encode_limits();
+
+	for(uint32_t round = 1; round <= rounds && !errors; round++)
+	{
+		errors += fuzz_round(round);
+	}
+
+	printf("meteo_frame_fuzz: %lu rounds, seed 0x%08lX, %d errors\n", (unsigned long)rounds, (unsigned long)seed, errors);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,150 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "meteo_msg.h"
+#include "ds1307.h"
+
+/* Conversions of meteo_msg_t ( Core/Src/meteo_msg.c )
+ * Epoch <-> RTC date and time against timegm / gmtime for every day of
+ * the DS1307 range, fixed point rounding and text formats
+ */
+
+static int errors;
+
+#define CHECK(cond, ...)	do { if(!(cond)) { printf(__VA_ARGS__); printf("\n"); errors++; } } while(0)
+
+/***************************************************************
+ * Every day of 2000 - 2099 at several times of day
+ ***************************************************************/
+
+static void test_epoch_round_trip(void)
+{
+	static const uint32_t secs[] = { 0, 1, 59, 3599, 43200, 86399 };
+	uint32_t first = meteo_epoch_from_rtc(&(RTC_date_t){ .date = 1, .month = 1, .year = 0 },
+			&(RTC_time_t){ .time_format = DS1307_TIME_FORMAT_24HOUR });
+
+	CHECK(first == 946684800, "01.01.2000 is %lu", (unsigned long)first);
+
+	for(uint32_t day = 0; day < 36525 && errors < 10; day++)
+	{
+		for(size_t i = 0; i < sizeof(secs) / sizeof(secs[0]); i++)
+		{
+			uint32_t epoch = first + day * 86400 + secs[i];
+			time_t t = epoch;
+			struct tm tm;
+			RTC_date_t date;
+			RTC_time_t time;
+
+			gmtime_r(&t, &tm);
+			meteo_epoch_to_rtc(epoch, &date, &time);
+
+			CHECK(date.year == tm.tm_year - 100 && date.month == tm.tm_mon + 1 && date.date == tm.tm_mday &&
+				  date.day == tm.tm_wday + SUNDAY,
+				  "%lu: date %02u.%02u.%02u day %u, expected %02d.%02d.%02d day %d", (unsigned long)epoch,
+				  date.date, date.month, date.year, date.day, tm.tm_mday, tm.tm_mon + 1, tm.tm_year - 100, tm.tm_wday + SUNDAY);
+			CHECK(time.hours == tm.tm_hour && time.minutes == tm.tm_min && time.seconds == tm.tm_sec &&
+				  time.time_format == DS1307_TIME_FORMAT_24HOUR,
+				  "%lu: time %02u:%02u:%02u", (unsigned long)epoch, time.hours, time.minutes, time.seconds);
+			CHECK(meteo_epoch_from_rtc(&date, &time) == epoch, "%lu: round trip gives %lu",
+				  (unsigned long)epoch, (unsigned long)meteo_epoch_from_rtc(&date, &time));
+			CHECK(meteo_epoch_from_rtc(&date, &time) == (uint32_t)timegm(&tm), "%lu: differs from timegm", (unsigned long)epoch);
+		}
+	}
+}
+
+/***************************************************************
+ * 12 hours format of DS1307
+ ***************************************************************/
+
+static void test_epoch_12hour(void)
+{
+	static const struct { uint8_t hours, format, expected; } cases[] =
+	{
+		{ 12, DS1307_TIME_FORMAT_12HOUR_AM, 0 },
+		{ 1, DS1307_TIME_FORMAT_12HOUR_AM, 1 },
+		{ 11, DS1307_TIME_FORMAT_12HOUR_AM, 11 },
+		{ 12, DS1307_TIME_FORMAT_12HOUR_PM, 12 },
+		{ 1, DS1307_TIME_FORMAT_12HOUR_PM, 13 },
+		{ 11, DS1307_TIME_FORMAT_12HOUR_PM, 23 },
+	};
+	RTC_date_t date = { .date = 1, .month = 1, .year = 0 };
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		RTC_time_t time = { .seconds = 5, .minutes = 30, .hours = cases[i].hours, .time_format = cases[i].format };
+		uint32_t epoch = meteo_epoch_from_rtc(&date, &time);
+
+		CHECK(epoch == 946684800 + cases[i].expected * 3600 + 30 * 60 + 5, "%u %s is hour %lu", cases[i].hours,
+			  cases[i].format == DS1307_TIME_FORMAT_12HOUR_PM ? "PM" : "AM", (unsigned long)(epoch % 86400) / 3600);
+	}
+}
+
+/***************************************************************
+ * Fixed point rounding and round trip through float getters
+ ***************************************************************/
+
+static void test_fixed_point(void)
+{
+	meteo_msg_t msg;
+
+	// Values near every step round to the step, negative temperature rounds away from zero
+	for(int k = -4000; k <= 8500; k++)
+	{
+		CHECK(meteo_temperature_to_fixed(k / 100.0 + 0.004) == k, "temperature %.3f", k / 100.0 + 0.004);
+		CHECK(meteo_temperature_to_fixed(k / 100.0 - 0.004) == k, "temperature %.3f", k / 100.0 - 0.004);
+
+		msg.temperature = k;
+		CHECK(meteo_temperature_to_fixed(meteo_temperature(&msg)) == k, "temperature %d round trip", k);
+	}
+	CHECK(meteo_temperature_to_fixed(-0.006) == -1, "temperature -0.006");
+	CHECK(meteo_temperature_to_fixed(-0.004) == 0, "temperature -0.004");
+
+	for(int k = 0; k <= 10000; k++)
+	{
+		CHECK(meteo_humidity_to_fixed(k / 100.0 + 0.004) == k, "humidity %.3f", k / 100.0 + 0.004);
+		CHECK(k == 0 || meteo_humidity_to_fixed(k / 100.0 - 0.004) == k, "humidity %.3f", k / 100.0 - 0.004);
+
+		msg.humidity = k;
+		CHECK(meteo_humidity_to_fixed(meteo_humidity(&msg)) == k, "humidity %d round trip", k);
+	}
+	CHECK(meteo_humidity_to_fixed(-1.0) == 0, "negative humidity");
+
+	for(uint32_t pa = 30000; pa <= 110000; pa++)
+	{
+		CHECK(meteo_pressure_to_fixed(pa / 100.0 + 0.004) == pa, "pressure %.3f", pa / 100.0 + 0.004);
+
+		msg.pressure = pa;
+		CHECK(meteo_pressure_to_fixed(meteo_pressure(&msg)) == pa, "pressure %lu round trip", (unsigned long)pa);
+	}
+	CHECK(meteo_pressure_to_fixed(-1.0) == 0, "negative pressure");
+}
+
+/***************************************************************
+ * CSV line of day file and LCD lines
+ ***************************************************************/
+
+static void test_formats(void)
+{
+	char line[64], line1[17], line2[17];
+	meteo_msg_t msg = { .epoch = 946684800 + 13 * 3600 + 5 * 60 + 9, .temperature = -512, .humidity = 4567, .pressure = 101326 };
+
+	int len = meteo_format_csv(&msg, line, sizeof(line));
+	CHECK(strcmp(line, "13:05:09;-5.1;1013.3;45.67\r\n") == 0, "csv line %s", line);
+	CHECK(len == (int)strlen(line), "csv length %d", len);
+
+	meteo_format_lcd(&msg, line1, line2, sizeof(line1));
+	CHECK(strcmp(line1, "13:05:0901.01.00") == 0, "lcd line 1 %s", line1);
+	CHECK(strcmp(line2, "-5.1;1013.3;45.6") == 0, "lcd line 2 %s is cut to 16 chars", line2);
+}
+
+int main(void)
+{
+	test_epoch_round_trip();
+	test_epoch_12hour();
+	test_fixed_point();
+	test_formats();
+
+	printf("meteo_msg_test: %d errors\n", errors);
+	return errors ? 1 : 0;
+}
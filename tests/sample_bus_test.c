@@ -0,0 +1,238 @@
+#include <pthread.h>
+#include <stdio.h>
+#include "sample_bus.h"
+
+/* Fan-out sample bus ( Core/Src/sample_bus.c ) with tasks as threads
+ * of stub/rtos_stub.c: one producer and subscribers of different speed.
+ * Every field of a sample is derived from its sequence number, so a torn
+ * copy doesn't pass the check
+ */
+
+static int errors;
+
+#define CHECK(cond, ...)	do { if(!(cond)) { printf(__VA_ARGS__); printf("\n"); errors++; } } while(0)
+
+#define STRESS_SAMPLES		8000
+#define STRESS_BURST		8		/* samples published per tick, less than the ring */
+
+typedef struct
+{
+	sample_sub_t *sub;
+	uint32_t every;			/* subscriber sleeps one tick after every n samples */
+	uint32_t received;
+	uint32_t gaps;			/* samples missing between received ones */
+	uint32_t torn;
+	uint32_t reorders;
+	int finished;
+}subscriber_t;
+
+static void sample_make(uint32_t seq, meteo_msg_t *msg)
+{
+	msg->epoch = seq;
+	msg->temperature = (int16_t)(seq * 7);
+	msg->humidity = (uint16_t)~seq;
+	msg->pressure = seq * 2654435761u;
+	msg->flags = (uint8_t)(seq & 3);
+}
+
+static int sample_valid(const meteo_msg_t *msg)
+{
+	meteo_msg_t expected;
+
+	sample_make(msg->epoch, &expected);
+	return msg->temperature == expected.temperature && msg->humidity == expected.humidity &&
+			msg->pressure == expected.pressure && msg->flags == expected.flags;
+}
+
+/***************************************************************
+ * Producer and subscriber tasks
+ ***************************************************************/
+
+static void* producer_task(void *arg)
+{
+	meteo_msg_t msg;
+
+	(void)arg;
+	for(uint32_t seq = 0; seq < STRESS_SAMPLES; seq++)
+	{
+		sample_make(seq, &msg);
+		sample_bus_publish(&msg);
+		if(seq % STRESS_BURST == STRESS_BURST - 1) vTaskDelay(1);
+	}
+
+	return NULL;
+}
+
+static void* subscriber_task(void *arg)
+{
+	subscriber_t *s = arg;
+	meteo_msg_t msg;
+	int64_t prev = -1;
+
+	while(sample_bus_receive(s->sub, &msg, pdMS_TO_TICKS(500)) == pdTRUE)
+	{
+		if(!sample_valid(&msg)) s->torn++;
+		if((int64_t)msg.epoch <= prev) s->reorders++;
+		else s->gaps += (uint32_t)(msg.epoch - prev - 1);
+
+		prev = msg.epoch;
+		s->received++;
+
+		if(msg.epoch == STRESS_SAMPLES - 1)
+		{
+			s->finished = 1;
+			break;
+		}
+		if(s->every != 0 && s->received % s->every == 0) vTaskDelay(1);
+	}
+
+	return NULL;
+}
+
+/***************************************************************
+ * Subscribers of different speed against a fast producer
+ ***************************************************************/
+
+static void test_stress(void)
+{
+	subscriber_t subs[SAMPLE_BUS_MAX_SUBSCRIBERS] =
+	{
+		{ .every = 0 },					// faster than producer
+		{ .every = 2 * STRESS_BURST },	// faster than producer, sleeps
+		{ .every = STRESS_BURST / 2 },	// 2 times slower
+		{ .every = 1 },					// 8 times slower
+	};
+	pthread_t threads[SAMPLE_BUS_MAX_SUBSCRIBERS], producer;
+
+	sample_bus_init();
+	for(int i = 0; i < SAMPLE_BUS_MAX_SUBSCRIBERS; i++)
+	{
+		subs[i].sub = sample_bus_subscribe();
+		CHECK(subs[i].sub != NULL, "subscriber %d not created", i);
+		if(subs[i].sub == NULL) return;
+	}
+	CHECK(sample_bus_subscribe() == NULL, "more than %d subscribers", SAMPLE_BUS_MAX_SUBSCRIBERS);
+
+	for(int i = 0; i < SAMPLE_BUS_MAX_SUBSCRIBERS; i++)
+	{
+		pthread_create(&threads[i], NULL, subscriber_task, &subs[i]);
+	}
+	pthread_create(&producer, NULL, producer_task, NULL);
+
+	pthread_join(producer, NULL);
+	for(int i = 0; i < SAMPLE_BUS_MAX_SUBSCRIBERS; i++)
+	{
+		subscriber_t *s = &subs[i];
+		uint32_t dropped;
+
+		pthread_join(threads[i], NULL);
+		dropped = sample_bus_dropped(s->sub);
+
+		printf("subscriber %d: %lu received, %lu dropped\n", i, (unsigned long)s->received, (unsigned long)dropped);
+		CHECK(s->finished, "subscriber %d didn't get the last sample", i);
+		CHECK(s->torn == 0, "subscriber %d: %lu torn samples", i, (unsigned long)s->torn);
+		CHECK(s->reorders == 0, "subscriber %d: %lu samples out of order", i, (unsigned long)s->reorders);
+		CHECK(s->gaps == dropped, "subscriber %d: %lu samples missing, %lu counted as dropped",
+				i, (unsigned long)s->gaps, (unsigned long)dropped);
+		CHECK(s->received + dropped == STRESS_SAMPLES, "subscriber %d: %lu received + %lu dropped",
+				i, (unsigned long)s->received, (unsigned long)dropped);
+		CHECK(s->sub->cursor == STRESS_SAMPLES, "subscriber %d: cursor %lu", i, (unsigned long)s->sub->cursor);
+	}
+
+	// slow subscribers lose samples, producer is not blocked by them
+	CHECK(sample_bus_dropped(subs[2].sub) > 0, "slow subscriber dropped nothing");
+	CHECK(sample_bus_dropped(subs[3].sub) > STRESS_SAMPLES / 2, "slowest subscriber dropped only %lu",
+			(unsigned long)sample_bus_dropped(subs[3].sub));
+}
+
+/***************************************************************
+ * Overrun of the ring keeps the newest SAMPLE_BUS_DEPTH samples
+ ***************************************************************/
+
+static void test_overrun(void)
+{
+	sample_sub_t *idle, *reader;
+	meteo_msg_t msg;
+
+	sample_bus_init();
+	idle = sample_bus_subscribe();
+	reader = sample_bus_subscribe();
+
+	for(uint32_t seq = 0; seq < 5; seq++)
+	{
+		sample_make(seq, &msg);
+		sample_bus_publish(&msg);
+		CHECK(sample_bus_receive(reader, &msg, 0) == pdTRUE && msg.epoch == seq, "reader missed %lu", (unsigned long)seq);
+	}
+
+	for(uint32_t seq = 5; seq < 5 + 3 * SAMPLE_BUS_DEPTH; seq++)
+	{
+		sample_make(seq, &msg);
+		sample_bus_publish(&msg);
+	}
+
+	// idle subscriber lost all but the newest SAMPLE_BUS_DEPTH
+	CHECK(sample_bus_receive(idle, &msg, 0) == pdTRUE, "idle subscriber got nothing");
+	CHECK(msg.epoch == 5 + 2 * SAMPLE_BUS_DEPTH, "idle subscriber resumed at %lu", (unsigned long)msg.epoch);
+	CHECK(sample_bus_dropped(idle) == 5 + 2 * SAMPLE_BUS_DEPTH, "idle subscriber dropped %lu",
+			(unsigned long)sample_bus_dropped(idle));
+
+	uint32_t count = 1;
+	while(sample_bus_receive(idle, &msg, 0) == pdTRUE) count++;
+	CHECK(count == SAMPLE_BUS_DEPTH && msg.epoch == 4 + 3 * SAMPLE_BUS_DEPTH,
+			"idle subscriber read %lu samples up to %lu", (unsigned long)count, (unsigned long)msg.epoch);
+
+	// cursor of the other subscriber is independent
+	CHECK(sample_bus_receive(reader, &msg, 0) == pdTRUE && msg.epoch == 5 + 2 * SAMPLE_BUS_DEPTH,
+			"reader resumed at %lu", (unsigned long)msg.epoch);
+	CHECK(sample_bus_dropped(reader) == 2 * SAMPLE_BUS_DEPTH, "reader dropped %lu",
+			(unsigned long)sample_bus_dropped(reader));
+}
+
+/***************************************************************
+ * Wake up without new sample doesn't restart the timeout
+ ***************************************************************/
+
+static sample_sub_t *stale_sub;
+
+static void* stale_give_task(void *arg)
+{
+	(void)arg;
+	vTaskDelay(60);
+	xSemaphoreGive(stale_sub->ready);
+	return NULL;
+}
+
+static void test_timeout(void)
+{
+	pthread_t thread;
+	meteo_msg_t msg;
+	TickType_t start, elapsed;
+
+	sample_bus_init();
+	stale_sub = sample_bus_subscribe();
+
+	// no wait with timeout 0
+	start = xTaskGetTickCount();
+	CHECK(sample_bus_receive(stale_sub, &msg, 0) == pdFALSE, "sample from empty bus");
+	CHECK(xTaskGetTickCount() - start < 5, "timeout 0 blocked");
+
+	// give without sample in the middle of the wait
+	pthread_create(&thread, NULL, stale_give_task, NULL);
+	start = xTaskGetTickCount();
+	CHECK(sample_bus_receive(stale_sub, &msg, 100) == pdFALSE, "sample from empty bus");
+	elapsed = xTaskGetTickCount() - start;
+	pthread_join(thread, NULL);
+
+	CHECK(elapsed >= 99 && elapsed < 140, "timeout of 100 ticks took %lu ticks", (unsigned long)elapsed);
+}
+
+int main(void)
+{
+	test_overrun();
+	test_timeout();
+	test_stress();
+
+	printf("sample_bus_test: %d errors\n", errors);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ff_gen_drv.h"
+#include "diskio_image.h"
+#include "host_clock.h"
+
+#define IMAGE_SS				512
+#define IMAGE_PAGE_SECTORS		128
+
+static uint8_t **pages;
+static uint32_t image_sectors;
+static uint8_t image_fill;
+static int image_present;
+static image_model_t model;
+static image_stats_t stats;
+static uint32_t last_write_au;
+
+/***************************************************************
+ * Create the image, all sectors read as fill until written
+ ***************************************************************/
+
+int image_create(uint32_t sectors, uint8_t fill, const image_model_t *m)
+{
+	image_free();
+
+	pages = calloc((sectors + IMAGE_PAGE_SECTORS - 1) / IMAGE_PAGE_SECTORS, sizeof(*pages));
+	if(pages == NULL) return -1;
+
+	image_sectors = sectors;
+	image_fill = fill;
+	image_present = 1;
+	model = *m;
+	memset(&stats, 0, sizeof(stats));
+	last_write_au = UINT32_MAX;
+	return 0;
+}
+
+void image_free(void)
+{
+	if(pages == NULL) return;
+
+	for(uint32_t i = 0; i < (image_sectors + IMAGE_PAGE_SECTORS - 1) / IMAGE_PAGE_SECTORS; i++)
+	{
+		free(pages[i]);
+	}
+	free(pages);
+	pages = NULL;
+}
+
+void image_set_present(int present)
+{
+	image_present = present;
+}
+
+void image_get_stats(image_stats_t *s)
+{
+	*s = stats;
+}
+
+/***************************************************************
+ * Add modelled time of one command to the host clock
+ ***************************************************************/
+
+static void image_busy(uint64_t us)
+{
+	stats.busy_us += us;
+	host_clock_advance(us);
+}
+
+static uint8_t *image_sector(DWORD sector, int alloc)
+{
+	uint8_t **page = &pages[sector / IMAGE_PAGE_SECTORS];
+
+	if(*page == NULL)
+	{
+		if(!alloc) return NULL;
+		*page = malloc(IMAGE_PAGE_SECTORS * IMAGE_SS);
+		memset(*page, image_fill, IMAGE_PAGE_SECTORS * IMAGE_SS);
+	}
+	return *page + (sector % IMAGE_PAGE_SECTORS) * IMAGE_SS;
+}
+
+static DSTATUS image_status(BYTE lun)
+{
+	(void)lun;
+	return image_present ? 0 : STA_NOINIT;
+}
+
+static DSTATUS image_initialize(BYTE lun)
+{
+	return image_status(lun);
+}
+
+static DRESULT image_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
+{
+	(void)lun;
+	if(!image_present)
+	{
+		stats.removed_cmds++;
+		return RES_NOTRDY;
+	}
+	if(sector + count > image_sectors) return RES_PARERR;
+
+	image_busy(model.cmd_us + (uint64_t)count * model.sector_us);
+	for(UINT i = 0; i < count; i++)
+	{
+		uint8_t *data = image_sector(sector + i, 0);
+
+		if(data) memcpy(buff + i * IMAGE_SS, data, IMAGE_SS);
+		else memset(buff + i * IMAGE_SS, image_fill, IMAGE_SS);
+	}
+	return RES_OK;
+}
+
+static DRESULT image_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+{
+	uint32_t au;
+
+	(void)lun;
+	if(!image_present)
+	{
+		stats.removed_cmds++;
+		return RES_NOTRDY;
+	}
+	if(sector + count > image_sectors) return RES_PARERR;
+
+	// Card moves between open allocation units, FAT and data are in different units
+	au = sector / model.au_sectors;
+	if(au != last_write_au)
+	{
+		stats.au_switches++;
+		image_busy(model.au_switch_us);
+		last_write_au = au;
+	}
+
+	image_busy(model.cmd_us + (uint64_t)count * model.sector_us + model.write_busy_us);
+	for(UINT i = 0; i < count; i++)
+	{
+		memcpy(image_sector(sector + i, 1), buff + i * IMAGE_SS, IMAGE_SS);
+	}
+	return RES_OK;
+}
+
+static DRESULT image_ioctl(BYTE lun, BYTE cmd, void *buff)
+{
+	(void)lun;
+	if(!image_present) return RES_NOTRDY;
+
+	switch(cmd)
+	{
+	case CTRL_SYNC:
+		return RES_OK;
+	case GET_SECTOR_COUNT:
+		*(DWORD*)buff = image_sectors;
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD*)buff = IMAGE_SS;
+		return RES_OK;
+	case GET_BLOCK_SIZE:
+		*(DWORD*)buff = model.au_sectors;
+		return RES_OK;
+	default:
+		return RES_PARERR;
+	}
+}
+
+/* fatfs.c links this driver like the generated SD_Driver */
+const Diskio_drvTypeDef SD_Driver =
+{
+	image_initialize,
+	image_status,
+	image_read,
+	image_write,
+	image_ioctl,
+};
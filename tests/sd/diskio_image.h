@@ -0,0 +1,43 @@
+#ifndef TESTS_DISKIO_IMAGE_H_
+#define TESTS_DISKIO_IMAGE_H_
+
+#include <stdint.h>
+
+/* SD card model of host tests, linked as SD_Driver of fatfs.c
+ * Sectors are kept in RAM pages allocated on first write, unwritten
+ * sectors read as the fill byte ( stale data of a used card )
+ * Every command advances the host clock by the modelled card time:
+ *   cmd_us         command and response of every read and write
+ *   sector_us      transfer of one sector
+ *   write_busy_us  programming after a write command
+ *   au_switch_us   write into other allocation unit than the previous write
+ * Default values are for a class 10 card on 4 bit bus at 24 MHz
+ */
+
+typedef struct
+{
+	uint32_t cmd_us;
+	uint32_t sector_us;
+	uint32_t write_busy_us;
+	uint32_t au_switch_us;
+	uint32_t au_sectors;
+}image_model_t;
+
+#define IMAGE_MODEL_DEFAULT		{ 150, 45, 800, 3000, 8192 }
+
+typedef struct
+{
+	uint64_t busy_us;			/* modelled card time of all commands */
+	uint32_t au_switches;
+	uint32_t removed_cmds;		/* commands while the card was removed */
+}image_stats_t;
+
+int image_create(uint32_t sectors, uint8_t fill, const image_model_t *model);
+void image_free(void);
+
+/* Card detect, commands fail with RES_NOTRDY while the card is removed */
+void image_set_present(int present);
+
+void image_get_stats(image_stats_t *stats);
+
+#endif /* TESTS_DISKIO_IMAGE_H_ */
@@ -0,0 +1,462 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sd_functions.h"
+#include "sd_io_stats.h"
+#include "meteo_msg.h"
+#include "ds1307.h"
+#include "diskio_image.h"
+#include "host_clock.h"
+
+/* Month replay of sd_task on the SD card model ( diskio_image.h )
+ * Samples of SD_LOG_SAMPLE_PERIOD_S go through the same calls as sd_task,
+ * the card is removed twice, once across midnight
+ * Replay stops at noon of the last day, so the last file is closed
+ * before the end of its contiguous extent
+ * Prints the card cost per sample and day change, then reads every day
+ * file back and checks it against the samples
+ * Usage: sd_replay [full days]
+ */
+
+#define REPLAY_IMAGE_SECTORS	8388608UL	/* 4 GB, FAT32 with 32 KB clusters */
+#define REPLAY_CLUSTER			32768
+#define REPLAY_FILL				0xA5		/* stale data of used card */
+#define REPLAY_POLL_US			5000000ULL	/* sd_task poll between samples */
+#define REPLAY_HOLES			64			/* free clusters between old files at start of card */
+
+typedef struct
+{
+	uint32_t from;		/* seconds from start of replay */
+	uint32_t to;
+}replay_removal_t;
+
+static const replay_removal_t removals[] =
+{
+	{ 2 * 86400 + 13 * 3600, 2 * 86400 + 13 * 3600 + 300 },
+	{ 9 * 86400 + 23 * 3600 + 57 * 60, 10 * 86400 + 4 * 60 },
+};
+
+static uint32_t start_epoch;
+static FATFS fs_check;
+
+/* state of sd_task */
+static RTC_date_t date;
+static prev_date_t prev_date;
+static char curr_path[21];
+static int prev_card_pin;
+static int day_changed;
+
+/***************************************************************
+ * Sample number i of the replay
+ ***************************************************************/
+
+static void replay_sample(uint32_t i, meteo_msg_t *msg)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->epoch = start_epoch + i * SD_LOG_SAMPLE_PERIOD_S;
+	msg->temperature = (int16_t)((i * 37) % 4000) - 1000;
+	msg->humidity = (i * 13) % 10000;
+	msg->pressure = 95000 + (i * 11) % 10000;
+}
+
+static int replay_card_present(uint32_t epoch)
+{
+	for(size_t i = 0; i < sizeof(removals) / sizeof(removals[0]); i++)
+	{
+		if(epoch >= start_epoch + removals[i].from && epoch < start_epoch + removals[i].to) return 0;
+	}
+	return 1;
+}
+
+static void replay_day_path(char *path, size_t len, uint32_t epoch)
+{
+	RTC_date_t d;
+	RTC_time_t t;
+
+	meteo_epoch_to_rtc(epoch, &d, &t);
+	snprintf(path, len, "/LOGS/%04d/%02d/%02d.%s", 2000 + d.year, d.month, d.date, SD_LOG_EXT);
+}
+
+/***************************************************************
+ * One pass of sd_task loop, msg is NULL for poll without sample
+ ***************************************************************/
+
+static void replay_sd_task(const meteo_msg_t *msg, int card_pin)
+{
+	RTC_time_t time;
+
+	day_changed = 0;
+	if(msg)
+	{
+		meteo_epoch_to_rtc(msg->epoch, &date, &time);
+
+		if(prev_date.prev_month != date.month || prev_date.prev_date != date.date)
+		{
+			prev_date.prev_month = date.month;
+			prev_date.prev_date = date.date;
+			day_changed = 1;
+
+			if(card_pin) sd_log_discard();
+			else sd_log_close();
+		}
+	}
+
+	if(card_pin)
+	{
+		if(sd_is_mounted())
+		{
+			sd_log_discard();
+			sd_unmount();
+		}
+		prev_card_pin = card_pin;
+		return;
+	}
+
+	if(!msg)
+	{
+		if(prev_card_pin == card_pin && !sd_log_flush_due()) return;
+		if(date.month == 0) return;
+	}
+	prev_card_pin = card_pin;
+
+	if(!sd_is_mounted() && sd_mount() != FR_OK) return;
+
+	if(!sd_log_is_open())
+	{
+		snprintf(curr_path, sizeof(curr_path), "/LOGS");
+		sd_create_directory(curr_path);
+		snprintf(curr_path, sizeof(curr_path), "/LOGS/%04d", 2000 + date.year);
+		sd_create_directory(curr_path);
+		snprintf(curr_path, sizeof(curr_path), "/LOGS/%04d/%02d", 2000 + date.year, date.month);
+		sd_create_directory(curr_path);
+		snprintf(curr_path + 13, sizeof(curr_path) - 13, "/%02d.%s", date.date, SD_LOG_EXT);
+
+		if(sd_log_open(curr_path) != FR_OK)
+		{
+			sd_unmount();
+			return;
+		}
+	}
+
+	if(!msg)
+	{
+		if(sd_log_flush() != FR_OK) sd_unmount();
+		return;
+	}
+
+	if(sd_log_append_record(msg) != FR_OK) sd_unmount();
+}
+
+/***************************************************************
+ * Check one day file against the samples of the day
+ * Returns number of errors, lost gets samples missing in file
+ ***************************************************************/
+
+#if SD_LOG_FORMAT == SD_LOG_FORMAT_CSV
+static int replay_check_day(uint32_t first, uint32_t count, uint32_t *lost)
+{
+	FIL file;
+	UINT br;
+	char path[32], line[64], data[64];
+	FSIZE_t expected = 0;
+
+	*lost = 0;
+	replay_day_path(path, sizeof(path), start_epoch + first * SD_LOG_SAMPLE_PERIOD_S);
+	if(f_open(&file, path, FA_READ) != FR_OK)
+	{
+		printf("%s: can't open\n", path);
+		return 1;
+	}
+
+	for(uint32_t i = first; i < first + count; i++)
+	{
+		meteo_msg_t msg;
+
+		replay_sample(i, &msg);
+		if(!replay_card_present(msg.epoch)) continue;
+
+		int len = meteo_format_csv(&msg, line, sizeof(line));
+		if(f_read(&file, data, len, &br) != FR_OK || br != (UINT)len || memcmp(data, line, len) != 0)
+		{
+			printf("%s: line of sample %lu differs at offset %lu\n", path, (unsigned long)i, (unsigned long)expected);
+			f_close(&file);
+			return 1;
+		}
+		expected += len;
+	}
+
+	int errors = (f_size(&file) != expected);
+	if(errors) printf("%s: size %lu, expected %lu\n", path, (unsigned long)f_size(&file), (unsigned long)expected);
+	f_close(&file);
+	return errors;
+}
+#else
+static int replay_check_day(uint32_t first, uint32_t count, uint32_t *lost)
+{
+	static meteo_msg_t records[SD_LOG_DAY_SAMPLES];
+	char path[32];
+	int record_count;
+	int r = 0;
+	int errors = 0;
+
+	*lost = 0;
+	replay_day_path(path, sizeof(path), start_epoch + first * SD_LOG_SAMPLE_PERIOD_S);
+	if(sd_log_read_range(path, 0, UINT32_MAX, records, SD_LOG_DAY_SAMPLES, &record_count) != FR_OK)
+	{
+		printf("%s: can't read\n", path);
+		return 1;
+	}
+
+	// Records are the samples of the day in order, samples may be lost only with removed card
+	for(uint32_t i = first; i < first + count; i++)
+	{
+		meteo_msg_t msg;
+
+		replay_sample(i, &msg);
+		if(!replay_card_present(msg.epoch)) continue;
+
+		if(r < record_count && memcmp(&records[r], &msg, sizeof(msg)) == 0) r++;
+		else (*lost)++;
+	}
+	if(r != record_count)
+	{
+		printf("%s: record %d is not a sample of the day\n", path, r);
+		errors++;
+	}
+
+	// File is truncated at the end of the last block on close
+	FIL file;
+	if(f_open(&file, path, FA_READ) == FR_OK)
+	{
+		if(f_size(&file) != (FSIZE_t)((record_count + METEO_LOG_RECORDS - 1) / METEO_LOG_RECORDS) * METEO_LOG_BLOCK_SIZE
+				&& *lost == 0)
+		{
+			printf("%s: size %lu for %d records\n", path, (unsigned long)f_size(&file), record_count);
+			errors++;
+		}
+		f_close(&file);
+	}
+	return errors;
+}
+#endif
+
+/***************************************************************
+ * Count clusters of day files and their directories
+ * Directories have one cluster, /LOGS and year directory are
+ * created once
+ ***************************************************************/
+
+static DWORD replay_log_clusters(uint32_t days)
+{
+	FILINFO info;
+	char path[32];
+	DWORD clusters = 2;
+	uint8_t month = 0;
+
+	for(uint32_t d = 0; d < days; d++)
+	{
+		RTC_date_t date;
+		RTC_time_t time;
+
+		meteo_epoch_to_rtc(start_epoch + d * 86400, &date, &time);
+		if(date.month != month) clusters++;
+		month = date.month;
+
+		replay_day_path(path, sizeof(path), start_epoch + d * 86400);
+		if(f_stat(path, &info) == FR_OK) clusters += (info.fsize + REPLAY_CLUSTER - 1) / REPLAY_CLUSTER;
+
+		snprintf(strrchr(path, '.'), 5, ".%s", SD_LOG_INDEX_EXT);
+		if(f_stat(path, &info) == FR_OK) clusters += (info.fsize + REPLAY_CLUSTER - 1) / REPLAY_CLUSTER;
+	}
+	return clusters;
+}
+
+/***************************************************************
+ * Check that the day file is one contiguous extent
+ * Link map table of one fragment has 4 items
+ ***************************************************************/
+
+static int replay_check_contiguous(uint32_t epoch)
+{
+	FIL file;
+	DWORD clmt[SD_LOG_CLMT_SIZE];
+	char path[32];
+	int errors = 0;
+
+	replay_day_path(path, sizeof(path), epoch);
+	if(f_open(&file, path, FA_READ) != FR_OK) return 0;
+
+	file.cltbl = clmt;
+	clmt[0] = SD_LOG_CLMT_SIZE;
+	if(f_size(&file) && (f_lseek(&file, CREATE_LINKMAP) != FR_OK || clmt[0] != 4))
+	{
+		printf("%s: %lu fragments\n", path, (unsigned long)(clmt[0] - 2) / 2);
+		errors++;
+	}
+	f_close(&file);
+	return errors;
+}
+
+/***************************************************************
+ * Make free space of used card: files of one cluster, every
+ * second one is emptied from the last, FatFs reuses the cluster
+ * hole of an emptied file, so next allocation starts at the first
+ ***************************************************************/
+
+static int replay_fragment_card(void)
+{
+	static BYTE cluster[REPLAY_CLUSTER];
+	FIL file;
+	UINT bw;
+	char path[16];
+
+	if(f_mount(&fs_check, SDPath, 1) != FR_OK || f_mkdir("/OLD") != FR_OK) return -1;
+
+	for(int i = 0; i < 2 * REPLAY_HOLES; i++)
+	{
+		snprintf(path, sizeof(path), "/OLD/%03d", i);
+		if(f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) return -1;
+		f_write(&file, cluster, sizeof(cluster), &bw);
+		f_close(&file);
+	}
+	for(int i = 2 * REPLAY_HOLES - 2; i >= 0; i -= 2)
+	{
+		snprintf(path, sizeof(path), "/OLD/%03d", i);
+		if(f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) return -1;
+		f_close(&file);
+	}
+
+	return f_mount(NULL, SDPath, 1);
+}
+
+static int replay_cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+	static BYTE work[_MAX_SS];
+	image_model_t model = IMAGE_MODEL_DEFAULT;
+	RTC_date_t start_date = { .date = 1, .month = 3, .year = 26 };
+	RTC_time_t start_time = { .time_format = DS1307_TIME_FORMAT_24HOUR };
+	uint32_t days = (argc > 1) ? strtoul(argv[1], NULL, 0) : 31;
+	uint32_t samples = days * SD_LOG_DAY_SAMPLES + SD_LOG_DAY_SAMPLES / 2;
+	uint32_t *sample_us = calloc(samples, sizeof(*sample_us));
+	uint32_t day_change_max_us = 0, stored = 0, lost_total = 0;
+	sd_io_stats_t io;
+	image_stats_t card;
+	int errors = 0;
+
+	start_epoch = meteo_epoch_from_rtc(&start_date, &start_time);
+
+	if(image_create(REPLAY_IMAGE_SECTORS, REPLAY_FILL, &model) != 0 || sample_us == NULL) return 1;
+	MX_FATFS_Init();
+	if(f_mkfs(SDPath, FM_FAT32, REPLAY_CLUSTER, work, sizeof(work)) != FR_OK)
+	{
+		printf("f_mkfs failed\n");
+		return 1;
+	}
+	if(replay_fragment_card() != FR_OK)
+	{
+		printf("old files can't be written\n");
+		return 1;
+	}
+	sd_io_stats_reset();
+
+	FATFS *fs;
+	DWORD free_start, free_end;
+	if(f_mount(&fs_check, SDPath, 1) != FR_OK || f_getfree(SDPath, &free_start, &fs) != FR_OK) return 1;
+	f_mount(NULL, SDPath, 1);
+
+	// Samples arrive every SD_LOG_SAMPLE_PERIOD_S, card time of sd_task is measured per sample
+	for(uint32_t i = 0; i < samples; i++)
+	{
+		meteo_msg_t msg;
+		uint64_t at = (uint64_t)i * SD_LOG_SAMPLE_PERIOD_S * 1000000;
+
+		replay_sample(i, &msg);
+		int card_pin = !replay_card_present(msg.epoch);
+		image_set_present(!card_pin);
+
+		if(host_clock_us() < at - REPLAY_POLL_US && i) host_clock_advance(at - REPLAY_POLL_US - host_clock_us());
+		replay_sd_task(NULL, card_pin);
+
+		if(host_clock_us() < at) host_clock_advance(at - host_clock_us());
+		uint64_t begin = host_clock_us();
+		replay_sd_task(&msg, card_pin);
+		sample_us[i] = (uint32_t)(host_clock_us() - begin);
+
+		if(!card_pin) stored++;
+		if(day_changed && i && sample_us[i] > day_change_max_us) day_change_max_us = sample_us[i];
+	}
+
+	// Cost of the logging session
+	host_log_verbose = 1;
+	sd_log_print_stats(stored);
+	host_log_verbose = 0;
+	sd_io_stats_get(&io);
+	image_get_stats(&card);
+
+	uint64_t busy_us = 0;
+	for(uint32_t i = 0; i < samples; i++) busy_us += sample_us[i];
+	qsort(sample_us, samples, sizeof(*sample_us), replay_cmp_u32);
+
+	printf("sd_replay %s: %lu.5 days, %lu samples, %lu while card was removed\n", SD_LOG_EXT,
+			(unsigned long)days, (unsigned long)samples, (unsigned long)(samples - stored));
+	printf("card: %lu read cmds (%lu sectors), %lu write cmds (%lu sectors), %lu AU switches\n",
+			(unsigned long)io.read_cmds, (unsigned long)io.sectors_read, (unsigned long)io.write_cmds,
+			(unsigned long)io.sectors_written, (unsigned long)card.au_switches);
+	printf("card busy per sample: avg %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+			busy_us / 1000.0 / samples, sample_us[samples / 2] / 1000.0,
+			sample_us[samples - samples / 100] / 1000.0, sample_us[samples - 1] / 1000.0);
+	printf("card busy of day change ( close and open ): max %.3f ms\n", day_change_max_us / 1000.0);
+
+	if(card.removed_cmds)
+	{
+		printf("%lu commands were sent to the removed card\n", (unsigned long)card.removed_cmds);
+		errors++;
+	}
+
+	// Close the session like sd_unmount and read every day back
+	image_set_present(1);
+	sd_unmount();
+	if(sd_mount() != FR_OK) return 1;
+
+	for(uint32_t d = 0; d <= days; d++)
+	{
+		uint32_t lost;
+		uint32_t first = d * SD_LOG_DAY_SAMPLES;
+		int day_errors = replay_check_day(first, (d < days) ? SD_LOG_DAY_SAMPLES : samples - first, &lost);
+		day_errors += replay_check_contiguous(start_epoch + first * SD_LOG_SAMPLE_PERIOD_S);
+
+		// Binary records after the last block write are lost with removed card
+		int removed = 0;
+		for(size_t r = 0; r < sizeof(removals) / sizeof(removals[0]); r++)
+		{
+			removed |= (removals[r].from / 86400 == d);
+		}
+		if(lost >= (removed ? SD_LOG_SYNC_INTERVAL : 1))
+		{
+			printf("day %lu: %lu samples lost\n", (unsigned long)d + 1, (unsigned long)lost);
+			day_errors++;
+		}
+		lost_total += lost;
+		errors += day_errors;
+	}
+
+	// Day files have no clusters after end of data
+	if(f_getfree(SDPath, &free_end, &fs) == FR_OK && free_start - free_end != replay_log_clusters(days + 1))
+	{
+		printf("%lu clusters are used, files and directories have %lu\n",
+				(unsigned long)(free_start - free_end), (unsigned long)replay_log_clusters(days + 1));
+		errors++;
+	}
+	sd_unmount();
+
+	printf("check: %lu day files read back, %lu samples lost, %d errors\n", (unsigned long)days + 1, (unsigned long)lost_total, errors);
+	image_free();
+	free(sample_us);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+#ifndef STUB_FREERTOS_H_
+#define STUB_FREERTOS_H_
+
+/* Host stub of FreeRTOS, tasks are pthreads ( rtos_stub.c ), tick is 1 ms */
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE						((BaseType_t)0)
+#define pdTRUE						((BaseType_t)1)
+#define pdPASS						pdTRUE
+#define pdFAIL						pdFALSE
+
+#define portMAX_DELAY				((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ			1000
+#define pdMS_TO_TICKS(xTimeInMs)	((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+
+/* interrupt is a thread of the test, there is no context switch to request */
+#define portYIELD_FROM_ISR(x)		((void)(x))
+
+#endif /* STUB_FREERTOS_H_ */
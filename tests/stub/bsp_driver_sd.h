@@ -0,0 +1,15 @@
+#ifndef STUB_BSP_DRIVER_SD_H_
+#define STUB_BSP_DRIVER_SD_H_
+
+/* Host stub of bsp_driver_sd.h, card info of the disk image */
+
+#include "stm32f4xx_hal.h"
+
+#define BSP_SD_CardInfo HAL_SD_CardInfoTypeDef
+
+#define   MSD_OK                        ((uint8_t)0x00)
+#define   MSD_ERROR                     ((uint8_t)0x01)
+
+void BSP_SD_GetCardInfo(HAL_SD_CardInfoTypeDef *CardInfo);
+
+#endif /* STUB_BSP_DRIVER_SD_H_ */
@@ -0,0 +1,49 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include "stm32f4xx_hal.h"
+#include "bsp_driver_sd.h"
+#include "logger.h"
+#include "host_clock.h"
+
+static uint64_t clock_us;
+int host_log_verbose;
+
+uint32_t SystemCoreClock = 168000000;
+GPIO_TypeDef host_gpioa, host_gpiob, host_gpioc, host_gpiod;
+
+uint64_t host_clock_us(void)
+{
+	return clock_us;
+}
+
+void host_clock_advance(uint64_t us)
+{
+	clock_us += us;
+}
+
+uint32_t HAL_GetTick(void)
+{
+	return (uint32_t)(clock_us / 1000);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+	clock_us += (uint64_t)Delay * 1000;
+}
+
+void BSP_SD_GetCardInfo(HAL_SD_CardInfoTypeDef *CardInfo)
+{
+	*CardInfo = (HAL_SD_CardInfoTypeDef){ .CardType = 1, .CardVersion = 1, .Class = 0x5B5 };
+}
+
+void log_printf(uint8_t level, log_module_t module, const char *fmt, ...)
+{
+	va_list args;
+
+	(void)module;
+	if(!host_log_verbose && level < LOG_LEVEL_WARN) return;
+
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+}
@@ -0,0 +1,16 @@
+#ifndef STUB_HOST_CLOCK_H_
+#define STUB_HOST_CLOCK_H_
+
+#include <stdint.h>
+
+/* Simulated time of host tests, HAL_GetTick returns it in ms
+ * the test advances it by sample period, the disk image by modelled latency
+ */
+
+uint64_t host_clock_us(void);
+void host_clock_advance(uint64_t us);
+
+/* log_printf prints to stdout if set */
+extern int host_log_verbose;
+
+#endif /* STUB_HOST_CLOCK_H_ */
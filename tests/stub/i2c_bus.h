@@ -0,0 +1,29 @@
+#ifndef STUB_I2C_BUS_H_
+#define STUB_I2C_BUS_H_
+
+/* Host stub of i2c_bus.h, the API of Drivers/bsp/i2c_bus.h runs on register
+ * files of simulated devices ( i2c/i2c_regfile.c ) instead of I2C1
+ * Drivers in Drivers/bsp include the target header, which declares the same API
+ */
+
+#include_next "i2c_bus.h"
+
+#define I2C_REGFILE_MAX_DEVICES			4
+
+/* Device on the simulated bus */
+typedef struct
+{
+	uint16_t dev_addr;			/* 8 bit address ( addr << 1 ) */
+	uint8_t regs[256];
+	uint16_t size;				/* register pointer wraps to 0 at size */
+	uint8_t pointer;			/* register of the next byte, as set by the master */
+	HAL_StatusTypeDef fail;		/* result of transfers, HAL_OK for working device */
+	uint32_t reads;				/* transfers from and to the device */
+	uint32_t writes;
+}i2c_regfile_t;
+
+/* Function prototypes */
+void i2c_regfile_attach(i2c_regfile_t *dev);
+void i2c_regfile_detach_all(void);
+
+#endif /* STUB_I2C_BUS_H_ */
@@ -0,0 +1,22 @@
+#ifndef STUB_SPI_SLAVE_H_
+#define STUB_SPI_SLAVE_H_
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef int spi_host_device_t;
+
+#define WORD_ALIGNED_ATTR			__attribute__((aligned(4)))
+
+typedef struct
+{
+	size_t length;				/* bits */
+	size_t trans_len;			/* bits received */
+	const void *tx_buffer;
+	void *rx_buffer;
+}spi_slave_transaction_t;
+
+esp_err_t spi_slave_transmit(spi_host_device_t host, spi_slave_transaction_t *trans_desc, TickType_t ticks_to_wait);
+
+#endif /* STUB_SPI_SLAVE_H_ */
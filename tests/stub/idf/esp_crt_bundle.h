@@ -0,0 +1,9 @@
+#ifndef STUB_ESP_CRT_BUNDLE_H_
+#define STUB_ESP_CRT_BUNDLE_H_
+
+#include "esp_err.h"
+
+/* Host client is plain HTTP, the bundle is accepted and not used */
+esp_err_t esp_crt_bundle_attach(void *conf);
+
+#endif /* STUB_ESP_CRT_BUNDLE_H_ */
@@ -0,0 +1,19 @@
+#ifndef STUB_ESP_ERR_H_
+#define STUB_ESP_ERR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Error codes of ESP-IDF used by host tests of ESP32 modules */
+typedef int esp_err_t;
+
+#define ESP_OK						0
+#define ESP_FAIL					-1
+#define ESP_ERR_INVALID_ARG			0x102
+#define ESP_ERR_INVALID_STATE		0x103
+#define ESP_ERR_INVALID_SIZE		0x104
+#define ESP_ERR_NOT_FOUND			0x105
+#define ESP_ERR_INVALID_RESPONSE	0x108
+
+#endif /* STUB_ESP_ERR_H_ */
@@ -0,0 +1,64 @@
+#ifndef STUB_ESP_HTTP_CLIENT_H_
+#define STUB_ESP_HTTP_CLIENT_H_
+
+#include "esp_err.h"
+
+/* HTTP client API of ESP-IDF, implemented by esp32/http_client_host.c
+ * over a plain TCP socket. Like the IDF client it keeps the connection
+ * between requests, connects again after "Connection: close" and fails
+ * the request if the kept connection was closed by the server
+ */
+#define ESP_ERR_HTTP_BASE			0x7000
+#define ESP_ERR_HTTP_CONNECT		(ESP_ERR_HTTP_BASE + 2)
+#define ESP_ERR_HTTP_WRITE_DATA		(ESP_ERR_HTTP_BASE + 3)
+#define ESP_ERR_HTTP_FETCH_HEADER	(ESP_ERR_HTTP_BASE + 4)
+
+typedef struct esp_http_client *esp_http_client_handle_t;
+
+typedef enum
+{
+	HTTP_EVENT_ERROR = 0,
+	HTTP_EVENT_ON_CONNECTED,
+	HTTP_EVENT_HEADERS_SENT,
+	HTTP_EVENT_ON_HEADER,
+	HTTP_EVENT_ON_DATA,
+	HTTP_EVENT_ON_FINISH,
+	HTTP_EVENT_DISCONNECTED,
+}esp_http_client_event_id_t;
+
+typedef struct esp_http_client_event
+{
+	esp_http_client_event_id_t event_id;
+	esp_http_client_handle_t client;
+	void *data;
+	int data_len;
+	void *user_data;
+}esp_http_client_event_t;
+
+typedef esp_http_client_event_t *esp_http_client_event_handle_t;
+typedef esp_err_t (*http_event_handle_cb)(esp_http_client_event_t *evt);
+
+typedef enum
+{
+	HTTP_METHOD_GET = 0,
+	HTTP_METHOD_POST,
+}esp_http_client_method_t;
+
+typedef struct
+{
+	const char *url;				/* http://host:port/path */
+	bool keep_alive_enable;
+	esp_err_t (*crt_bundle_attach)(void *conf);
+	http_event_handle_cb event_handler;
+	esp_http_client_method_t method;
+	int timeout_ms;					/* 5000 if 0 */
+}esp_http_client_config_t;
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config);
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value);
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len);
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client);
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+
+#endif /* STUB_ESP_HTTP_CLIENT_H_ */
@@ -0,0 +1,15 @@
+#ifndef STUB_ESP_LOG_H_
+#define STUB_ESP_LOG_H_
+
+#include <stdio.h>
+#include "sdkconfig.h"
+
+/* Warnings and errors are printed, info only if host_log_verbose is set, debug never */
+extern int host_log_verbose;
+
+#define ESP_LOGE(tag, fmt, ...)		printf("E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...)		printf("W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...)		do { if(host_log_verbose) printf("I %s: " fmt "\n", tag, ##__VA_ARGS__); } while(0)
+#define ESP_LOGD(tag, fmt, ...)		do { } while(0)
+
+#endif /* STUB_ESP_LOG_H_ */
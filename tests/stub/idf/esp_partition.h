@@ -0,0 +1,26 @@
+#ifndef STUB_ESP_PARTITION_H_
+#define STUB_ESP_PARTITION_H_
+
+#include "esp_err.h"
+
+/* Partition API of ESP-IDF, implemented by flash/partition_sim.c */
+typedef int esp_partition_type_t;
+typedef int esp_partition_subtype_t;
+
+#define ESP_PARTITION_TYPE_DATA		1
+
+typedef struct
+{
+	esp_partition_type_t type;
+	esp_partition_subtype_t subtype;
+	uint32_t address;
+	uint32_t size;
+	char label[17];
+}esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+
+#endif /* STUB_ESP_PARTITION_H_ */
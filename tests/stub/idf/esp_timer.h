@@ -0,0 +1,9 @@
+#ifndef STUB_ESP_TIMER_H_
+#define STUB_ESP_TIMER_H_
+
+#include <stdint.h>
+
+/* Microseconds of the monotonic clock, esp32/http_client_host.c */
+int64_t esp_timer_get_time(void);
+
+#endif /* STUB_ESP_TIMER_H_ */
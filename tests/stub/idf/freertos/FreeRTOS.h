@@ -0,0 +1,16 @@
+#ifndef STUB_FREERTOS_H_
+#define STUB_FREERTOS_H_
+
+#include <stdint.h>
+
+/* Types of ESP-IDF FreeRTOS, tick is 1 ms, functions are defined by the tests */
+typedef void *QueueHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE						0
+#define pdTRUE						1
+#define portMAX_DELAY				((TickType_t)0xFFFFFFFFUL)
+#define pdMS_TO_TICKS(ms)			((TickType_t)(ms))
+
+#endif /* STUB_FREERTOS_H_ */
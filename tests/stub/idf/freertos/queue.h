@@ -0,0 +1,9 @@
+#ifndef STUB_QUEUE_H_
+#define STUB_QUEUE_H_
+
+#include "freertos/FreeRTOS.h"
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait);
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+
+#endif /* STUB_QUEUE_H_ */
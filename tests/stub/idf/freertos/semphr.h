@@ -0,0 +1,13 @@
+#ifndef STUB_SEMPHR_H_
+#define STUB_SEMPHR_H_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+typedef void *SemaphoreHandle_t;
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
+
+#endif /* STUB_SEMPHR_H_ */
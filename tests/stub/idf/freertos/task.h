@@ -0,0 +1,8 @@
+#ifndef STUB_TASK_H_
+#define STUB_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+TickType_t xTaskGetTickCount(void);
+
+#endif /* STUB_TASK_H_ */
@@ -0,0 +1,9 @@
+#ifndef STUB_SDKCONFIG_H_
+#define STUB_SDKCONFIG_H_
+
+/* Kconfig values of the project, server is the stand-in of the test */
+extern char host_server_url[];
+
+#define CONFIG_SERVER_URL			host_server_url
+
+#endif /* STUB_SDKCONFIG_H_ */
@@ -0,0 +1,16 @@
+#ifndef STUB_MAIN_H_
+#define STUB_MAIN_H_
+
+/* Host stub of main.h, RTOS of stub/ without board drivers */
+
+#include "stm32f4xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "types.h"
+#include "logger.h"
+
+#endif /* STUB_MAIN_H_ */
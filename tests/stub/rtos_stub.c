@@ -0,0 +1,147 @@
+#define _GNU_SOURCE	/* PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP */
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+struct rtos_stub_sem
+{
+	pthread_mutex_t lock;
+	pthread_cond_t given;
+	uint8_t count;
+};
+
+static pthread_mutex_t critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+BaseType_t rtos_stub_scheduler_state = taskSCHEDULER_RUNNING;
+
+void rtos_stub_enter_critical(void)
+{
+	pthread_mutex_lock(&critical);
+}
+
+void rtos_stub_exit_critical(void)
+{
+	pthread_mutex_unlock(&critical);
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+	return rtos_stub_scheduler_state;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (TickType_t)((uint64_t)ts.tv_sec * configTICK_RATE_HZ + ts.tv_nsec / (1000000000 / configTICK_RATE_HZ));
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+	struct timespec ts = { .tv_sec = xTicksToDelay / configTICK_RATE_HZ,
+			.tv_nsec = (long)(xTicksToDelay % configTICK_RATE_HZ) * (1000000000 / configTICK_RATE_HZ) };
+
+	nanosleep(&ts, NULL);
+}
+
+void vTaskSetTimeOutState(TimeOut_t *pxTimeOut)
+{
+	pxTimeOut->xTimeOnEntering = xTaskGetTickCount();
+}
+
+/* same contract as tasks.c: remaining ticks are written back, state is restarted */
+BaseType_t xTaskCheckForTimeOut(TimeOut_t *pxTimeOut, TickType_t *pxTicksToWait)
+{
+	TickType_t now = xTaskGetTickCount();
+	TickType_t elapsed = now - pxTimeOut->xTimeOnEntering;
+
+	if(*pxTicksToWait == portMAX_DELAY) return pdFALSE;
+
+	if(elapsed < *pxTicksToWait)
+	{
+		*pxTicksToWait -= elapsed;
+		pxTimeOut->xTimeOnEntering = now;
+		return pdFALSE;
+	}
+
+	*pxTicksToWait = 0;
+	return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+	SemaphoreHandle_t sem = calloc(1, sizeof(*sem));
+	pthread_condattr_t attr;
+
+	if(sem == NULL) return NULL;
+
+	pthread_mutex_init(&sem->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&sem->given, &attr);
+	pthread_condattr_destroy(&attr);
+
+	return sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+	struct timespec deadline;
+	BaseType_t ret = pdTRUE;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += xBlockTime / configTICK_RATE_HZ;
+	deadline.tv_nsec += (long)(xBlockTime % configTICK_RATE_HZ) * (1000000000 / configTICK_RATE_HZ);
+	if(deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&xSemaphore->lock);
+	while(xSemaphore->count == 0)
+	{
+		if(xBlockTime == 0)
+		{
+			ret = pdFALSE;
+			break;
+		}
+
+		if(xBlockTime == portMAX_DELAY)
+		{
+			pthread_cond_wait(&xSemaphore->given, &xSemaphore->lock);
+		}
+		else if(pthread_cond_timedwait(&xSemaphore->given, &xSemaphore->lock, &deadline) != 0 && xSemaphore->count == 0)
+		{
+			ret = pdFALSE;
+			break;
+		}
+	}
+	if(ret == pdTRUE) xSemaphore->count = 0;
+	pthread_mutex_unlock(&xSemaphore->lock);
+
+	return ret;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+	BaseType_t ret;
+
+	pthread_mutex_lock(&xSemaphore->lock);
+	ret = (xSemaphore->count == 0) ? pdTRUE : pdFALSE;
+	xSemaphore->count = 1;
+	pthread_cond_signal(&xSemaphore->given);
+	pthread_mutex_unlock(&xSemaphore->lock);
+
+	return ret;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	if(pxHigherPriorityTaskWoken != NULL) *pxHigherPriorityTaskWoken = pdTRUE;
+
+	return xSemaphoreGive(xSemaphore);
+}
@@ -0,0 +1,16 @@
+#ifndef STUB_SEMPHR_H_
+#define STUB_SEMPHR_H_
+
+/* Host stub of semphr.h, binary semaphore on pthread mutex and condition */
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef struct rtos_stub_sem *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken);
+
+#endif /* STUB_SEMPHR_H_ */
@@ -0,0 +1,163 @@
+#ifndef STUB_STM32F4XX_HAL_H_
+#define STUB_STM32F4XX_HAL_H_
+
+/* Host stub of the HAL, only what the tested modules use */
+
+#include <stdint.h>
+
+typedef enum
+{
+	HAL_OK,
+	HAL_ERROR,
+	HAL_BUSY,
+	HAL_TIMEOUT
+}HAL_StatusTypeDef;
+
+typedef enum
+{
+	RESET = 0U,
+	SET = !RESET
+}FlagStatus, ITStatus;
+
+typedef struct { int unused; } UART_HandleTypeDef;
+typedef struct { int unused; } SPI_HandleTypeDef;
+
+/* TIM registers which the test drives, SR bits as on the target */
+typedef struct
+{
+	volatile uint32_t SR;
+	volatile uint32_t CNT;
+}TIM_TypeDef;
+
+typedef struct
+{
+	TIM_TypeDef *Instance;
+}TIM_HandleTypeDef;
+
+#define TIM_FLAG_UPDATE						0x00000001U
+
+#define __HAL_TIM_GET_COUNTER(__HANDLE__)			((__HANDLE__)->Instance->CNT)
+#define __HAL_TIM_GET_FLAG(__HANDLE__, __FLAG__)	(((__HANDLE__)->Instance->SR & (__FLAG__)) == (__FLAG__))
+#define __HAL_TIM_CLEAR_FLAG(__HANDLE__, __FLAG__)	((__HANDLE__)->Instance->SR &= ~(__FLAG__))
+
+typedef struct
+{
+	uint32_t CardType;
+	uint32_t CardVersion;
+	uint32_t Class;
+	uint32_t RelCardAdd;
+	uint32_t BlockNbr;
+	uint32_t BlockSize;
+	uint32_t LogBlockNbr;
+	uint32_t LogBlockSize;
+}HAL_SD_CardInfoTypeDef;
+
+/* Core clock of the target, DWT_CYCLES_PER_US uses it */
+extern uint32_t SystemCoreClock;
+
+void HAL_Delay(uint32_t Delay);
+
+/* GPIO ports are RAM of hal_stub.c, other peripherals are addresses only,
+ * the models behind the HAL functions are in the tests
+ */
+typedef struct
+{
+	volatile uint32_t MODER;
+	volatile uint32_t IDR;
+	volatile uint32_t ODR;
+}GPIO_TypeDef;
+
+typedef struct { uint32_t unused; } I2C_TypeDef;
+
+extern GPIO_TypeDef host_gpioa, host_gpiob, host_gpioc, host_gpiod;
+
+#define GPIOA								(&host_gpioa)
+#define GPIOB								(&host_gpiob)
+#define GPIOC								(&host_gpioc)
+#define GPIOD								(&host_gpiod)
+#define I2C1								((I2C_TypeDef *)0x40005400UL)
+
+#define GPIO_MODER_MODER0					0x00000003U
+
+/* GPIO */
+typedef enum
+{
+	GPIO_PIN_RESET = 0,
+	GPIO_PIN_SET
+}GPIO_PinState;
+
+typedef struct
+{
+	uint32_t Pin;
+	uint32_t Mode;
+	uint32_t Pull;
+	uint32_t Speed;
+	uint32_t Alternate;
+}GPIO_InitTypeDef;
+
+#define GPIO_PIN_0							((uint16_t)0x0001)
+#define GPIO_PIN_1							((uint16_t)0x0002)
+#define GPIO_PIN_2							((uint16_t)0x0004)
+#define GPIO_PIN_3							((uint16_t)0x0008)
+#define GPIO_PIN_4							((uint16_t)0x0010)
+#define GPIO_PIN_5							((uint16_t)0x0020)
+#define GPIO_PIN_6							((uint16_t)0x0040)
+#define GPIO_PIN_7							((uint16_t)0x0080)
+#define GPIO_PIN_8							((uint16_t)0x0100)
+#define GPIO_PIN_9							((uint16_t)0x0200)
+#define GPIO_PIN_10							((uint16_t)0x0400)
+#define GPIO_PIN_11							((uint16_t)0x0800)
+#define GPIO_PIN_12							((uint16_t)0x1000)
+#define GPIO_PIN_13							((uint16_t)0x2000)
+#define GPIO_PIN_14							((uint16_t)0x4000)
+#define GPIO_PIN_15							((uint16_t)0x8000)
+
+#define GPIO_MODE_INPUT						0x00000000U
+#define GPIO_MODE_OUTPUT_PP					0x00000001U
+#define GPIO_MODE_OUTPUT_OD					0x00000011U
+#define GPIO_NOPULL							0x00000000U
+#define GPIO_PULLUP							0x00000001U
+#define GPIO_SPEED_FREQ_LOW					0x00000000U
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+/* I2C */
+typedef struct
+{
+	I2C_TypeDef *Instance;
+	volatile uint32_t ErrorCode;
+}I2C_HandleTypeDef;
+
+#define HAL_I2C_ERROR_NONE					0x00000000U
+#define HAL_I2C_ERROR_BERR					0x00000001U
+#define HAL_I2C_ERROR_ARLO					0x00000002U
+#define HAL_I2C_ERROR_AF					0x00000004U
+#define HAL_I2C_ERROR_OVR					0x00000008U
+#define HAL_I2C_ERROR_TIMEOUT				0x00000020U
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c);
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+/* ms of the host clock ( host_clock.h ) */
+uint32_t HAL_GetTick(void);
+
+#endif /* STUB_STM32F4XX_HAL_H_ */
@@ -0,0 +1,35 @@
+#ifndef STUB_TASK_H_
+#define STUB_TASK_H_
+
+/* Host stub of task.h, critical section is one recursive mutex for all threads */
+
+#include "FreeRTOS.h"
+
+void rtos_stub_enter_critical(void);
+void rtos_stub_exit_critical(void);
+
+#define taskENTER_CRITICAL()					rtos_stub_enter_critical()
+#define taskEXIT_CRITICAL()						rtos_stub_exit_critical()
+#define taskENTER_CRITICAL_FROM_ISR()			(rtos_stub_enter_critical(), (UBaseType_t)0)
+#define taskEXIT_CRITICAL_FROM_ISR(x)			do { (void)(x); rtos_stub_exit_critical(); } while(0)
+
+#define taskSCHEDULER_SUSPENDED					((BaseType_t)0)
+#define taskSCHEDULER_NOT_STARTED				((BaseType_t)1)
+#define taskSCHEDULER_RUNNING					((BaseType_t)2)
+
+/* state returned by xTaskGetSchedulerState, the test sets it */
+extern BaseType_t rtos_stub_scheduler_state;
+BaseType_t xTaskGetSchedulerState(void);
+
+/* Tick count is ms of CLOCK_MONOTONIC */
+typedef struct
+{
+	TickType_t xTimeOnEntering;
+}TimeOut_t;
+
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(TickType_t xTicksToDelay);
+void vTaskSetTimeOutState(TimeOut_t *pxTimeOut);
+BaseType_t xTaskCheckForTimeOut(TimeOut_t *pxTimeOut, TickType_t *pxTicksToWait);
+
+#endif /* STUB_TASK_H_ */
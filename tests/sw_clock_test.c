@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "sw_clock.h"
+
+/* Software clock ( Core/Src/sw_clock.c ) on a simulated TIM2
+ * The oscillator of TIM2 runs with a ppm error against the true time,
+ * the reference is the true time, as DS1307 at its second edge
+ */
+
+static int errors;
+
+#define CHECK(cond, ...)	do { if(!(cond)) { printf(__VA_ARGS__); printf("\n"); errors++; } } while(0)
+
+#define EPOCH_BASE_US		(1767225600ULL * 1000000)	/* 01.01.2026 */
+#define SYNC_US				(SW_CLOCK_SYNC_INTERVAL_S * 1000000ULL)
+
+static TIM_TypeDef tim2_regs;
+static TIM_HandleTypeDef htim2 = { .Instance = &tim2_regs };
+
+static uint64_t true_us;		/* time since start of TIM2 */
+static int32_t osc_ppm;			/* error of TIM2 oscillator */
+static uint64_t osc_periods;	/* periods counted by sw_clock */
+
+/***************************************************************
+ * Start the clock on TIM2 with oscillator error
+ ***************************************************************/
+
+static void sim_start(int32_t ppm)
+{
+	true_us = 0;
+	osc_ppm = ppm;
+	osc_periods = 0;
+	tim2_regs.CNT = 0;
+	tim2_regs.SR = TIM_FLAG_UPDATE;	// set by HAL_TIM_Base_Init
+
+	sw_clock_init(&htim2);
+}
+
+/***************************************************************
+ * Run TIM2 for us of true time
+ * With masked interrupt the elapsed period is only flagged,
+ * sim_irq counts it later ( max one period )
+ ***************************************************************/
+
+static void sim_irq(void)
+{
+	if(tim2_regs.SR & TIM_FLAG_UPDATE)
+	{
+		tim2_regs.SR &= ~TIM_FLAG_UPDATE;
+		osc_periods++;
+		sw_clock_period_elapsed();
+	}
+}
+
+static int sim_advance(uint64_t us, int masked)
+{
+	uint64_t ticks;
+	int wrapped = 0;
+
+	true_us += us;
+	ticks = true_us * (uint64_t)(1000000 + osc_ppm) / (1000000ULL * SW_CLOCK_TICK_US);
+	tim2_regs.CNT = ticks % SW_CLOCK_TIM_PERIOD;
+
+	while(osc_periods + (tim2_regs.SR & TIM_FLAG_UPDATE ? 1 : 0) < ticks / SW_CLOCK_TIM_PERIOD)
+	{
+		tim2_regs.SR |= TIM_FLAG_UPDATE;
+		wrapped = 1;
+		if(masked) break;
+		sim_irq();
+	}
+
+	return wrapped;
+}
+
+static uint64_t ref_now(void)
+{
+	return EPOCH_BASE_US + true_us;
+}
+
+/***************************************************************
+ * Offsets up to SW_CLOCK_STEP_US are slewed, bigger are stepped
+ ***************************************************************/
+
+static void test_step(void)
+{
+	sw_clock_stats_t stats;
+
+	sim_start(0);
+	sim_advance(1000000, 0);
+	CHECK(sw_clock_sync_due(), "not synced clock isn't due");
+
+	// first reference always steps
+	sw_clock_sync(ref_now(), SW_CLOCK_SRC_DS1307);
+	sw_clock_get_stats(&stats);
+	CHECK(sw_clock_is_synced() && stats.steps == 1, "first sync: %lu steps", (unsigned long)stats.steps);
+	CHECK(sw_clock_now_us() == ref_now(), "first sync: clock %llu, ref %llu",
+			(unsigned long long)sw_clock_now_us(), (unsigned long long)ref_now());
+
+	// jump just below the limit is slewed, clock doesn't move at once
+	sim_advance(SYNC_US, 0);
+	sw_clock_sync(ref_now() + SW_CLOCK_STEP_US - 1, SW_CLOCK_SRC_DS1307);
+	sw_clock_get_stats(&stats);
+	CHECK(stats.steps == 1, "offset below step limit stepped");
+	CHECK(sw_clock_now_us() == ref_now(), "slewed offset moved the clock at once");
+	int32_t drift_ppb = stats.drift_ppb;
+
+	// bigger jump forward and back is stepped
+	sim_advance(SYNC_US, 0);
+	sw_clock_sync(ref_now() + 3 * SW_CLOCK_STEP_US, SW_CLOCK_SRC_SNTP);
+	sw_clock_get_stats(&stats);
+	CHECK(stats.steps == 2 && stats.last_src == SW_CLOCK_SRC_SNTP, "forward jump: %lu steps", (unsigned long)stats.steps);
+	CHECK(sw_clock_now_us() == ref_now() + 3 * SW_CLOCK_STEP_US, "forward jump not applied");
+
+	sim_advance(SYNC_US, 0);
+	sw_clock_sync(ref_now(), SW_CLOCK_SRC_DS1307);
+	sw_clock_get_stats(&stats);
+	CHECK(stats.steps == 3, "backward jump: %lu steps", (unsigned long)stats.steps);
+	CHECK(sw_clock_now_us() == ref_now(), "backward jump not applied");
+	CHECK(!sw_clock_sync_due(), "clock is due right after sync");
+
+	// step doesn't feed the drift estimate
+	CHECK(stats.drift_ppb == drift_ppb, "steps changed drift %ld -> %ld ppb", (long)drift_ppb, (long)stats.drift_ppb);
+}
+
+/***************************************************************
+ * Clock never goes back while it slews an offset, across TIM2
+ * periods which elapse with interrupt masked and across folds
+ ***************************************************************/
+
+static void test_monotonic(int32_t ppm, int64_t offset_us)
+{
+	uint64_t prev, now, start_true, start_clock;
+	uint64_t slew_us = (offset_us < 0 ? -offset_us : offset_us);
+	uint64_t slew_end_us = slew_us * 1000000 / SW_CLOCK_SLEW_PPM;
+	uint32_t wraps = 0;
+
+	sim_start(ppm);
+	sim_advance(1000000, 0);
+	sw_clock_sync(ref_now(), SW_CLOCK_SRC_DS1307);
+
+	// sooner than SW_CLOCK_MIN_DRIFT_S, offset is only slewed
+	sim_advance(SW_CLOCK_MIN_DRIFT_S * 1000000ULL / 2, 0);
+	sw_clock_sync(ref_now() + offset_us, SW_CLOCK_SRC_DS1307);
+
+	start_true = true_us;
+	start_clock = prev = sw_clock_now_us();
+
+	// 2 fold intervals in steps of 100 ms
+	while(true_us - start_true < 2 * 3600000000ULL && errors < 10)
+	{
+		if(sim_advance(100000, 1))
+		{
+			// read with the period pending, then let the interrupt run
+			now = sw_clock_now_us();
+			CHECK(now >= prev, "%ld ppm, %lld us: masked wrap went back %llu -> %llu",
+					(long)osc_ppm, (long long)offset_us, (unsigned long long)prev, (unsigned long long)now);
+			prev = now;
+			sim_irq();
+			wraps++;
+		}
+
+		now = sw_clock_now_us();
+		CHECK(now >= prev, "%ld ppm, %lld us: clock went back %llu -> %llu",
+				(long)osc_ppm, (long long)offset_us, (unsigned long long)prev, (unsigned long long)now);
+
+		// rate during slew is bounded by SW_CLOCK_SLEW_PPM plus the oscillator error
+		// ( slew is timed by TIM2, +1 ppm ), clock reads are rounded to a tick
+		uint64_t dt = true_us - start_true;
+		int64_t gain = (int64_t)(now - start_clock) - (int64_t)dt;
+		int64_t bound = (int64_t)(dt * (SW_CLOCK_SLEW_PPM + abs(ppm) + 1) / 1000000) + 2 * SW_CLOCK_TICK_US;
+		CHECK(gain <= bound && gain >= -bound, "%ld ppm, %lld us: gain %lld us after %llu us",
+				(long)osc_ppm, (long long)offset_us, (long long)gain, (unsigned long long)dt);
+
+		prev = now;
+	}
+
+	CHECK(wraps > 700, "only %lu TIM2 periods", (unsigned long)wraps);
+	CHECK(slew_end_us < true_us - start_true, "offset is not slewed within the run");
+
+	// offset is slewed away, error left is the oscillator one since last sync
+	int64_t err = (int64_t)(sw_clock_now_us() - ref_now()) - offset_us;
+	int64_t bound = (int64_t)(true_us * abs(ppm) / 1000000) + 2 * SW_CLOCK_TICK_US;
+	CHECK(err <= bound && err >= -bound, "%ld ppm, %lld us: error %lld us after slew",
+			(long)osc_ppm, (long long)offset_us, (long long)err);
+}
+
+/***************************************************************
+ * Drift estimate of hourly syncs converges, offsets stay within
+ * what slew corrects in one sync interval
+ ***************************************************************/
+
+static void test_drift(int32_t ppm)
+{
+	sw_clock_stats_t stats;
+	uint32_t steps;
+	int64_t expected_ppb = -(int64_t)ppm * 1000000000 / (1000000 + ppm);
+	int64_t max_offset = (int64_t)SYNC_US * SW_CLOCK_SLEW_PPM / 1000000;
+
+	sim_start(ppm);
+	sim_advance(1000000, 0);
+	sw_clock_sync(ref_now(), SW_CLOCK_SRC_DS1307);
+	sw_clock_get_stats(&stats);
+	steps = stats.steps;
+
+	for(int hour = 1; hour <= 48; hour++)
+	{
+		// clock is read often, as by sd_task
+		for(int i = 0; i < 360; i++)
+		{
+			sim_advance(SYNC_US / 360, 0);
+			sw_clock_now_us();
+		}
+		// slow TIM2 counts the interval later
+		sim_advance(2000000, 0);
+		CHECK(sw_clock_sync_due(), "%ld ppm: sync not due after interval", (long)osc_ppm);
+
+		sw_clock_sync(ref_now(), SW_CLOCK_SRC_DS1307);
+		sw_clock_get_stats(&stats);
+
+		CHECK(stats.steps == steps, "%ld ppm: stepped at hour %d, offset %ld us", (long)osc_ppm, hour, (long)stats.last_offset_us);
+		CHECK(stats.last_offset_us <= max_offset && stats.last_offset_us >= -max_offset,
+				"%ld ppm: offset %ld us at hour %d is more than slew of interval", (long)osc_ppm, (long)stats.last_offset_us, hour);
+	}
+
+	// residual rate error is a small part of SW_CLOCK_SLEW_PPM
+	int64_t residual = stats.drift_ppb - expected_ppb;
+	CHECK(residual < SW_CLOCK_SLEW_PPM && residual > -SW_CLOCK_SLEW_PPM,
+			"%ld ppm: drift %ld ppb, expected %lld ppb", (long)osc_ppm, (long)stats.drift_ppb, (long long)expected_ppb);
+	CHECK(stats.last_offset_us < 1000 && stats.last_offset_us > -1000,
+			"%ld ppm: offset %ld us after 48 syncs", (long)osc_ppm, (long)stats.last_offset_us);
+}
+
+int main(void)
+{
+	static const int32_t ppm[] = { 0, 20, -20, 150, -150, 400, -400 };
+
+	test_step();
+
+	test_monotonic(0, -SW_CLOCK_STEP_US / 2);
+	test_monotonic(-300, -SW_CLOCK_STEP_US / 2);
+	test_monotonic(300, SW_CLOCK_STEP_US / 2);
+
+	for(size_t i = 0; i < sizeof(ppm) / sizeof(ppm[0]); i++)
+	{
+		test_drift(ppm[i]);
+	}
+
+	printf("sw_clock_test: %d errors\n", errors);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+/***************************************************************
+ * meteolog2csv - convert binary day log of MeteoStation SD card
+ * ( /LOGS/YYYY/MM/DD.bin ) into CSV lines of the text log
+ *
+ * hh:mm:ss;tt.t;ppp.p;hh.hh
+ *
+ * Build on host ( little endian ):
+ * cc -O2 -I../MeteoStation/Core/Inc -o meteolog2csv meteolog2csv.c ../MeteoStation/Core/Src/meteo_log.c
+ *
+ * Usage: meteolog2csv [-f from_epoch] [-t to_epoch] DD.bin [DD.csv]
+ * Blocks with bad crc are skipped and reported on stderr,
+ * conversion stops at zero block of preallocated space
+ ***************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "meteo_log.h"
+
+#define SECONDS_PER_DAY		86400UL
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-f from_epoch] [-t to_epoch] log.bin [log.csv]\n", name);
+}
+
+static void print_record(FILE *out, const meteo_msg_t *rec)
+{
+	uint32_t secs = rec->epoch % SECONDS_PER_DAY;
+
+	fprintf(out, "%02lu:%02lu:%02lu;%02.1f;%03.1f;%02.2f\r\n",
+			(unsigned long)(secs / 3600), (unsigned long)((secs / 60) % 60), (unsigned long)(secs % 60),
+			rec->temperature / 100.0, rec->pressure / 100.0, rec->humidity / 100.0);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t from = 0, to = UINT32_MAX;
+	unsigned long blocks = 0, bad_blocks = 0, records = 0;
+	meteo_log_block_t block;
+	int arg = 1;
+
+	while(arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0')
+	{
+		if(arg + 1 >= argc)
+		{
+			usage(argv[0]);
+			return 1;
+		}
+
+		if(strcmp(argv[arg], "-f") == 0) from = strtoul(argv[arg + 1], NULL, 0);
+		else if(strcmp(argv[arg], "-t") == 0) to = strtoul(argv[arg + 1], NULL, 0);
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		arg += 2;
+	}
+
+	if(arg >= argc || argc - arg > 2)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	FILE *in = fopen(argv[arg], "rb");
+	if(!in)
+	{
+		perror(argv[arg]);
+		return 1;
+	}
+
+	FILE *out = stdout;
+	if(argc - arg == 2)
+	{
+		out = fopen(argv[arg + 1], "wb");
+		if(!out)
+		{
+			perror(argv[arg + 1]);
+			fclose(in);
+			return 1;
+		}
+	}
+
+	while(fread(&block, 1, sizeof(block), in) == sizeof(block))
+	{
+		// zero block of preallocated space after end of data
+		if(block.header.magic == 0) break;
+
+		blocks++;
+
+		if(!meteo_log_block_check(&block))
+		{
+			fprintf(stderr, "block %lu: bad header or crc, skipped\n", blocks - 1);
+			bad_blocks++;
+			continue;
+		}
+
+		for(int i = 0; i < block.header.count; i++)
+		{
+			const meteo_msg_t *rec = &block.records[i];
+
+			if(rec->epoch < from || rec->epoch > to) continue;
+
+			print_record(out, rec);
+			records++;
+		}
+	}
+
+	fprintf(stderr, "%lu blocks, %lu bad, %lu records\n", blocks, bad_blocks, records);
+
+	fclose(in);
+	if(out != stdout) fclose(out);
+
+	return bad_blocks ? 2 : 0;
+}